@@ -41,11 +41,18 @@ public class MultiplayerSessions : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
-				"Slate",
-				"SlateCore",
+				"ImageWrapper",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
+
+		// Friend avatars are read straight from the Steam client on the platforms OnlineSubsystemSteam supports
+		bool bWithSteamAvatars = Target.Platform == UnrealTargetPlatform.Win64 || Target.Platform == UnrealTargetPlatform.Linux || Target.Platform == UnrealTargetPlatform.Mac;
+		if (bWithSteamAvatars)
+		{
+			AddEngineThirdPartyPrivateStaticDependencies(Target, "Steamworks");
+		}
+		PrivateDefinitions.Add("WITH_MULTIPLAYER_STEAM_AVATARS=" + (bWithSteamAvatars ? "1" : "0"));
 		
 		
 		DynamicallyLoadedModuleNames.AddRange(
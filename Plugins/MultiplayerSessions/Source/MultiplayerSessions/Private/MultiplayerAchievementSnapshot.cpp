@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerAchievementSnapshot.h"
+
+TSharedRef<const FMultiplayerAchievementSnapshot> FMultiplayerAchievementSnapshot::Create(IOnlineAchievements& AchievementsInterface, const FUniqueNetId& PlayerId)
+{
+	TSharedRef<FMultiplayerAchievementSnapshot> Snapshot = MakeShared<FMultiplayerAchievementSnapshot>();
+	AchievementsInterface.GetCachedAchievements(PlayerId, Snapshot->Achievements);
+
+	Snapshot->AchievementIndices.Reserve(Snapshot->Achievements.Num());
+	Snapshot->Descriptions.Reserve(Snapshot->Achievements.Num());
+	for (int32 Index = 0; Index < Snapshot->Achievements.Num(); ++Index) {
+		const FOnlineAchievement& Achievement = Snapshot->Achievements[Index];
+		const FName AchievementId(*Achievement.Id);
+		Snapshot->AchievementIndices.Add(AchievementId, Index);
+		Snapshot->NumUnlocked += Achievement.Progress >= 100.0 ? 1 : 0;
+
+		FOnlineAchievementDesc Description;
+		if (AchievementsInterface.GetCachedAchievementDescription(Achievement.Id, Description) == EOnlineCachedResult::Success) {
+			Snapshot->Descriptions.Add(AchievementId, MoveTemp(Description));
+		}
+	}
+	return Snapshot;
+}
+
+const FOnlineAchievement* FMultiplayerAchievementSnapshot::FindAchievement(FName AchievementId) const
+{
+	const int32* Index = AchievementIndices.Find(AchievementId);
+	return Index ? &Achievements[*Index] : nullptr;
+}
+
+const FOnlineAchievementDesc* FMultiplayerAchievementSnapshot::FindDescription(FName AchievementId) const
+{
+	return Descriptions.Find(AchievementId);
+}
@@ -0,0 +1,353 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerAvatarService.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "OnlineSubsystem.h"
+#include "OnlineSubsystemNames.h"
+#include "Engine/Texture2D.h"
+#include "ImageUtils.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Modules/ModuleManager.h"
+#include "Tasks/Task.h"
+
+#if WITH_MULTIPLAYER_STEAM_AVATARS
+THIRD_PARTY_INCLUDES_START
+#include "steam/steam_api.h"
+THIRD_PARTY_INCLUDES_END
+
+/**
+ * Reads avatars from the Steam client's image cache. Steam downloads avatars it doesn't have yet in the background,
+ * GetXFriendAvatar returns -1 until then, so those requests are retried a few times a second until it arrives
+ */
+class FMultiplayerSteamAvatarProvider : public IMultiplayerAvatarProvider
+{
+public:
+
+	virtual void RequestAvatarPixels(const FUniqueNetId& UserId, SteamAvatarSize AvatarSize, FMultiplayerAvatarPixelsCallback&& Callback) override
+	{
+		if (UserId.GetType() != STEAM_SUBSYSTEM || UserId.GetSize() != sizeof(uint64)) {
+			Callback(false, FMultiplayerAvatarPixels());
+			return;
+		}
+		RequestSteamAvatar(*reinterpret_cast<const uint64*>(UserId.GetBytes()), AvatarSize, MoveTemp(Callback), MaxDownloadPolls);
+	}
+
+private:
+
+	static constexpr int32 MaxDownloadPolls = 25;
+	static constexpr float DownloadPollInterval = 0.2f;
+
+	static void RequestSteamAvatar(uint64 SteamId, SteamAvatarSize AvatarSize, FMultiplayerAvatarPixelsCallback&& Callback, int32 PollsLeft)
+	{
+		ISteamFriends* SteamFriendsApi = SteamFriends();
+		ISteamUtils* SteamUtilsApi = SteamUtils();
+		if (!SteamFriendsApi || !SteamUtilsApi) {
+			Callback(false, FMultiplayerAvatarPixels());
+			return;
+		}
+
+		int Picture = 0;
+		switch (AvatarSize) {
+		case SteamAvatarSize::SteamAvatar_Small:
+			Picture = SteamFriendsApi->GetSmallFriendAvatar(CSteamID(SteamId));
+			break;
+		case SteamAvatarSize::SteamAvatar_Medium:
+			Picture = SteamFriendsApi->GetMediumFriendAvatar(CSteamID(SteamId));
+			break;
+		case SteamAvatarSize::SteamAvatar_Large:
+			Picture = SteamFriendsApi->GetLargeFriendAvatar(CSteamID(SteamId));
+			break;
+		default:
+			break;
+		}
+
+		//Still downloading
+		if (Picture == -1 && PollsLeft > 0) {
+			FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([SteamId, AvatarSize, Callback = MoveTemp(Callback), PollsLeft](float DeltaTime) mutable {
+				RequestSteamAvatar(SteamId, AvatarSize, MoveTemp(Callback), PollsLeft - 1);
+				return false;
+			}), DownloadPollInterval);
+			return;
+		}
+
+		uint32 Width = 0;
+		uint32 Height = 0;
+		FMultiplayerAvatarPixels Pixels;
+		if (Picture <= 0 || !SteamUtilsApi->GetImageSize(Picture, &Width, &Height) || Width == 0 || Height == 0) {
+			Callback(false, MoveTemp(Pixels));
+			return;
+		}
+
+		Pixels.Width = Width;
+		Pixels.Height = Height;
+		Pixels.Data.SetNumUninitialized(Width * Height * 4);
+		const bool bWasSuccessful = SteamUtilsApi->GetImageRGBA(Picture, Pixels.Data.GetData(), Pixels.Data.Num());
+		Callback(bWasSuccessful, MoveTemp(Pixels));
+	}
+};
+#endif
+
+FMultiplayerAvatarService::FMultiplayerAvatarService(int32 MemoryBudgetKB, int32 InMaxUploadsPerTick) :
+	DecodedAvatars(MakeShared<FDecodedAvatarQueue, ESPMode::ThreadSafe>()),
+	MaxUploadsPerTick(FMath::Max(InMaxUploadsPerTick, 1))
+{
+	//Workers decode through the module, so it is loaded here on the game thread
+	ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	//The budget is split evenly between the buckets, each holds as many textures of its size as fit in its share
+	const int64 BucketBudgetBytes = int64(FMath::Max(MemoryBudgetKB, 0)) * 1024 / NumBuckets;
+	for (int32 BucketIndex = 0; BucketIndex < NumBuckets; ++BucketIndex) {
+		const int32 Dimension = GetAvatarDimension(static_cast<SteamAvatarSize>(BucketIndex + 1));
+		const int64 TextureBytes = int64(Dimension) * Dimension * sizeof(FColor);
+		Caches[BucketIndex].Empty(FMath::Max<int32>(int32(BucketBudgetBytes / TextureBytes), 1));
+	}
+
+	UploadTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FMultiplayerAvatarService::TickUploads));
+}
+
+FMultiplayerAvatarService::~FMultiplayerAvatarService()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(UploadTickerHandle);
+}
+
+void FMultiplayerAvatarService::SetProvider(const FMultiplayerAvatarProviderPtr& InProvider)
+{
+	Provider = InProvider;
+	Flush();
+}
+
+int32 FMultiplayerAvatarService::GetBucketIndex(SteamAvatarSize AvatarSize)
+{
+	switch (AvatarSize) {
+	case SteamAvatarSize::SteamAvatar_Small:
+		return 0;
+	case SteamAvatarSize::SteamAvatar_Medium:
+		return 1;
+	case SteamAvatarSize::SteamAvatar_Large:
+		return 2;
+	default:
+		return INDEX_NONE;
+	}
+}
+
+int32 FMultiplayerAvatarService::GetAvatarDimension(SteamAvatarSize AvatarSize)
+{
+	switch (AvatarSize) {
+	case SteamAvatarSize::SteamAvatar_Small:
+		return 32;
+	case SteamAvatarSize::SteamAvatar_Medium:
+		return 64;
+	case SteamAvatarSize::SteamAvatar_Large:
+		return 184;
+	default:
+		return 0;
+	}
+}
+
+FMultiplayerAvatarProviderPtr FMultiplayerAvatarService::CreatePlatformProvider()
+{
+#if WITH_MULTIPLAYER_STEAM_AVATARS
+	IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
+	if (Subsystem && Subsystem->GetSubsystemName() == STEAM_SUBSYSTEM) {
+		return MakeShared<FMultiplayerSteamAvatarProvider, ESPMode::ThreadSafe>();
+	}
+#endif
+	return nullptr;
+}
+
+UTexture2D* FMultiplayerAvatarService::RequestAvatar(const FUniqueNetId& UserId, SteamAvatarSize AvatarSize, const FMultiplayerOnAvatarReady& OnReady, FMultiplayerAvatarRequestHandle& OutHandle)
+{
+	OutHandle.Reset();
+
+	const int32 BucketIndex = GetBucketIndex(AvatarSize);
+	if (BucketIndex == INDEX_NONE) {
+		return nullptr;
+	}
+
+	const FString UserKey = UserId.ToString();
+	if (TObjectPtr<UTexture2D>* CachedAvatar = Caches[BucketIndex].FindAndTouch(UserKey)) {
+		return *CachedAvatar;
+	}
+	if (!Provider) {
+		return nullptr;
+	}
+
+	OutHandle.Id = NextRequestId++;
+
+	//Another row already asked for this avatar, wait for the same result
+	if (FPendingAvatar* PendingAvatar = PendingAvatars[BucketIndex].Find(UserKey)) {
+		PendingAvatar->Callbacks.Add(OutHandle.Id, OnReady);
+		return nullptr;
+	}
+	PendingAvatars[BucketIndex].Add(UserKey).Callbacks.Add(OutHandle.Id, OnReady);
+
+	TSharedRef<FDecodedAvatarQueue, ESPMode::ThreadSafe> Queue = DecodedAvatars;
+	IImageWrapperModule* ImageWrapper = ImageWrapperModule;
+	const int32 Dimension = GetAvatarDimension(AvatarSize);
+	const uint32 RequestGeneration = Generation;
+	Provider->RequestAvatarPixels(UserId, AvatarSize, [Queue, ImageWrapper, UserKey, BucketIndex, Dimension, RequestGeneration](bool bWasSuccessful, FMultiplayerAvatarPixels&& Pixels) {
+		UE::Tasks::Launch(UE_SOURCE_LOCATION, [Queue, ImageWrapper, UserKey, BucketIndex, Dimension, RequestGeneration, bWasSuccessful, Pixels = MoveTemp(Pixels)]() {
+			TUniquePtr<FDecodedAvatar> DecodedAvatar = MakeUnique<FDecodedAvatar>();
+			DecodedAvatar->UserKey = UserKey;
+			DecodedAvatar->BucketIndex = BucketIndex;
+			DecodedAvatar->Generation = RequestGeneration;
+			DecodedAvatar->bWasSuccessful = bWasSuccessful && DecodeAvatar(ImageWrapper, Pixels, Dimension, DecodedAvatar->Pixels);
+			Queue->Enqueue(MoveTemp(DecodedAvatar));
+		});
+	});
+	return nullptr;
+}
+
+void FMultiplayerAvatarService::CancelRequest(FMultiplayerAvatarRequestHandle RequestHandle)
+{
+	if (!RequestHandle.IsValid()) {
+		return;
+	}
+	for (TMap<FString, FPendingAvatar>& BucketPendingAvatars : PendingAvatars) {
+		for (TPair<FString, FPendingAvatar>& PendingAvatar : BucketPendingAvatars) {
+			if (PendingAvatar.Value.Callbacks.Remove(RequestHandle.Id) > 0) {
+				return;
+			}
+		}
+	}
+}
+
+void FMultiplayerAvatarService::Flush()
+{
+	++Generation;
+	for (TLruCache<FString, TObjectPtr<UTexture2D>>& Cache : Caches) {
+		Cache.Empty(Cache.Max());
+	}
+	FailPendingAvatars();
+}
+
+void FMultiplayerAvatarService::FailPendingAvatars()
+{
+	//Callbacks may request again, so they run once the maps are cleared
+	TArray<FMultiplayerOnAvatarReady> Callbacks;
+	for (TMap<FString, FPendingAvatar>& BucketPendingAvatars : PendingAvatars) {
+		for (TPair<FString, FPendingAvatar>& PendingAvatar : BucketPendingAvatars) {
+			for (TPair<uint32, FMultiplayerOnAvatarReady>& Callback : PendingAvatar.Value.Callbacks) {
+				Callbacks.Add(MoveTemp(Callback.Value));
+			}
+		}
+		BucketPendingAvatars.Reset();
+	}
+	for (const FMultiplayerOnAvatarReady& Callback : Callbacks) {
+		Callback.ExecuteIfBound(nullptr);
+	}
+}
+
+bool FMultiplayerAvatarService::DecodeAvatar(IImageWrapperModule* ImageWrapperModule, const FMultiplayerAvatarPixels& Pixels, int32 Dimension, TArray<FColor>& OutPixels)
+{
+	TArray<FColor> SourcePixels;
+	int32 Width = Pixels.Width;
+	int32 Height = Pixels.Height;
+
+	if (Pixels.bCompressed) {
+		const EImageFormat ImageFormat = ImageWrapperModule->DetectImageFormat(Pixels.Data.GetData(), Pixels.Data.Num());
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageFormat != EImageFormat::Invalid ? ImageWrapperModule->CreateImageWrapper(ImageFormat) : nullptr;
+		TArray<uint8> RawPixels;
+		if (!ImageWrapper || !ImageWrapper->SetCompressed(Pixels.Data.GetData(), Pixels.Data.Num()) || !ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, RawPixels)) {
+			return false;
+		}
+		Width = ImageWrapper->GetWidth();
+		Height = ImageWrapper->GetHeight();
+		if (RawPixels.Num() != Width * Height * int32(sizeof(FColor))) {
+			return false;
+		}
+		SourcePixels.SetNumUninitialized(Width * Height);
+		FMemory::Memcpy(SourcePixels.GetData(), RawPixels.GetData(), RawPixels.Num());
+	}
+	else {
+		if (Width <= 0 || Height <= 0 || Pixels.Data.Num() != Width * Height * 4) {
+			return false;
+		}
+		//RGBA to the BGRA layout of FColor
+		SourcePixels.SetNumUninitialized(Width * Height);
+		const uint8* Source = Pixels.Data.GetData();
+		for (FColor& Pixel : SourcePixels) {
+			Pixel = FColor(Source[0], Source[1], Source[2], Source[3]);
+			Source += 4;
+		}
+	}
+
+	if (Width == Dimension && Height == Dimension) {
+		OutPixels = MoveTemp(SourcePixels);
+	}
+	else {
+		FImageUtils::ImageResize(Width, Height, SourcePixels, Dimension, Dimension, OutPixels, false, false);
+	}
+	return OutPixels.Num() == Dimension * Dimension;
+}
+
+UTexture2D* FMultiplayerAvatarService::CreateAvatarTexture(const TArray<FColor>& Pixels, int32 Dimension)
+{
+	UTexture2D* Avatar = UTexture2D::CreateTransient(Dimension, Dimension, PF_B8G8R8A8);
+	if (!Avatar) {
+		return nullptr;
+	}
+
+	FTexture2DMipMap& Mip = Avatar->GetPlatformData()->Mips[0];
+	void* MipData = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(MipData, Pixels.GetData(), Pixels.Num() * sizeof(FColor));
+	Mip.BulkData.Unlock();
+	Avatar->UpdateResource();
+	return Avatar;
+}
+
+bool FMultiplayerAvatarService::TickUploads(float DeltaTime)
+{
+	TUniquePtr<FDecodedAvatar> DecodedAvatar;
+	for (int32 Uploads = 0; Uploads < MaxUploadsPerTick && DecodedAvatars->Dequeue(DecodedAvatar); ++Uploads) {
+		//Flushed while it was being fetched. A request for the same user made after the flush waits for its own result
+		FPendingAvatar PendingAvatar;
+		if (DecodedAvatar->Generation != Generation || !PendingAvatars[DecodedAvatar->BucketIndex].RemoveAndCopyValue(DecodedAvatar->UserKey, PendingAvatar)) {
+			continue;
+		}
+
+		const int32 Dimension = GetAvatarDimension(static_cast<SteamAvatarSize>(DecodedAvatar->BucketIndex + 1));
+		UTexture2D* Avatar = DecodedAvatar->bWasSuccessful ? CreateAvatarTexture(DecodedAvatar->Pixels, Dimension) : nullptr;
+		if (Avatar) {
+			Caches[DecodedAvatar->BucketIndex].Add(DecodedAvatar->UserKey, Avatar);
+		}
+		else {
+			UE_LOG(LogMultiplayerSession, Verbose, TEXT("No avatar for %s in FMultiplayerAvatarService::TickUploads"), *DecodedAvatar->UserKey);
+		}
+
+		for (const TPair<uint32, FMultiplayerOnAvatarReady>& Callback : PendingAvatar.Callbacks) {
+			Callback.Value.ExecuteIfBound(Avatar);
+		}
+	}
+	return true;
+}
+
+int32 FMultiplayerAvatarService::GetNumCachedAvatars() const
+{
+	int32 NumCachedAvatars = 0;
+	for (const TLruCache<FString, TObjectPtr<UTexture2D>>& Cache : Caches) {
+		NumCachedAvatars += Cache.Num();
+	}
+	return NumCachedAvatars;
+}
+
+int64 FMultiplayerAvatarService::GetCachedBytes() const
+{
+	int64 CachedBytes = 0;
+	for (int32 BucketIndex = 0; BucketIndex < NumBuckets; ++BucketIndex) {
+		const int32 Dimension = GetAvatarDimension(static_cast<SteamAvatarSize>(BucketIndex + 1));
+		CachedBytes += int64(Caches[BucketIndex].Num()) * Dimension * Dimension * sizeof(FColor);
+	}
+	return CachedBytes;
+}
+
+void FMultiplayerAvatarService::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (TLruCache<FString, TObjectPtr<UTexture2D>>& Cache : Caches) {
+		for (TLruCache<FString, TObjectPtr<UTexture2D>>::TIterator It(Cache); It; ++It) {
+			Collector.AddReferencedObject(It.Value());
+		}
+	}
+}
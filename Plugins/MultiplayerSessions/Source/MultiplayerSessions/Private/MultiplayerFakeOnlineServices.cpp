@@ -0,0 +1,784 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerFakeOnlineServices.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerSessionSearchFilter.h"
+#include "OnlineSubsystemTypes.h"
+#include "Online/OnlineSessionNames.h"
+#include "Containers/Ticker.h"
+#include "Tasks/Task.h"
+
+#if !UE_BUILD_SHIPPING
+
+static const FName FakeNetIdType(TEXT("Fake"));
+
+FMultiplayerFakeOnlineBackendRef FMultiplayerFakeOnlineBackend::Create(const FMultiplayerFakeOnlineSettings& Settings)
+{
+	return MakeShareable(new FMultiplayerFakeOnlineBackend(Settings));
+}
+
+FMultiplayerFakeOnlineBackend::FMultiplayerFakeOnlineBackend(const FMultiplayerFakeOnlineSettings& InSettings) :
+	Settings(InSettings),
+	Random(InSettings.RandomSeed),
+	LocalUserId(FUniqueNetIdString::Create(TEXT("FakeLocalUser"), FakeNetIdType))
+{
+}
+
+FMultiplayerOnlineServices FMultiplayerFakeOnlineBackend::MakeServices()
+{
+	FMultiplayerOnlineServices Services;
+	Services.Session = MakeShared<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe>(AsShared());
+	TSharedRef<FMultiplayerFakeOnlineFriends, ESPMode::ThreadSafe> Friends = MakeShared<FMultiplayerFakeOnlineFriends, ESPMode::ThreadSafe>(AsShared());
+	TSharedRef<FMultiplayerFakeOnlinePresence, ESPMode::ThreadSafe> Presence = MakeShared<FMultiplayerFakeOnlinePresence, ESPMode::ThreadSafe>(AsShared(), Friends);
+	Presence->StartPresenceEvents();
+	Services.Friends = Friends;
+	Services.Presence = Presence;
+	Services.LocalUserId = LocalUserId;
+	return Services;
+}
+
+FMultiplayerAvatarProviderPtr FMultiplayerFakeOnlineBackend::MakeAvatarProvider()
+{
+	return MakeShared<FMultiplayerFakeAvatarProvider, ESPMode::ThreadSafe>(AsShared());
+}
+
+bool FMultiplayerFakeOnlineBackend::RollFailure()
+{
+	return Settings.FailureRate > 0.f && Random.FRand() < Settings.FailureRate;
+}
+
+void FMultiplayerFakeOnlineBackend::Complete(FName CallName, TFunction<void()>&& Completion)
+{
+	const float MinLatency = FMath::Max(Settings.MinLatencySeconds, 0.f);
+	const float Delay = Random.FRandRange(MinLatency, FMath::Max(Settings.MaxLatencySeconds, MinLatency));
+
+	TWeakPtr<FMultiplayerFakeOnlineBackend, ESPMode::ThreadSafe> WeakBackend = AsShared();
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakBackend, CallName, Completion = MoveTemp(Completion)](float DeltaTime) {
+		if (TSharedPtr<FMultiplayerFakeOnlineBackend, ESPMode::ThreadSafe> PinnedBackend = WeakBackend.Pin()) {
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Completion();
+			PinnedBackend->RecordHandlerTime(CallName, FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+		}
+		return false;
+	}), Delay);
+}
+
+void FMultiplayerFakeOnlineBackend::DumpHandlerTimesToLog() const
+{
+	UE_LOG(LogMultiplayerSession, Display, TEXT("%-28s %6s %9s %9s %9s %9s %9s"), TEXT("Completion handler"), TEXT("Count"), TEXT("Avg"), TEXT("p50"), TEXT("p95"), TEXT("p99"), TEXT("Max"));
+	for (const TPair<FName, FMultiplayerLatencyHistogram>& HandlerTime : HandlerTimes) {
+		const FMultiplayerLatencyHistogram& Histogram = HandlerTime.Value;
+		UE_LOG(LogMultiplayerSession, Display, TEXT("%-28s %6d %9.3f %9.3f %9.3f %9.3f %9.3f"), *HandlerTime.Key.ToString(), Histogram.Count,
+			Histogram.GetAverage(), Histogram.GetPercentile(50.0), Histogram.GetPercentile(95.0), Histogram.GetPercentile(99.0), Histogram.MaxMs);
+	}
+}
+
+FUniqueNetIdPtr FMultiplayerFakeOnlineSession::CreateSessionIdFromString(const FString& SessionIdStr)
+{
+	return FUniqueNetIdString::Create(SessionIdStr, FakeNetIdType);
+}
+
+FNamedOnlineSession* FMultiplayerFakeOnlineSession::GetNamedSession(FName SessionName)
+{
+	for (const TSharedRef<FNamedOnlineSession>& Session : Sessions) {
+		if (Session->SessionName == SessionName) {
+			return &Session.Get();
+		}
+	}
+	return nullptr;
+}
+
+void FMultiplayerFakeOnlineSession::RemoveNamedSession(FName SessionName)
+{
+	Sessions.RemoveAll([SessionName](const TSharedRef<FNamedOnlineSession>& Session) { return Session->SessionName == SessionName; });
+}
+
+EOnlineSessionState::Type FMultiplayerFakeOnlineSession::GetSessionState(FName SessionName) const
+{
+	const TSharedRef<FNamedOnlineSession>* Session = Sessions.FindByPredicate([SessionName](const TSharedRef<FNamedOnlineSession>& Session) { return Session->SessionName == SessionName; });
+	return Session ? (*Session)->SessionState : EOnlineSessionState::NoSession;
+}
+
+bool FMultiplayerFakeOnlineSession::HasPresenceSession()
+{
+	return Sessions.ContainsByPredicate([](const TSharedRef<FNamedOnlineSession>& Session) { return Session->SessionSettings.bUsesPresence; });
+}
+
+FNamedOnlineSession* FMultiplayerFakeOnlineSession::AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings)
+{
+	return &Sessions.Add_GetRef(MakeShared<FNamedOnlineSession>(SessionName, SessionSettings)).Get();
+}
+
+FNamedOnlineSession* FMultiplayerFakeOnlineSession::AddNamedSession(FName SessionName, const FOnlineSession& Session)
+{
+	return &Sessions.Add_GetRef(MakeShared<FNamedOnlineSession>(SessionName, Session)).Get();
+}
+
+FUniqueNetIdRef FMultiplayerFakeOnlineSession::MakeSessionId()
+{
+	return FUniqueNetIdString::Create(FString::Printf(TEXT("FakeSession%u"), NextSessionId++), FakeNetIdType);
+}
+
+bool FMultiplayerFakeOnlineSession::CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	return CreateSession(*Backend->GetLocalUserId(), SessionName, NewSessionSettings);
+}
+
+bool FMultiplayerFakeOnlineSession::CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	if (GetNamedSession(SessionName)) {
+		return false;
+	}
+
+	FNamedOnlineSession* Session = AddNamedSession(SessionName, NewSessionSettings);
+	Session->SessionState = EOnlineSessionState::Creating;
+	Session->bHosting = true;
+	Session->OwningUserId = HostingPlayerId.AsShared();
+	Session->LocalOwnerId = HostingPlayerId.AsShared();
+	Session->NumOpenPublicConnections = NewSessionSettings.NumPublicConnections;
+	Session->NumOpenPrivateConnections = NewSessionSettings.NumPrivateConnections;
+	Session->SessionInfo = MakeShared<FMultiplayerFakeSessionInfo>(MakeSessionId());
+
+	TWeakPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Backend->Complete(TEXT("CreateSession"), [WeakThis, SessionName]() {
+		TSharedPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> This = WeakThis.Pin();
+		FNamedOnlineSession* CreatedSession = This ? This->GetNamedSession(SessionName) : nullptr;
+		if (!CreatedSession) {
+			return;
+		}
+		const bool bWasSuccessful = !This->Backend->RollFailure();
+		if (bWasSuccessful) {
+			CreatedSession->SessionState = EOnlineSessionState::Pending;
+		}
+		else {
+			This->RemoveNamedSession(SessionName);
+		}
+		This->TriggerOnCreateSessionCompleteDelegates(SessionName, bWasSuccessful);
+	});
+	return true;
+}
+
+bool FMultiplayerFakeOnlineSession::StartSession(FName SessionName)
+{
+	if (!GetNamedSession(SessionName)) {
+		return false;
+	}
+
+	TWeakPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Backend->Complete(TEXT("StartSession"), [WeakThis, SessionName]() {
+		TSharedPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> This = WeakThis.Pin();
+		FNamedOnlineSession* Session = This ? This->GetNamedSession(SessionName) : nullptr;
+		if (!This) {
+			return;
+		}
+		const bool bWasSuccessful = Session && !This->Backend->RollFailure();
+		if (bWasSuccessful) {
+			Session->SessionState = EOnlineSessionState::InProgress;
+		}
+		This->TriggerOnStartSessionCompleteDelegates(SessionName, bWasSuccessful);
+	});
+	return true;
+}
+
+bool FMultiplayerFakeOnlineSession::UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (!Session) {
+		return false;
+	}
+	Session->SessionSettings = UpdatedSessionSettings;
+
+	TWeakPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Backend->Complete(TEXT("UpdateSession"), [WeakThis, SessionName]() {
+		if (TSharedPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> This = WeakThis.Pin()) {
+			This->TriggerOnUpdateSessionCompleteDelegates(SessionName, !This->Backend->RollFailure());
+		}
+	});
+	return true;
+}
+
+bool FMultiplayerFakeOnlineSession::EndSession(FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (!Session) {
+		return false;
+	}
+	Session->SessionState = EOnlineSessionState::Ended;
+
+	TWeakPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Backend->Complete(TEXT("EndSession"), [WeakThis, SessionName]() {
+		if (TSharedPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> This = WeakThis.Pin()) {
+			This->TriggerOnEndSessionCompleteDelegates(SessionName, true);
+		}
+	});
+	return true;
+}
+
+bool FMultiplayerFakeOnlineSession::DestroySession(FName SessionName, const FOnDestroySessionCompleteDelegate& CompletionDelegate)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (!Session) {
+		return false;
+	}
+	Session->SessionState = EOnlineSessionState::Destroying;
+
+	TWeakPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Backend->Complete(TEXT("DestroySession"), [WeakThis, SessionName, CompletionDelegate]() {
+		TSharedPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> This = WeakThis.Pin();
+		if (!This) {
+			return;
+		}
+		//Destroying never fails on real backends either, the local session goes away regardless
+		This->RemoveNamedSession(SessionName);
+		CompletionDelegate.ExecuteIfBound(SessionName, true);
+		This->TriggerOnDestroySessionCompleteDelegates(SessionName, true);
+	});
+	return true;
+}
+
+bool FMultiplayerFakeOnlineSession::IsPlayerInSession(FName SessionName, const FUniqueNetId& UniqueId)
+{
+	const FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	return Session && Session->RegisteredPlayers.ContainsByPredicate([&UniqueId](const FUniqueNetIdRef& PlayerId) { return *PlayerId == UniqueId; });
+}
+
+bool FMultiplayerFakeOnlineSession::StartMatchmaking(const TArray<FUniqueNetIdRef>& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineSession::CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineSession::CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineSession::FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	return FindSessions(*Backend->GetLocalUserId(), SearchSettings);
+}
+
+bool FMultiplayerFakeOnlineSession::FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	if (CurrentSearch.IsValid()) {
+		return false;
+	}
+
+	CurrentSearch = SearchSettings;
+	SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+	SearchSettings->SearchResults.Reset();
+
+	const uint32 Serial = ++SearchSerial;
+	TWeakPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Backend->Complete(TEXT("FindSessions"), [WeakThis, Serial]() {
+		TSharedPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> This = WeakThis.Pin();
+		if (!This || This->SearchSerial != Serial || !This->CurrentSearch.IsValid()) {
+			return;
+		}
+		const TSharedRef<FOnlineSessionSearch> Search = This->CurrentSearch.ToSharedRef();
+		This->CurrentSearch.Reset();
+
+		const bool bWasSuccessful = !This->Backend->RollFailure();
+		if (bWasSuccessful) {
+			This->MakeSearchResults(*Search);
+		}
+		Search->SearchState = bWasSuccessful ? EOnlineAsyncTaskState::Done : EOnlineAsyncTaskState::Failed;
+		This->TriggerOnFindSessionsCompleteDelegates(bWasSuccessful);
+	});
+	return true;
+}
+
+void FMultiplayerFakeOnlineSession::MakeSearchResults(FOnlineSessionSearch& Search)
+{
+	FRandomStream& Random = Backend->GetRandom();
+	const int32 NumResults = Search.MaxSearchResults > 0 ? FMath::Min(Backend->GetSettings().NumSearchResults, Search.MaxSearchResults) : Backend->GetSettings().NumSearchResults;
+
+	//Results echo the filtered values so they pass the same checks real, backend filtered results would
+	FString MatchType(TEXT("Default"));
+	int32 BuildId = 0;
+	int32 MinOpenSlots = 0;
+	Search.QuerySettings.Get(MULTIPLAYER_SETTING_MATCHTYPE, MatchType);
+	Search.QuerySettings.Get(MULTIPLAYER_SETTING_BUILDID, BuildId);
+	Search.QuerySettings.Get(SEARCH_MINSLOTSAVAILABLE, MinOpenSlots);
+
+	static const TCHAR* const Regions[] = { TEXT("EU"), TEXT("NA"), TEXT("ASIA") };
+
+	Search.SearchResults.Reserve(NumResults);
+	for (int32 Index = 0; Index < NumResults; ++Index) {
+		FOnlineSessionSearchResult& Result = Search.SearchResults.AddDefaulted_GetRef();
+		Result.PingInMs = Random.RandRange(10, 250);
+
+		FOnlineSession& Session = Result.Session;
+		Session.OwningUserId = FUniqueNetIdString::Create(FString::Printf(TEXT("FakeHost%d"), Index), FakeNetIdType);
+		Session.OwningUserName = FString::Printf(TEXT("FakeHost%d"), Index);
+		Session.SessionInfo = MakeShared<FMultiplayerFakeSessionInfo>(MakeSessionId());
+		Session.SessionSettings.NumPublicConnections = Random.RandRange(FMath::Max(MinOpenSlots, 2), 16);
+		Session.NumOpenPublicConnections = Random.RandRange(MinOpenSlots, Session.SessionSettings.NumPublicConnections);
+		Session.SessionSettings.bIsLANMatch = Search.bIsLanQuery;
+		Session.SessionSettings.Set(MULTIPLAYER_SETTING_MATCHTYPE, MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+		Session.SessionSettings.Set(MULTIPLAYER_SETTING_REGION, FString(Regions[Random.RandRange(0, static_cast<int32>(UE_ARRAY_COUNT(Regions)) - 1)]), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+		if (BuildId != 0) {
+			Session.SessionSettings.Set(MULTIPLAYER_SETTING_BUILDID, BuildId, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+		}
+	}
+}
+
+bool FMultiplayerFakeOnlineSession::FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineSession::CancelFindSessions()
+{
+	if (!CurrentSearch.IsValid()) {
+		return false;
+	}
+	CurrentSearch->SearchState = EOnlineAsyncTaskState::Failed;
+	CurrentSearch.Reset();
+	++SearchSerial;
+
+	TWeakPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Backend->Complete(TEXT("CancelFindSessions"), [WeakThis]() {
+		if (TSharedPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> This = WeakThis.Pin()) {
+			This->TriggerOnCancelFindSessionsCompleteDelegates(true);
+		}
+	});
+	return true;
+}
+
+bool FMultiplayerFakeOnlineSession::PingSearchResults(const FOnlineSessionSearchResult& SearchResult)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineSession::JoinSession(int32 LocalUserNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	return JoinSession(*Backend->GetLocalUserId(), SessionName, DesiredSession);
+}
+
+bool FMultiplayerFakeOnlineSession::JoinSession(const FUniqueNetId& LocalUserId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	TWeakPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	const FUniqueNetIdRef JoiningUserId = LocalUserId.AsShared();
+	Backend->Complete(TEXT("JoinSession"), [WeakThis, SessionName, DesiredSession, JoiningUserId]() {
+		TSharedPtr<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe> This = WeakThis.Pin();
+		if (!This) {
+			return;
+		}
+
+		EOnJoinSessionCompleteResult::Type Result = EOnJoinSessionCompleteResult::Success;
+		if (This->GetNamedSession(SessionName)) {
+			Result = EOnJoinSessionCompleteResult::AlreadyInSession;
+		}
+		else if (!DesiredSession.IsValid()) {
+			Result = EOnJoinSessionCompleteResult::SessionDoesNotExist;
+		}
+		else if (DesiredSession.Session.NumOpenPublicConnections <= 0) {
+			Result = EOnJoinSessionCompleteResult::SessionIsFull;
+		}
+		else if (This->Backend->RollFailure()) {
+			Result = EOnJoinSessionCompleteResult::CouldNotRetrieveAddress;
+		}
+
+		if (Result == EOnJoinSessionCompleteResult::Success) {
+			FNamedOnlineSession* Session = This->AddNamedSession(SessionName, DesiredSession.Session);
+			Session->SessionState = EOnlineSessionState::Pending;
+			Session->bHosting = false;
+			Session->LocalOwnerId = JoiningUserId;
+		}
+		This->TriggerOnJoinSessionCompleteDelegates(SessionName, Result);
+	});
+	return true;
+}
+
+bool FMultiplayerFakeOnlineSession::FindFriendSession(int32 LocalUserNum, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineSession::FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineSession::FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& FriendList)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineSession::SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend)
+{
+	return GetNamedSession(SessionName) && !Backend->RollFailure();
+}
+
+bool FMultiplayerFakeOnlineSession::SendSessionInviteToFriend(const FUniqueNetId& LocalUserId, FName SessionName, const FUniqueNetId& Friend)
+{
+	return SendSessionInviteToFriend(0, SessionName, Friend);
+}
+
+bool FMultiplayerFakeOnlineSession::SendSessionInviteToFriends(int32 LocalUserNum, FName SessionName, const TArray<FUniqueNetIdRef>& Friends)
+{
+	return GetNamedSession(SessionName) && !Backend->RollFailure();
+}
+
+bool FMultiplayerFakeOnlineSession::SendSessionInviteToFriends(const FUniqueNetId& LocalUserId, FName SessionName, const TArray<FUniqueNetIdRef>& Friends)
+{
+	return SendSessionInviteToFriends(0, SessionName, Friends);
+}
+
+bool FMultiplayerFakeOnlineSession::GetResolvedConnectString(FName SessionName, FString& ConnectInfo, FName PortType)
+{
+	if (!GetNamedSession(SessionName)) {
+		return false;
+	}
+	ConnectInfo = TEXT("127.0.0.1:7777");
+	return true;
+}
+
+bool FMultiplayerFakeOnlineSession::GetResolvedConnectString(const FOnlineSessionSearchResult& SearchResult, FName PortType, FString& ConnectInfo)
+{
+	if (!SearchResult.IsValid()) {
+		return false;
+	}
+	ConnectInfo = TEXT("127.0.0.1:7777");
+	return true;
+}
+
+FOnlineSessionSettings* FMultiplayerFakeOnlineSession::GetSessionSettings(FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	return Session ? &Session->SessionSettings : nullptr;
+}
+
+bool FMultiplayerFakeOnlineSession::RegisterPlayer(FName SessionName, const FUniqueNetId& PlayerId, bool bWasInvited)
+{
+	TArray<FUniqueNetIdRef> Players;
+	Players.Add(PlayerId.AsShared());
+	return RegisterPlayers(SessionName, Players, bWasInvited);
+}
+
+bool FMultiplayerFakeOnlineSession::RegisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players, bool bWasInvited)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session) {
+		for (const FUniqueNetIdRef& PlayerId : Players) {
+			if (!IsPlayerInSession(SessionName, *PlayerId)) {
+				Session->RegisteredPlayers.Add(PlayerId);
+			}
+		}
+	}
+	TriggerOnRegisterPlayersCompleteDelegates(SessionName, Players, Session != nullptr);
+	return Session != nullptr;
+}
+
+bool FMultiplayerFakeOnlineSession::UnregisterPlayer(FName SessionName, const FUniqueNetId& PlayerId)
+{
+	TArray<FUniqueNetIdRef> Players;
+	Players.Add(PlayerId.AsShared());
+	return UnregisterPlayers(SessionName, Players);
+}
+
+bool FMultiplayerFakeOnlineSession::UnregisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session) {
+		for (const FUniqueNetIdRef& PlayerId : Players) {
+			Session->RegisteredPlayers.RemoveAll([&PlayerId](const FUniqueNetIdRef& RegisteredId) { return *RegisteredId == *PlayerId; });
+		}
+	}
+	TriggerOnUnregisterPlayersCompleteDelegates(SessionName, Players, Session != nullptr);
+	return Session != nullptr;
+}
+
+void FMultiplayerFakeOnlineSession::RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate)
+{
+	Delegate.ExecuteIfBound(PlayerId, EOnJoinSessionCompleteResult::Success);
+}
+
+void FMultiplayerFakeOnlineSession::UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate)
+{
+	Delegate.ExecuteIfBound(PlayerId, true);
+}
+
+void FMultiplayerFakeOnlineSession::RemovePlayerFromSession(int32 LocalUserNum, FName SessionName, const FUniqueNetId& TargetPlayerId)
+{
+	UnregisterPlayer(SessionName, TargetPlayerId);
+}
+
+void FMultiplayerFakeOnlineSession::DumpSessionState()
+{
+	for (const TSharedRef<FNamedOnlineSession>& Session : Sessions) {
+		UE_LOG(LogMultiplayerSession, Display, TEXT("Fake session %s: %s, %d registered players"), *Session->SessionName.ToString(), EOnlineSessionState::ToString(Session->SessionState), Session->RegisteredPlayers.Num());
+	}
+}
+
+bool FMultiplayerFakeOnlineFriends::ReadFriendsList(int32 LocalUserNum, const FString& ListName, const FOnReadFriendsListComplete& Delegate)
+{
+	TWeakPtr<FMultiplayerFakeOnlineFriends, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Backend->Complete(TEXT("ReadFriendsList"), [WeakThis, LocalUserNum, ListName, Delegate]() {
+		TSharedPtr<FMultiplayerFakeOnlineFriends, ESPMode::ThreadSafe> This = WeakThis.Pin();
+		if (!This) {
+			return;
+		}
+		if (This->Backend->RollFailure()) {
+			Delegate.ExecuteIfBound(LocalUserNum, false, ListName, TEXT("Simulated failure"));
+			return;
+		}
+
+		if (This->FriendsList.IsEmpty()) {
+			This->GenerateFriends();
+		}
+		else {
+			This->ChurnFriends();
+		}
+		Delegate.ExecuteIfBound(LocalUserNum, true, ListName, FString());
+	});
+	return true;
+}
+
+void FMultiplayerFakeOnlineFriends::GenerateFriends()
+{
+	const int32 NumFriends = FMath::Max(Backend->GetSettings().NumFriends, 0);
+	FriendsList.Reserve(NumFriends);
+	FriendsById.Reserve(NumFriends);
+
+	FRandomStream& Random = Backend->GetRandom();
+	for (int32 Index = 0; Index < NumFriends; ++Index) {
+		const TSharedRef<FMultiplayerFakeOnlineFriend> Friend = MakeShared<FMultiplayerFakeOnlineFriend>(
+			FUniqueNetIdString::Create(FString::Printf(TEXT("FakeFriend%d"), Index), FakeNetIdType), FString::Printf(TEXT("Friend %d"), Index));
+		Friend->Presence.bIsOnline = Random.FRand() < 0.3f;
+		Friend->Presence.bIsPlayingThisGame = Friend->Presence.bIsOnline && Random.FRand() < 0.5f;
+		Friend->Presence.Status.State = Friend->Presence.bIsOnline ? EOnlinePresenceState::Online : EOnlinePresenceState::Offline;
+
+		FriendsList.Add(Friend);
+		FriendsById.Add(Friend->GetUserId(), Friend);
+	}
+}
+
+void FMultiplayerFakeOnlineFriends::ChurnFriends()
+{
+	const int32 NumChanges = FMath::RoundToInt32(FriendsList.Num() * FMath::Clamp(Backend->GetSettings().FriendChurnRate, 0.f, 1.f));
+	for (int32 Change = 0; Change < NumChanges; ++Change) {
+		ChangeRandomFriendPresence();
+	}
+}
+
+TSharedPtr<FMultiplayerFakeOnlineFriend> FMultiplayerFakeOnlineFriends::ChangeRandomFriendPresence()
+{
+	if (FriendsList.IsEmpty()) {
+		return nullptr;
+	}
+
+	const FUniqueNetIdRef FriendId = FriendsList[Backend->GetRandom().RandRange(0, FriendsList.Num() - 1)]->GetUserId();
+	const TSharedRef<FMultiplayerFakeOnlineFriend>& Friend = FriendsById.FindChecked(FriendId);
+	FOnlineUserPresence& Presence = Friend->Presence;
+	Presence.bIsOnline = !Presence.bIsOnline;
+	Presence.Status.State = Presence.bIsOnline ? EOnlinePresenceState::Online : EOnlinePresenceState::Offline;
+	return Friend;
+}
+
+bool FMultiplayerFakeOnlineFriends::DeleteFriendsList(int32 LocalUserNum, const FString& ListName, const FOnDeleteFriendsListComplete& Delegate)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::SendInvite(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName, const FOnSendInviteComplete& Delegate)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::AcceptInvite(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName, const FOnAcceptInviteComplete& Delegate)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::RejectInvite(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName)
+{
+	return false;
+}
+
+void FMultiplayerFakeOnlineFriends::SetFriendAlias(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName, const FString& Alias, const FOnSetFriendAliasComplete& Delegate)
+{
+	Delegate.ExecuteIfBound(LocalUserNum, FriendId, ListName, FOnlineError(false));
+}
+
+void FMultiplayerFakeOnlineFriends::DeleteFriendAlias(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName, const FOnDeleteFriendAliasComplete& Delegate)
+{
+	Delegate.ExecuteIfBound(LocalUserNum, FriendId, ListName, FOnlineError(false));
+}
+
+bool FMultiplayerFakeOnlineFriends::DeleteFriend(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::GetFriendsList(int32 LocalUserNum, const FString& ListName, TArray<TSharedRef<FOnlineFriend>>& OutFriends)
+{
+	OutFriends = FriendsList;
+	return true;
+}
+
+TSharedPtr<FOnlineFriend> FMultiplayerFakeOnlineFriends::GetFriend(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName)
+{
+	const TSharedRef<FMultiplayerFakeOnlineFriend>* Friend = FriendsById.Find(FriendId.AsShared());
+	return Friend ? TSharedPtr<FOnlineFriend>(*Friend) : nullptr;
+}
+
+bool FMultiplayerFakeOnlineFriends::IsFriend(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName)
+{
+	return FriendsById.Contains(FriendId.AsShared());
+}
+
+void FMultiplayerFakeOnlineFriends::AddRecentPlayers(const FUniqueNetId& UserId, const TArray<FReportPlayedWithUser>& InRecentPlayers, const FString& ListName, const FOnAddRecentPlayersComplete& InCompletionDelegate)
+{
+	InCompletionDelegate.ExecuteIfBound(UserId, FOnlineError(false));
+}
+
+bool FMultiplayerFakeOnlineFriends::QueryRecentPlayers(const FUniqueNetId& UserId, const FString& Namespace)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::GetRecentPlayers(const FUniqueNetId& UserId, const FString& Namespace, TArray<TSharedRef<FOnlineRecentPlayer>>& OutRecentPlayers)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::BlockPlayer(int32 LocalUserNum, const FUniqueNetId& PlayerId)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::UnblockPlayer(int32 LocalUserNum, const FUniqueNetId& PlayerId)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::QueryBlockedPlayers(const FUniqueNetId& UserId)
+{
+	return false;
+}
+
+bool FMultiplayerFakeOnlineFriends::GetBlockedPlayers(const FUniqueNetId& UserId, TArray<TSharedRef<FOnlineBlockedPlayer>>& OutBlockedPlayers)
+{
+	return false;
+}
+
+FMultiplayerFakeOnlinePresence::~FMultiplayerFakeOnlinePresence()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+}
+
+void FMultiplayerFakeOnlinePresence::StartPresenceEvents()
+{
+	if (Backend->GetSettings().PresenceChangesPerSecond <= 0.f || TickerHandle.IsValid()) {
+		return;
+	}
+	TWeakPtr<FMultiplayerFakeOnlinePresence, ESPMode::ThreadSafe> WeakThis = AsShared();
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakThis](float DeltaTime) {
+		TSharedPtr<FMultiplayerFakeOnlinePresence, ESPMode::ThreadSafe> This = WeakThis.Pin();
+		return This && This->TickPresenceEvents(DeltaTime);
+	}));
+}
+
+bool FMultiplayerFakeOnlinePresence::TickPresenceEvents(float DeltaTime)
+{
+	TSharedPtr<FMultiplayerFakeOnlineFriends, ESPMode::ThreadSafe> PinnedFriends = Friends.Pin();
+	if (!PinnedFriends) {
+		return false;
+	}
+
+	PendingEvents += Backend->GetSettings().PresenceChangesPerSecond * DeltaTime;
+	for (; PendingEvents >= 1.f; PendingEvents -= 1.f) {
+		TSharedPtr<FMultiplayerFakeOnlineFriend> Friend = PinnedFriends->ChangeRandomFriendPresence();
+		if (!Friend) {
+			PendingEvents = 0.f;
+			break;
+		}
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		TriggerOnPresenceReceivedDelegates(*Friend->GetUserId(), MakeShared<FOnlineUserPresence>(Friend->Presence));
+		Backend->RecordHandlerTime(TEXT("PresenceReceived"), FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
+	return true;
+}
+
+void FMultiplayerFakeOnlinePresence::SetPresence(const FUniqueNetId& User, const FOnlineUserPresenceStatus& Status, const FOnPresenceTaskCompleteDelegate& Delegate)
+{
+	Backend->Complete(TEXT("SetPresence"), [UserId = User.AsShared(), Delegate]() {
+		Delegate.ExecuteIfBound(*UserId, false);
+	});
+}
+
+void FMultiplayerFakeOnlinePresence::QueryPresence(const FUniqueNetId& User, const FOnPresenceTaskCompleteDelegate& Delegate)
+{
+	Backend->Complete(TEXT("QueryPresence"), [UserId = User.AsShared(), Delegate]() {
+		Delegate.ExecuteIfBound(*UserId, false);
+	});
+}
+
+void FMultiplayerFakeOnlinePresence::QueryPresence(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& UserIds, const FOnPresenceTaskCompleteDelegate& Delegate)
+{
+	QueryPresence(LocalUserId, Delegate);
+}
+
+EOnlineCachedResult::Type FMultiplayerFakeOnlinePresence::GetCachedPresence(const FUniqueNetId& User, TSharedPtr<FOnlineUserPresence>& OutPresence)
+{
+	return EOnlineCachedResult::NotFound;
+}
+
+EOnlineCachedResult::Type FMultiplayerFakeOnlinePresence::GetCachedPresenceForApp(const FUniqueNetId& LocalUserId, const FUniqueNetId& User, const FString& AppId, TSharedPtr<FOnlineUserPresence>& OutPresence)
+{
+	return EOnlineCachedResult::NotFound;
+}
+
+void FMultiplayerFakeAvatarProvider::RequestAvatarPixels(const FUniqueNetId& UserId, SteamAvatarSize AvatarSize, FMultiplayerAvatarPixelsCallback&& Callback)
+{
+	const uint32 Seed = GetTypeHash(UserId.ToString());
+	TWeakPtr<FMultiplayerFakeOnlineBackend, ESPMode::ThreadSafe> WeakBackend = Backend;
+	Backend->Complete(TEXT("Avatar"), [WeakBackend, Seed, Callback = MoveTemp(Callback)]() {
+		TSharedPtr<FMultiplayerFakeOnlineBackend, ESPMode::ThreadSafe> PinnedBackend = WeakBackend.Pin();
+		if (!PinnedBackend || PinnedBackend->RollFailure()) {
+			Callback(false, FMultiplayerAvatarPixels());
+			return;
+		}
+		UE::Tasks::Launch(UE_SOURCE_LOCATION, [Seed, Callback]() {
+			Callback(true, MakeIdenticon(Seed));
+		});
+	});
+}
+
+FMultiplayerAvatarPixels FMultiplayerFakeAvatarProvider::MakeIdenticon(uint32 Seed)
+{
+	constexpr int32 NumCells = 5;
+	constexpr int32 CellSize = 8;
+
+	FMultiplayerAvatarPixels Pixels;
+	Pixels.Width = NumCells * CellSize;
+	Pixels.Height = NumCells * CellSize;
+	Pixels.Data.SetNumUninitialized(Pixels.Width * Pixels.Height * 4);
+
+	const FColor Foreground = FLinearColor::MakeFromHSV8(uint8(Seed >> 24), 160, 220).ToFColor(true);
+	const FColor Background(240, 240, 240, 255);
+	uint8* Pixel = Pixels.Data.GetData();
+	for (int32 Y = 0; Y < Pixels.Height; ++Y) {
+		for (int32 X = 0; X < Pixels.Width; ++X) {
+			//Left half picked from the seed bits, mirrored onto the right half
+			const int32 CellX = FMath::Min(X / CellSize, NumCells - 1 - X / CellSize);
+			const int32 CellY = Y / CellSize;
+			const FColor& Color = (Seed >> (CellY * 3 + CellX)) & 1 ? Foreground : Background;
+			Pixel[0] = Color.R;
+			Pixel[1] = Color.G;
+			Pixel[2] = Color.B;
+			Pixel[3] = Color.A;
+			Pixel += 4;
+		}
+	}
+	return Pixels;
+}
+
+#endif //!UE_BUILD_SHIPPING
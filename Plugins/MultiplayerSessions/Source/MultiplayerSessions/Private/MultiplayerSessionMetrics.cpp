@@ -0,0 +1,260 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionMetrics.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "Misc/FileHelper.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("MultiplayerSessions"), STATGROUP_MultiplayerSessions, STATCAT_Advanced);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Operations In Flight"), STAT_MultiplayerSessions_InFlight, STATGROUP_MultiplayerSessions);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Operations Completed"), STAT_MultiplayerSessions_Completed, STATGROUP_MultiplayerSessions);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Operations Failed"), STAT_MultiplayerSessions_Failed, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("CreateSession Last (ms)"), STAT_MultiplayerSessions_CreateSessionMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("FindSessions Last (ms)"), STAT_MultiplayerSessions_FindSessionsMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("JoinSession Last (ms)"), STAT_MultiplayerSessions_JoinSessionMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("DestroySession Last (ms)"), STAT_MultiplayerSessions_DestroySessionMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("StartSession Last (ms)"), STAT_MultiplayerSessions_StartSessionMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("ReadFriendsList Last (ms)"), STAT_MultiplayerSessions_ReadFriendsListMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("SendSessionInvite Last (ms)"), STAT_MultiplayerSessions_SendSessionInviteMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("QueryAchievements Last (ms)"), STAT_MultiplayerSessions_QueryAchievementsMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("QueryAchievementDescriptions Last (ms)"), STAT_MultiplayerSessions_QueryAchievementDescriptionsMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("WriteAchievements Last (ms)"), STAT_MultiplayerSessions_WriteAchievementsMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("ResolveConnectString Last (ms)"), STAT_MultiplayerSessions_ResolveConnectStringMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("PreloadMap Last (ms)"), STAT_MultiplayerSessions_PreloadMapMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("ConnectToSession Last (ms)"), STAT_MultiplayerSessions_ConnectToSessionMs, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("JoinToGame Last (ms)"), STAT_MultiplayerSessions_JoinToGameMs, STATGROUP_MultiplayerSessions);
+
+CSV_DEFINE_CATEGORY(MultiplayerSessions, true);
+
+namespace
+{
+	const TCHAR* const MetricNames[] = {
+		TEXT("CreateSession"),
+		TEXT("FindSessions"),
+		TEXT("JoinSession"),
+		TEXT("DestroySession"),
+		TEXT("StartSession"),
+		TEXT("ReadFriendsList"),
+		TEXT("SendSessionInvite"),
+		TEXT("QueryAchievements"),
+		TEXT("QueryAchievementDescriptions"),
+		TEXT("WriteAchievements"),
+		TEXT("ResolveConnectString"),
+		TEXT("PreloadMap"),
+		TEXT("ConnectToSession"),
+		TEXT("JoinToGame")
+	};
+	static_assert(UE_ARRAY_COUNT(MetricNames) == static_cast<int32>(EMultiplayerSessionMetric::Num), "Every metric needs a name");
+
+#if CSV_PROFILER
+	//The CSV profiler takes ANSI stat names
+	const char* const CsvStatNames[] = {
+		"CreateSessionMs",
+		"FindSessionsMs",
+		"JoinSessionMs",
+		"DestroySessionMs",
+		"StartSessionMs",
+		"ReadFriendsListMs",
+		"SendSessionInviteMs",
+		"QueryAchievementsMs",
+		"QueryAchievementDescriptionsMs",
+		"WriteAchievementsMs",
+		"ResolveConnectStringMs",
+		"PreloadMapMs",
+		"ConnectToSessionMs",
+		"JoinToGameMs"
+	};
+	static_assert(UE_ARRAY_COUNT(CsvStatNames) == static_cast<int32>(EMultiplayerSessionMetric::Num), "Every metric needs a CSV stat name");
+#endif
+
+	constexpr double BucketGrowth = 1.25;
+
+	void SetLatencyStat(EMultiplayerSessionMetric Metric, double LatencyMs)
+	{
+		switch (Metric) {
+		case EMultiplayerSessionMetric::CreateSession:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_CreateSessionMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::FindSessions:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_FindSessionsMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::JoinSession:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_JoinSessionMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::DestroySession:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_DestroySessionMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::StartSession:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_StartSessionMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::ReadFriendsList:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_ReadFriendsListMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::SendSessionInvite:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_SendSessionInviteMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::QueryAchievements:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_QueryAchievementsMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::QueryAchievementDescriptions:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_QueryAchievementDescriptionsMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::WriteAchievements:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_WriteAchievementsMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::ResolveConnectString:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_ResolveConnectStringMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::PreloadMap:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_PreloadMapMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::ConnectToSession:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_ConnectToSessionMs, LatencyMs);
+			break;
+		case EMultiplayerSessionMetric::JoinToGame:
+			SET_FLOAT_STAT(STAT_MultiplayerSessions_JoinToGameMs, LatencyMs);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void FMultiplayerLatencyHistogram::Add(double LatencyMs, bool bWasSuccessful)
+{
+	MinMs = Count > 0 ? FMath::Min(MinMs, LatencyMs) : LatencyMs;
+	MaxMs = Count > 0 ? FMath::Max(MaxMs, LatencyMs) : LatencyMs;
+	SumMs += LatencyMs;
+	++Count;
+	if (!bWasSuccessful) {
+		++Failures;
+	}
+	++Buckets[GetBucketIndex(LatencyMs)];
+}
+
+double FMultiplayerLatencyHistogram::GetPercentile(double Percentile) const
+{
+	if (Count == 0) {
+		return 0.0;
+	}
+
+	const int64 Rank = FMath::Max<int64>(FMath::CeilToInt64(FMath::Clamp(Percentile, 0.0, 100.0) / 100.0 * Count), 1);
+	int64 Seen = 0;
+	for (int32 Index = 0; Index < NumBuckets; ++Index) {
+		Seen += Buckets[Index];
+		if (Seen >= Rank) {
+			return FMath::Clamp(GetBucketUpperBound(Index), MinMs, MaxMs);
+		}
+	}
+	return MaxMs;
+}
+
+void FMultiplayerLatencyHistogram::Reset()
+{
+	*this = FMultiplayerLatencyHistogram();
+}
+
+int32 FMultiplayerLatencyHistogram::GetBucketIndex(double LatencyMs)
+{
+	if (LatencyMs <= 1.0) {
+		return 0;
+	}
+	const int32 Index = FMath::CeilToInt32(FMath::Loge(LatencyMs) / FMath::Loge(BucketGrowth));
+	return FMath::Clamp(Index, 0, NumBuckets - 1);
+}
+
+double FMultiplayerLatencyHistogram::GetBucketUpperBound(int32 BucketIndex)
+{
+	return FMath::Pow(BucketGrowth, static_cast<double>(BucketIndex));
+}
+
+FMultiplayerLatencyTimer FMultiplayerSessionMetrics::Start(EMultiplayerSessionMetric Metric)
+{
+	FMultiplayerLatencyTimer Timer;
+	Timer.Metric = Metric;
+	Timer.StartCycles = FPlatformTime::Cycles64();
+	Timer.RegionId = NextRegionId++;
+
+	TRACE_BEGIN_REGION(*GetRegionName(Timer));
+	INC_DWORD_STAT(STAT_MultiplayerSessions_InFlight);
+	return Timer;
+}
+
+void FMultiplayerSessionMetrics::Stop(FMultiplayerLatencyTimer& Timer, bool bWasSuccessful)
+{
+	if (!Timer.IsRunning() || Timer.Metric >= EMultiplayerSessionMetric::Num) {
+		return;
+	}
+
+	const double LatencyMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Timer.StartCycles);
+	const EMultiplayerSessionMetric Metric = Timer.Metric;
+	TRACE_END_REGION(*GetRegionName(Timer));
+	Timer = FMultiplayerLatencyTimer();
+
+	Histograms[static_cast<int32>(Metric)].Add(LatencyMs, bWasSuccessful);
+
+	DEC_DWORD_STAT(STAT_MultiplayerSessions_InFlight);
+	INC_DWORD_STAT(STAT_MultiplayerSessions_Completed);
+	if (!bWasSuccessful) {
+		INC_DWORD_STAT(STAT_MultiplayerSessions_Failed);
+	}
+	SetLatencyStat(Metric, LatencyMs);
+#if CSV_PROFILER
+	FCsvProfiler::RecordCustomStat(CsvStatNames[static_cast<int32>(Metric)], CSV_CATEGORY_INDEX(MultiplayerSessions), static_cast<float>(LatencyMs), ECsvCustomStatOp::Set);
+#endif
+
+	UE_LOG(LogMultiplayerSession, Verbose, TEXT("%s %s in %.1fms"), GetMetricName(Metric), bWasSuccessful ? TEXT("succeeded") : TEXT("failed"), LatencyMs);
+}
+
+void FMultiplayerSessionMetrics::Discard(FMultiplayerLatencyTimer& Timer)
+{
+	if (!Timer.IsRunning() || Timer.Metric >= EMultiplayerSessionMetric::Num) {
+		return;
+	}
+
+	TRACE_END_REGION(*GetRegionName(Timer));
+	Timer = FMultiplayerLatencyTimer();
+	DEC_DWORD_STAT(STAT_MultiplayerSessions_InFlight);
+}
+
+FString FMultiplayerSessionMetrics::GetRegionName(const FMultiplayerLatencyTimer& Timer)
+{
+	//Regions are matched by name, two searches in flight would otherwise end each other's region
+	return FString::Printf(TEXT("%s #%u"), GetMetricName(Timer.Metric), Timer.RegionId);
+}
+
+void FMultiplayerSessionMetrics::Reset()
+{
+	for (FMultiplayerLatencyHistogram& Histogram : Histograms) {
+		Histogram.Reset();
+	}
+}
+
+void FMultiplayerSessionMetrics::DumpToLog() const
+{
+	UE_LOG(LogMultiplayerSession, Display, TEXT("%-28s %6s %6s %9s %9s %9s %9s %9s %9s"), TEXT("Operation"), TEXT("Count"), TEXT("Failed"), TEXT("Min"), TEXT("Avg"), TEXT("p50"), TEXT("p95"), TEXT("p99"), TEXT("Max"));
+	for (int32 Index = 0; Index < static_cast<int32>(EMultiplayerSessionMetric::Num); ++Index) {
+		const FMultiplayerLatencyHistogram& Histogram = Histograms[Index];
+		UE_LOG(LogMultiplayerSession, Display, TEXT("%-28s %6d %6d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f"), MetricNames[Index], Histogram.Count, Histogram.Failures,
+			Histogram.MinMs, Histogram.GetAverage(), Histogram.GetPercentile(50.0), Histogram.GetPercentile(95.0), Histogram.GetPercentile(99.0), Histogram.MaxMs);
+	}
+}
+
+bool FMultiplayerSessionMetrics::WriteCsv(const FString& FilePath) const
+{
+	FString Csv = TEXT("operation,count,failed,min_ms,avg_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+	for (int32 Index = 0; Index < static_cast<int32>(EMultiplayerSessionMetric::Num); ++Index) {
+		const FMultiplayerLatencyHistogram& Histogram = Histograms[Index];
+		Csv += FString::Printf(TEXT("%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"), MetricNames[Index], Histogram.Count, Histogram.Failures,
+			Histogram.MinMs, Histogram.GetAverage(), Histogram.GetPercentile(50.0), Histogram.GetPercentile(95.0), Histogram.GetPercentile(99.0), Histogram.MaxMs);
+	}
+	return FFileHelper::SaveStringToFile(Csv, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
+
+const TCHAR* FMultiplayerSessionMetrics::GetMetricName(EMultiplayerSessionMetric Metric)
+{
+	return Metric < EMultiplayerSessionMetric::Num ? MetricNames[static_cast<int32>(Metric)] : TEXT("Unknown");
+}
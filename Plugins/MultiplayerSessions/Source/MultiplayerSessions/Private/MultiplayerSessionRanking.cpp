@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionRanking.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerSessionSearchFilter.h"
+
+float FMultiplayerSessionRanking::ScoreSession(const FOnlineSessionSearchResult& SessionResult, const FMultiplayerSessionRankingParams& Params)
+{
+	const int32 PingInMs = SessionResult.PingInMs >= MAX_QUERY_PING ? Params.UnknownPingInMs : SessionResult.PingInMs;
+	const int32 OpenSlots = FMath::Min(SessionResult.Session.NumOpenPublicConnections, Params.MaxCountedOpenSlots);
+
+	float Score = -Params.PingWeight * PingInMs + Params.OpenSlotWeight * OpenSlots;
+
+	const FOnlineSessionSettings& Settings = SessionResult.Session.SessionSettings;
+	FString Value;
+	if (!Params.MatchType.IsEmpty() && Settings.Get(MULTIPLAYER_SETTING_MATCHTYPE, Value) && Value == Params.MatchType) {
+		Score += Params.MatchTypeBonus;
+	}
+	if (!Params.Region.IsEmpty() && Settings.Get(MULTIPLAYER_SETTING_REGION, Value) && Value == Params.Region) {
+		Score += Params.RegionBonus;
+	}
+	return Score;
+}
+
+void FMultiplayerSessionRanking::RankSessions(TArrayView<const FOnlineSessionSearchResult> SessionResults, const FMultiplayerSessionRankingParams& Params, TArray<FMultiplayerRankedSession>& OutRankedSessions)
+{
+	OutRankedSessions.Reset(SessionResults.Num());
+
+	for (int32 Index = 0; Index < SessionResults.Num(); ++Index) {
+		const FOnlineSessionSearchResult& SessionResult = SessionResults[Index];
+		if (!UMultiplayerSessionsSubsystem::IsSessionJoinable(SessionResult)) {
+			continue;
+		}
+		if (Params.MaxPingInMs > 0 && SessionResult.PingInMs < MAX_QUERY_PING && SessionResult.PingInMs > Params.MaxPingInMs) {
+			continue;
+		}
+		OutRankedSessions.Add(FMultiplayerRankedSession{ Index, ScoreSession(SessionResult, Params) });
+	}
+
+	OutRankedSessions.Sort([](const FMultiplayerRankedSession& A, const FMultiplayerRankedSession& B) { return A.Score > B.Score; });
+}
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionSearchFilter.h"
+#include "Online/OnlineSessionNames.h"
+
+void FMultiplayerSessionSearchFilter::ApplyTo(FOnlineSessionSearch& Search) const
+{
+	Search.bIsLanQuery = bIsLanQuery;
+
+	if (HostType == EMultiplayerSessionHostType::ListenServer) {
+		Search.QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+		Search.QuerySettings.Set(SEARCH_LOBBIES, true, EOnlineComparisonOp::Equals);
+	}
+	else if (HostType == EMultiplayerSessionHostType::DedicatedServer) {
+		Search.QuerySettings.Set(SEARCH_DEDICATED_ONLY, true, EOnlineComparisonOp::Equals);
+	}
+	if (!MatchType.IsEmpty()) {
+		Search.QuerySettings.Set(MULTIPLAYER_SETTING_MATCHTYPE, MatchType, EOnlineComparisonOp::Equals);
+	}
+	if (!MapName.IsEmpty()) {
+		Search.QuerySettings.Set(SETTING_MAPNAME, MapName, EOnlineComparisonOp::Equals);
+	}
+	if (MinOpenSlots > 0) {
+		Search.QuerySettings.Set(SEARCH_MINSLOTSAVAILABLE, MinOpenSlots, EOnlineComparisonOp::GreaterThanEquals);
+	}
+	if (BuildId != 0) {
+		Search.QuerySettings.Set(MULTIPLAYER_SETTING_BUILDID, BuildId, EOnlineComparisonOp::Equals);
+	}
+}
+
+bool FMultiplayerSessionSearchFilter::operator==(const FMultiplayerSessionSearchFilter& Other) const
+{
+	return MatchType == Other.MatchType && MapName == Other.MapName && MinOpenSlots == Other.MinOpenSlots && BuildId == Other.BuildId
+		&& HostType == Other.HostType && bIsLanQuery == Other.bIsLanQuery;
+}
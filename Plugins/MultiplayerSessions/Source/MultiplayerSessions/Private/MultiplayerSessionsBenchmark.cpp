@@ -0,0 +1,335 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerFakeOnlineServices.h"
+#include "Containers/Ticker.h"
+#include "Engine/GameInstance.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Runs the subsystem's flows against FMultiplayerFakeOnlineBackend in a loop: friends read, avatars of a screen
+ * of friends, search, quick join, invite batch, destroy. Each step is issued on the tick after the previous one completed, like a menu would.
+ * A run that is still going at its deadline, or is told to, aborts and prints what it measured so far
+ */
+class FMultiplayerSessionsBenchmark : public TSharedFromThis<FMultiplayerSessionsBenchmark>
+{
+public:
+
+	FMultiplayerSessionsBenchmark(UMultiplayerSessionsSubsystem* InSubsystem, APlayerController* InPlayerController, const FMultiplayerFakeOnlineSettings& Settings, int32 InIterations, float InTimeoutSeconds) :
+		Subsystem(InSubsystem),
+		PlayerController(InPlayerController),
+		Backend(FMultiplayerFakeOnlineBackend::Create(Settings)),
+		Iterations(FMath::Max(InIterations, 1)),
+		TimeoutSeconds(InTimeoutSeconds)
+	{
+	}
+
+	void Start();
+	void Abort(const TCHAR* Reason);
+	bool IsRunning() const { return Step != EStep::Done; }
+
+private:
+
+	enum class EStep : uint8
+	{
+		ReadFriends,
+		FetchAvatars,
+		FindSessions,
+		QuickJoin,
+		SendInvites,
+		DestroySession,
+		Done
+	};
+
+	void ScheduleStep(EStep NextStep);
+	void RunStep();
+	bool CheckDeadline(float DeltaTime);
+	void Finish();
+
+	void OnGetFriendsListComplete(bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta);
+	void OnAvatarReady(UTexture2D* Avatar);
+	void OnFriendPresenceChanged(const TArray<FMultiplayerFriendPresenceChange>& Changes);
+	void OnFindSessionsComplete(const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful);
+	void OnJoinSessionComplete(EOnJoinSessionCompleteResult::Type Result);
+	void OnInvitesSent(FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results);
+	void OnDestroySessionComplete(bool bWasSuccessful);
+
+	TWeakObjectPtr<UMultiplayerSessionsSubsystem> Subsystem;
+	TWeakObjectPtr<APlayerController> PlayerController;
+	FMultiplayerFakeOnlineBackendRef Backend;
+	int32 Iterations{ 1 };
+	int32 Iteration{ 0 };
+	EStep Step{ EStep::ReadFriends };
+	double StartTime{ 0.0 };
+	//0 runs until every iteration is done
+	float TimeoutSeconds{ 0.f };
+	FTSTicker::FDelegateHandle DeadlineTickerHandle;
+	bool bFinished{ false };
+	bool bAborted{ false };
+	int32 PendingAvatars{ 0 };
+	double AvatarsStartTime{ 0.0 };
+	//Time to fill a list of NumAvatars rows, first iteration misses the cache, the rest hit it
+	FMultiplayerLatencyHistogram AvatarFetchTimes;
+	FMultiplayerPresenceSubscriptionHandle PresenceSubscription;
+	int32 PresenceBatches{ 0 };
+	int32 PresenceChanges{ 0 };
+
+	//Invites go to the first few friends of the list, enough to exercise the batch and its rate limit
+	static constexpr int32 NumInvitees = 10;
+	static constexpr int32 NumAvatars = 300;
+};
+
+static TSharedPtr<FMultiplayerSessionsBenchmark> RunningBenchmark;
+
+void FMultiplayerSessionsBenchmark::Start()
+{
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = Subsystem.Get();
+	MultiplayerSessionsSubsystem->SetOnlineServicesOverride(Backend->MakeServices());
+	MultiplayerSessionsSubsystem->SetAvatarProviderOverride(Backend->MakeAvatarProvider());
+	MultiplayerSessionsSubsystem->ResetSessionMetrics();
+
+	MultiplayerSessionsSubsystem->MultiplayerOnGetFriendsListComplete.AddSP(this, &FMultiplayerSessionsBenchmark::OnGetFriendsListComplete);
+	MultiplayerSessionsSubsystem->MultiplayerOnFindSessionsComplete.AddSP(this, &FMultiplayerSessionsBenchmark::OnFindSessionsComplete);
+	MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.AddSP(this, &FMultiplayerSessionsBenchmark::OnJoinSessionComplete);
+	MultiplayerSessionsSubsystem->MultiplayerOnDestroySessionComplete.AddSP(this, &FMultiplayerSessionsBenchmark::OnDestroySessionComplete);
+	PresenceSubscription = MultiplayerSessionsSubsystem->SubscribeToFriendPresence(FMultiplayerOnFriendPresenceChanged::CreateSP(this, &FMultiplayerSessionsBenchmark::OnFriendPresenceChanged));
+
+	const FMultiplayerFakeOnlineSettings& Settings = Backend->GetSettings();
+	UE_LOG(LogMultiplayerSession, Display, TEXT("Session benchmark: %d iterations, %d friends, %d sessions, %.3f-%.3fs latency, %.0f%% failures"),
+		Iterations, Settings.NumFriends, Settings.NumSearchResults, Settings.MinLatencySeconds, Settings.MaxLatencySeconds, Settings.FailureRate * 100.f);
+
+	StartTime = FPlatformTime::Seconds();
+	if (TimeoutSeconds > 0.f) {
+		DeadlineTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FMultiplayerSessionsBenchmark::CheckDeadline), 1.f);
+	}
+	ScheduleStep(EStep::ReadFriends);
+}
+
+bool FMultiplayerSessionsBenchmark::CheckDeadline(float DeltaTime)
+{
+	if (Step == EStep::Done) {
+		return false;
+	}
+	if (FPlatformTime::Seconds() - StartTime < TimeoutSeconds) {
+		return true;
+	}
+	Abort(TEXT("deadline reached"));
+	return false;
+}
+
+void FMultiplayerSessionsBenchmark::Abort(const TCHAR* Reason)
+{
+	if (bFinished) {
+		return;
+	}
+	UE_LOG(LogMultiplayerSession, Warning, TEXT("Session benchmark aborted in step %d of iteration %d, %s"), static_cast<int32>(Step), Iteration + 1, Reason);
+	bAborted = true;
+
+	//Queued operations would otherwise run against the real online subsystem once the fake is swapped out
+	if (UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = Subsystem.Get()) {
+		MultiplayerSessionsSubsystem->CancelAllSessionOperations();
+	}
+	Finish();
+}
+
+void FMultiplayerSessionsBenchmark::ScheduleStep(EStep NextStep)
+{
+	Step = NextStep;
+	TSharedRef<FMultiplayerSessionsBenchmark> Self = AsShared();
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Self](float DeltaTime) {
+		Self->RunStep();
+		return false;
+	}));
+}
+
+void FMultiplayerSessionsBenchmark::RunStep()
+{
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = Subsystem.Get();
+	if (!MultiplayerSessionsSubsystem || !PlayerController.IsValid() || Step == EStep::Done) {
+		Finish();
+		return;
+	}
+
+	switch (Step) {
+	case EStep::ReadFriends:
+		MultiplayerSessionsSubsystem->GetFriendsList(PlayerController.Get(), true);
+		break;
+	case EStep::FetchAvatars: {
+		AvatarsStartTime = FPlatformTime::Seconds();
+		PendingAvatars = 0;
+		const TArray<TSharedRef<FOnlineFriend>>& Friends = MultiplayerSessionsSubsystem->GetCachedFriendsList();
+		for (int32 Index = 0; Index < FMath::Min(Friends.Num(), NumAvatars); ++Index) {
+			FMultiplayerAvatarRequestHandle AvatarHandle;
+			MultiplayerSessionsSubsystem->GetFriendAvatar(Friends[Index]->GetUserId(), SteamAvatarSize::SteamAvatar_Medium,
+				FMultiplayerOnAvatarReady::CreateSP(this, &FMultiplayerSessionsBenchmark::OnAvatarReady), AvatarHandle);
+			PendingAvatars += AvatarHandle.IsValid() ? 1 : 0;
+		}
+		if (PendingAvatars == 0) {
+			OnAvatarReady(nullptr);
+		}
+		break;
+	}
+	case EStep::FindSessions:
+		MultiplayerSessionsSubsystem->FindSessions(Backend->GetSettings().NumSearchResults);
+		break;
+	case EStep::QuickJoin:
+		MultiplayerSessionsSubsystem->QuickJoinBestSession(TEXT("Default"), Backend->GetSettings().NumSearchResults);
+		break;
+	case EStep::SendInvites: {
+		TArray<FUniqueNetIdRef> Invitees;
+		const TArray<TSharedRef<FOnlineFriend>>& Friends = MultiplayerSessionsSubsystem->GetCachedFriendsList();
+		for (int32 Index = 0; Index < FMath::Min(Friends.Num(), NumInvitees); ++Index) {
+			Invitees.Add(Friends[Index]->GetUserId());
+		}
+		MultiplayerSessionsSubsystem->SendSessionInvitesToFriends(PlayerController.Get(), Invitees, FMultiplayerOnSessionInvitesSent::CreateSP(this, &FMultiplayerSessionsBenchmark::OnInvitesSent));
+		break;
+	}
+	case EStep::DestroySession:
+		MultiplayerSessionsSubsystem->DestroySession();
+		break;
+	default:
+		break;
+	}
+}
+
+void FMultiplayerSessionsBenchmark::OnGetFriendsListComplete(bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta)
+{
+	if (Step == EStep::ReadFriends) {
+		ScheduleStep(EStep::FetchAvatars);
+	}
+}
+
+void FMultiplayerSessionsBenchmark::OnAvatarReady(UTexture2D* Avatar)
+{
+	if (Step != EStep::FetchAvatars || --PendingAvatars > 0) {
+		return;
+	}
+	AvatarFetchTimes.Add((FPlatformTime::Seconds() - AvatarsStartTime) * 1000.0, true);
+	ScheduleStep(EStep::FindSessions);
+}
+
+void FMultiplayerSessionsBenchmark::OnFriendPresenceChanged(const TArray<FMultiplayerFriendPresenceChange>& Changes)
+{
+	++PresenceBatches;
+	PresenceChanges += Changes.Num();
+}
+
+void FMultiplayerSessionsBenchmark::OnFindSessionsComplete(const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful)
+{
+	//Quick join's own search reports here too, its join is what moves it along
+	if (Step == EStep::FindSessions) {
+		ScheduleStep(EStep::QuickJoin);
+	}
+}
+
+void FMultiplayerSessionsBenchmark::OnJoinSessionComplete(EOnJoinSessionCompleteResult::Type Result)
+{
+	if (Step == EStep::QuickJoin) {
+		ScheduleStep(EStep::SendInvites);
+	}
+}
+
+void FMultiplayerSessionsBenchmark::OnInvitesSent(FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results)
+{
+	if (Step == EStep::SendInvites) {
+		ScheduleStep(EStep::DestroySession);
+	}
+}
+
+void FMultiplayerSessionsBenchmark::OnDestroySessionComplete(bool bWasSuccessful)
+{
+	if (Step != EStep::DestroySession) {
+		return;
+	}
+	++Iteration;
+	ScheduleStep(Iteration < Iterations ? EStep::ReadFriends : EStep::Done);
+}
+
+void FMultiplayerSessionsBenchmark::Finish()
+{
+	//A step scheduled before an abort still runs once and ends up here again
+	Step = EStep::Done;
+	if (bFinished) {
+		return;
+	}
+	bFinished = true;
+	FTSTicker::GetCoreTicker().RemoveTicker(DeadlineTickerHandle);
+
+	if (UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = Subsystem.Get()) {
+		MultiplayerSessionsSubsystem->MultiplayerOnGetFriendsListComplete.RemoveAll(this);
+		MultiplayerSessionsSubsystem->MultiplayerOnFindSessionsComplete.RemoveAll(this);
+		MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.RemoveAll(this);
+		MultiplayerSessionsSubsystem->MultiplayerOnDestroySessionComplete.RemoveAll(this);
+		MultiplayerSessionsSubsystem->UnsubscribeFromFriendPresence(PresenceSubscription);
+
+		UE_LOG(LogMultiplayerSession, Display, TEXT("Session benchmark %s %d/%d iterations in %.2fs"), bAborted ? TEXT("aborted after") : TEXT("finished"), Iteration, Iterations, FPlatformTime::Seconds() - StartTime);
+		MultiplayerSessionsSubsystem->GetSessionMetrics().DumpToLog();
+		UE_LOG(LogMultiplayerSession, Display, TEXT("%d avatars: avg %.3fms, p50 %.3fms, p95 %.3fms, max %.3fms"), NumAvatars,
+			AvatarFetchTimes.GetAverage(), AvatarFetchTimes.GetPercentile(50.0), AvatarFetchTimes.GetPercentile(95.0), AvatarFetchTimes.MaxMs);
+		UE_LOG(LogMultiplayerSession, Display, TEXT("%d presence changes delivered in %d batches"), PresenceChanges, PresenceBatches);
+		MultiplayerSessionsSubsystem->SetOnlineServicesOverride(FMultiplayerOnlineServices());
+		MultiplayerSessionsSubsystem->SetAvatarProviderOverride(nullptr);
+	}
+	Backend->DumpHandlerTimesToLog();
+
+	if (RunningBenchmark.Get() == this) {
+		RunningBenchmark.Reset();
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SessionBenchmarkCommand(
+	TEXT("MultiplayerSessions.Benchmark"),
+	TEXT("Runs friends/avatars/search/join/invite/destroy against the fake online backend and prints latency and handler cost. ")
+	TEXT("Optional: Iterations=20 Friends=10000 Sessions=1000 MinLatency=0 MaxLatency=0 FailureRate=0 Churn=0.01 Presence=50 Seed=0 Timeout=300. ")
+	TEXT("'abort' stops a running benchmark"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World) {
+		if (Args.Contains(TEXT("abort"))) {
+			if (RunningBenchmark.IsValid() && RunningBenchmark->IsRunning()) {
+				RunningBenchmark->Abort(TEXT("requested from the console"));
+			}
+			else {
+				UE_LOG(LogMultiplayerSession, Warning, TEXT("No session benchmark is running"));
+			}
+			return;
+		}
+		if (RunningBenchmark.IsValid() && RunningBenchmark->IsRunning()) {
+			UE_LOG(LogMultiplayerSession, Warning, TEXT("A session benchmark is already running"));
+			return;
+		}
+
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+		APlayerController* PlayerController = GameInstance ? GameInstance->GetFirstLocalPlayerController() : nullptr;
+		if (!MultiplayerSessionsSubsystem || !PlayerController) {
+			UE_LOG(LogMultiplayerSession, Warning, TEXT("MultiplayerSessions.Benchmark needs a game world with a local player"));
+			return;
+		}
+
+		const FString Joined = FString::Join(Args, TEXT(" "));
+		FMultiplayerFakeOnlineSettings Settings;
+		Settings.NumFriends = 10000;
+		Settings.NumSearchResults = 1000;
+		Settings.FriendChurnRate = 0.01f;
+		Settings.PresenceChangesPerSecond = 50.f;
+		int32 Iterations = 20;
+		float TimeoutSeconds = 300.f;
+		FParse::Value(*Joined, TEXT("Iterations="), Iterations);
+		FParse::Value(*Joined, TEXT("Friends="), Settings.NumFriends);
+		FParse::Value(*Joined, TEXT("Sessions="), Settings.NumSearchResults);
+		FParse::Value(*Joined, TEXT("MinLatency="), Settings.MinLatencySeconds);
+		FParse::Value(*Joined, TEXT("MaxLatency="), Settings.MaxLatencySeconds);
+		FParse::Value(*Joined, TEXT("FailureRate="), Settings.FailureRate);
+		FParse::Value(*Joined, TEXT("Churn="), Settings.FriendChurnRate);
+		FParse::Value(*Joined, TEXT("Presence="), Settings.PresenceChangesPerSecond);
+		FParse::Value(*Joined, TEXT("Seed="), Settings.RandomSeed);
+		FParse::Value(*Joined, TEXT("Timeout="), TimeoutSeconds);
+
+		RunningBenchmark = MakeShared<FMultiplayerSessionsBenchmark>(MultiplayerSessionsSubsystem, PlayerController, Settings, Iterations, TimeoutSeconds);
+		RunningBenchmark->Start();
+	}));
+
+#endif //!UE_BUILD_SHIPPING
@@ -4,12 +4,48 @@
 #include "MultiplayerSessionsSubsystem.h"
 #include "OnlineSubsystem.h"
 #include "OnlineSubsystemUtils.h"
+#include "OnlineSubsystemNames.h"
 #include "Interfaces/OnlineFriendsInterface.h"
 #include "OnlineSessionSettings.h"
+#include "Online/OnlineSessionNames.h"
 #include "Interfaces/OnlineAchievementsInterface.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
 
 DEFINE_LOG_CATEGORY(LogMultiplayerSession);
 
+//Hosting player number passed for dedicated sessions, there is no local user behind it
+static constexpr int32 DedicatedServerHostingPlayerNum = 0;
+
+static FAutoConsoleCommandWithWorldAndArgs DumpSessionLatencyCommand(
+	TEXT("MultiplayerSessions.DumpLatency"),
+	TEXT("Prints count, failures and p50/p95/p99 latency of every online call. 'csv' also writes the table to Saved/Profiling/MultiplayerSessions, 'reset' clears it afterwards"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World) {
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+		if (!MultiplayerSessionsSubsystem) {
+			UE_LOG(LogMultiplayerSession, Warning, TEXT("No UMultiplayerSessionsSubsystem in this world for MultiplayerSessions.DumpLatency"));
+			return;
+		}
+
+		MultiplayerSessionsSubsystem->GetSessionMetrics().DumpToLog();
+		if (Args.Contains(TEXT("csv"))) {
+			const FString FilePath = FPaths::ProfilingDir() / TEXT("MultiplayerSessions") / FString::Printf(TEXT("SessionLatency-%s.csv"), *FDateTime::Now().ToString());
+			if (MultiplayerSessionsSubsystem->GetSessionMetrics().WriteCsv(FilePath)) {
+				UE_LOG(LogMultiplayerSession, Display, TEXT("Session latency written to %s"), *FilePath);
+			}
+		}
+		if (Args.Contains(TEXT("reset"))) {
+			MultiplayerSessionsSubsystem->ResetSessionMetrics();
+		}
+	}));
+
 UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem():
 	CreateSessionCompleteDelegate(FOnCreateSessionCompleteDelegate::CreateUObject(this, &UMultiplayerSessionsSubsystem::OnCreateSessionComplete)),
 	FindSessionsCompleteDelegate(FOnFindSessionsCompleteDelegate::CreateUObject(this, &UMultiplayerSessionsSubsystem::OnFindSessionsComplete)),
@@ -19,12 +55,130 @@ UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem():
 	StartSessionCompleteDelegate(FOnStartSessionCompleteDelegate::CreateUObject(this, &UMultiplayerSessionsSubsystem::OnStartSessionComplete)),
 	SessionInviteAcceptedDelegate(FOnSessionUserInviteAcceptedDelegate::CreateUObject(this, &UMultiplayerSessionsSubsystem::OnSessionUserInviteAccepted)),
 	SessionInviteReceivedDelegate(FOnSessionInviteReceivedDelegate::CreateUObject(this, &UMultiplayerSessionsSubsystem::OnSessionInviteReceived)),
-	ReadFriendsListCompleteDelegate(FOnReadFriendsListComplete::CreateUObject(this, &UMultiplayerSessionsSubsystem::OnReadFriendsListComplete))
+	ReadFriendsListCompleteDelegate(FOnReadFriendsListComplete::CreateUObject(this, &UMultiplayerSessionsSubsystem::OnReadFriendsListComplete)),
+	PresenceReceivedDelegate(FOnPresenceReceivedDelegate::CreateUObject(this, &UMultiplayerSessionsSubsystem::OnPresenceReceived))
+{
+}
+
+void UMultiplayerSessionsSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
+	Super::Initialize(Collection);
+
+	//A player can accept an invite before any menu asks for sessions (launching the game from the invite), so players
+	//bind the invite delegates right away. Everything else is resolved the first time it is used
+	if (!IsRunningDedicatedServer()) {
+		IsValidSessionInterface();
+	}
+
+	FMultiplayerStatAggregatorLimits StatLimits;
+	StatLimits.MaxPendingStats = MaxPendingStats;
+	StatLimits.MaxRetries = MaxStatWriteRetries;
+	StatLimits.RetryDelaySeconds = StatWriteRetryDelay;
+	StatAggregator.SetLimits(StatLimits);
+}
+
+void UMultiplayerSessionsSubsystem::Deinitialize()
+{
+	//Last chance for queued stats, their completions are no longer tracked
+	FlushStats();
+	StatAggregator.Reset();
+
+	ClearSessionInterfaceDelegates();
+	ClearPresenceDelegates();
+	PresenceSubscribers.Reset();
+	ClearJoinTravelDelegates();
+	bJoinTravelInProgress = false;
+	//Nothing failed, shutdown cut these off. Only their regions and the in flight stat need closing
+	SessionMetrics.Discard(ConnectToSessionTimer);
+	SessionMetrics.Discard(JoinToGameTimer);
+	SessionMetrics.Discard(PreloadMapTimer);
+	SessionMetrics.Discard(SessionOperationTimer);
+	SessionMetrics.Discard(ReadFriendsListTimer);
+	for (TPair<uint32, FMultiplayerLatencyTimer>& InviteTimer : InviteTimers) {
+		SessionMetrics.Discard(InviteTimer.Value);
+	}
+	PreloadedMapWorld = nullptr;
+	PreloadingMapName = NAME_None;
+	ClearAchievementDelegates();
+	AchievementSnapshot.Reset();
+	AchievementsPlayerId.Reset();
+	bAchievementsQueryInFlight = false;
+	bAchievementDescriptionsQueryInFlight = false;
+	bAchievementDescriptionsLoaded = false;
+	bAchievementQueriesFailed = false;
+	if (UGameInstance* GameInstance = GetGameInstance()) {
+		FTimerManager& TimerManager = GameInstance->GetTimerManager();
+		TimerManager.ClearTimer(SessionSearchPollTimerHandle);
+		TimerManager.ClearTimer(InviteBatchTimerHandle);
+		TimerManager.ClearTimer(StatFlushTimerHandle);
+	}
+
+	QueuedSessionOperations.Reset();
+	ActiveSessionOperation.Reset();
+	InviteBatches.Reset();
+	PendingInviteCallbacks.Reset();
+	InviteTimers.Reset();
+	bInviteBatchesWaitingForSession = false;
+	bReadFriendsListInFlight = false;
+	InvalidateFriendsListCache();
+
+	SessionInterface.Reset();
+	FriendsInterface.Reset();
+	ExternalUIInterface.Reset();
+	AchievementsInterface.Reset();
+	PresenceInterface.Reset();
+	OnlineServicesOverride = FMultiplayerOnlineServices();
+	AvatarService.Reset();
+	AvatarProviderOverride.Reset();
+
+	Super::Deinitialize();
+}
+
+void UMultiplayerSessionsSubsystem::SetOnlineServicesOverride(const FMultiplayerOnlineServices& Services)
+{
+	if (ActiveSessionOperation.IsSet() || bReadFriendsListInFlight || !InviteBatches.IsEmpty()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Swapping online services while requests are in flight in UMultiplayerSessionsSubsystem::SetOnlineServicesOverride, their completions will be lost"));
+	}
+
+	//Delegates live on the interface they were registered with
+	ClearSessionInterfaceDelegates();
+	ClearPresenceDelegates();
+	if (UGameInstance* GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(SessionSearchPollTimerHandle);
+	}
+
+	OnlineServicesOverride = Services;
+	SessionInterface.Reset();
+	FriendsInterface.Reset();
+	PresenceInterface.Reset();
+	SessionMetrics.Discard(SessionOperationTimer);
+	SessionMetrics.Discard(ReadFriendsListTimer);
+	ActiveSessionOperation.Reset();
+	bReadFriendsListInFlight = false;
+	InvalidateFriendsListCache();
+
+	//Re-resolved against the new backend, which also moves the invite delegates over
 	IsValidSessionInterface();
-	IsValidFriendsInterface();
+	if (!PresenceSubscribers.IsEmpty() && IsValidPresenceInterface()) {
+		PresenceReceivedDelegateHandle = PresenceInterface->AddOnPresenceReceivedDelegate_Handle(PresenceReceivedDelegate);
+	}
+	SetSessionState(GetStateFromNamedSession());
+	ProcessNextSessionOperation();
+}
 
-	SessionInviteReceivedDelegateHandle = SessionInterface->AddOnSessionInviteReceivedDelegate_Handle(SessionInviteReceivedDelegate);
+void UMultiplayerSessionsSubsystem::ClearSessionInterfaceDelegates()
+{
+	if (!SessionInterface) {
+		return;
+	}
+	SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+	SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+	SessionInterface->ClearOnCancelFindSessionsCompleteDelegate_Handle(CancelFindSessionsCompleteDelegateHandle);
+	SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+	SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+	SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+	SessionInterface->ClearOnSessionInviteReceivedDelegate_Handle(SessionInviteReceivedDelegateHandle);
+	SessionInterface->ClearOnSessionUserInviteAcceptedDelegate_Handle(SessionInviteAcceptedDelegateHandle);
 }
 
 bool UMultiplayerSessionsSubsystem::IsValidSessionInterface()
@@ -32,10 +186,20 @@ bool UMultiplayerSessionsSubsystem::IsValidSessionInterface()
 	if (!SessionInterface)
 	{
 		IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
-		if (Subsystem)
+		if (OnlineServicesOverride.Session)
+		{
+			SessionInterface = OnlineServicesOverride.Session;
+		}
+		else if (Subsystem)
 		{
 			SessionInterface = Subsystem->GetSessionInterface();
+		}
 
+		//Invites are the only session delegates that stay bound, the completion ones are added per request
+		if (SessionInterface)
+		{
+			SessionInviteReceivedDelegateHandle = SessionInterface->AddOnSessionInviteReceivedDelegate_Handle(SessionInviteReceivedDelegate);
+			SessionInviteAcceptedDelegateHandle = SessionInterface->AddOnSessionUserInviteAcceptedDelegate_Handle(SessionInviteAcceptedDelegate);
 		}
 	}
 	return SessionInterface.IsValid();
@@ -46,15 +210,47 @@ bool UMultiplayerSessionsSubsystem::IsValidFriendsInterface()
 	if (!FriendsInterface)
 	{
 		IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
-		if (Subsystem)
+		if (OnlineServicesOverride.Friends)
+		{
+			FriendsInterface = OnlineServicesOverride.Friends;
+		}
+		else if (Subsystem)
 		{
 			FriendsInterface = Subsystem->GetFriendsInterface();
-
 		}
 	}
 	return FriendsInterface.IsValid();
 }
 
+bool UMultiplayerSessionsSubsystem::IsValidPresenceInterface()
+{
+	if (!PresenceInterface)
+	{
+		IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
+		if (OnlineServicesOverride.Presence)
+		{
+			PresenceInterface = OnlineServicesOverride.Presence;
+		}
+		else if (Subsystem)
+		{
+			PresenceInterface = Subsystem->GetPresenceInterface();
+		}
+	}
+	return PresenceInterface.IsValid();
+}
+
+void UMultiplayerSessionsSubsystem::ClearPresenceDelegates()
+{
+	if (PresenceInterface) {
+		PresenceInterface->ClearOnPresenceReceivedDelegate_Handle(PresenceReceivedDelegateHandle);
+	}
+	PresenceReceivedDelegateHandle.Reset();
+	if (UGameInstance* GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(PresenceCoalesceTimerHandle);
+	}
+	PendingPresenceChanges.Reset();
+}
+
 bool UMultiplayerSessionsSubsystem::IsValidExternalUIInterface()
 {
 	if (!ExternalUIInterface)
@@ -83,165 +279,1032 @@ bool UMultiplayerSessionsSubsystem::IsValidAchievementsInterface()
 	return AchievementsInterface.IsValid();
 }
 
-void UMultiplayerSessionsSubsystem::CreateSession(int32 NumPublicConnections, FString MatchType)
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::CreateSession(int32 NumPublicConnections, FString MatchType, FString MapName)
+{
+	LastNumPublicConnections = NumPublicConnections;
+	LastMatchType = MatchType;
+
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Create;
+	Operation.NumPublicConnections = NumPublicConnections;
+	Operation.MatchType = MatchType;
+	Operation.MapName = MapName;
+	Operation.bDedicated = IsRunningDedicatedServer();
+	return EnqueueSessionOperation(MoveTemp(Operation));
+}
+
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::CreateDedicatedSession(int32 NumPublicConnections, FString MatchType, FString MapName)
+{
+	LastNumPublicConnections = NumPublicConnections;
+	LastMatchType = MatchType;
+
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Create;
+	Operation.NumPublicConnections = NumPublicConnections;
+	Operation.MatchType = MatchType;
+	Operation.MapName = MapName;
+	Operation.bDedicated = true;
+	return EnqueueSessionOperation(MoveTemp(Operation));
+}
+
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults, const FMultiplayerSessionSearchFilter& Filter)
+{
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Find;
+	Operation.MaxSearchResults = MaxSearchResults;
+	Operation.SearchFilter = Filter;
+	return EnqueueSessionOperation(MoveTemp(Operation));
+}
+
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::FindSessionsStreaming(int32 MaxSearchResults, int32 PageSize, int32 StopAfterJoinable, const FMultiplayerSessionSearchFilter& Filter)
+{
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Find;
+	Operation.MaxSearchResults = MaxSearchResults;
+	Operation.SearchFilter = Filter;
+	Operation.bStreamSearchResults = true;
+	Operation.SearchPageSize = FMath::Max(PageSize, 1);
+	Operation.StopAfterJoinable = FMath::Max(StopAfterJoinable, 0);
+	return EnqueueSessionOperation(MoveTemp(Operation));
+}
+
+TArrayView<const FOnlineSessionSearchResult> UMultiplayerSessionsSubsystem::GetSessionSearchPage(int32 Cursor, int32 PageSize) const
+{
+	if (!LastSessionSearch.IsValid() || Cursor < 0 || PageSize <= 0 || Cursor >= LastSessionSearch->SearchResults.Num()) {
+		return TArrayView<const FOnlineSessionSearchResult>();
+	}
+	const int32 Count = FMath::Min(PageSize, LastSessionSearch->SearchResults.Num() - Cursor);
+	return TArrayView<const FOnlineSessionSearchResult>(LastSessionSearch->SearchResults.GetData() + Cursor, Count);
+}
+
+bool UMultiplayerSessionsSubsystem::IsSessionJoinable(const FOnlineSessionSearchResult& SessionResult)
+{
+	return SessionResult.IsValid() && SessionResult.Session.NumOpenPublicConnections > 0;
+}
+
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::QuickJoinBestSession(const FString& MatchType, int32 MaxSearchResults, bool bTravelAfterJoin, EMultiplayerSessionHostType HostType)
+{
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Find;
+	Operation.MaxSearchResults = MaxSearchResults;
+	Operation.bStreamSearchResults = true;
+	Operation.SearchPageSize = FMath::Max(MaxSearchResults, 1);
+	Operation.StopAfterJoinable = QuickJoinStopAfterJoinable;
+	Operation.bQuickJoin = true;
+	Operation.bTravelAfterJoin = bTravelAfterJoin;
+	Operation.RankingParams = MakeDefaultRankingParams(MatchType);
+	Operation.SearchFilter.MatchType = MatchType;
+	Operation.SearchFilter.MinOpenSlots = 1;
+	Operation.SearchFilter.BuildId = SessionBuildId;
+	Operation.SearchFilter.HostType = HostType;
+	if (bTravelAfterJoin) {
+		BeginJoinTravel();
+	}
+	return EnqueueSessionOperation(MoveTemp(Operation));
+}
+
+FMultiplayerSessionRankingParams UMultiplayerSessionsSubsystem::MakeDefaultRankingParams(const FString& MatchType) const
+{
+	FMultiplayerSessionRankingParams Params;
+	Params.MatchType = MatchType;
+	Params.Region = SessionRegion;
+	Params.MaxPingInMs = QuickJoinMaxPingInMs;
+	return Params;
+}
+
+void UMultiplayerSessionsSubsystem::JoinBestSearchResult(const FMultiplayerSessionRankingParams& RankingParams, bool bTravelAfterJoin)
+{
+	TArray<FMultiplayerRankedSession> RankedSessions;
+	if (LastSessionSearch.IsValid()) {
+		FMultiplayerSessionRanking::RankSessions(LastSessionSearch->SearchResults, RankingParams, RankedSessions);
+	}
+
+	if (RankedSessions.IsEmpty()) {
+		UE_LOG(LogMultiplayerSession, Log, TEXT("No joinable session found in UMultiplayerSessionsSubsystem::JoinBestSearchResult"));
+		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+		if (bTravelAfterJoin) {
+			FinishJoinTravel(false);
+		}
+		return;
+	}
+
+	JoinSession(LastSessionSearch->SearchResults[RankedSessions[0].ResultIndex], bTravelAfterJoin);
+}
+
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult, bool bTravelAfterJoin)
+{
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Join;
+	Operation.SessionResult = SessionResult;
+	Operation.bTravelAfterJoin = bTravelAfterJoin;
+	if (bTravelAfterJoin) {
+		BeginJoinTravel();
+	}
+	return EnqueueSessionOperation(MoveTemp(Operation));
+}
+
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::DestroySession()
+{
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Destroy;
+	return EnqueueSessionOperation(MoveTemp(Operation));
+}
+
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::StartSession()
+{
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Start;
+	return EnqueueSessionOperation(MoveTemp(Operation));
+}
+
+bool UMultiplayerSessionsSubsystem::CancelSessionOperation(FMultiplayerSessionOperationHandle OperationHandle)
+{
+	const int32 QueuedIndex = QueuedSessionOperations.IndexOfByPredicate([OperationHandle](const FSessionOperation& Operation) { return Operation.Id == OperationHandle.Id; });
+	if (QueuedIndex != INDEX_NONE) {
+		const FSessionOperation Operation = QueuedSessionOperations[QueuedIndex];
+		QueuedSessionOperations.RemoveAt(QueuedIndex);
+		OnSessionOperationCancelled(Operation);
+		return true;
+	}
+
+	//Searching is the only running operation the session interface lets us abort
+	if (ActiveSessionOperation.IsSet() && ActiveSessionOperation->Id == OperationHandle.Id && ActiveSessionOperation->Type == ESessionOperationType::Find && SessionInterface) {
+		CancelFindSessionsCompleteDelegateHandle = SessionInterface->AddOnCancelFindSessionsCompleteDelegate_Handle(CancelFindSessionsCompleteDelegate);
+		if (SessionInterface->CancelFindSessions()) {
+			return true;
+		}
+		SessionInterface->ClearOnCancelFindSessionsCompleteDelegate_Handle(CancelFindSessionsCompleteDelegateHandle);
+	}
+	return false;
+}
+
+void UMultiplayerSessionsSubsystem::CancelAllSessionOperations()
+{
+	TArray<FSessionOperation> CancelledOperations = MoveTemp(QueuedSessionOperations);
+	QueuedSessionOperations.Reset();
+	for (const FSessionOperation& Operation : CancelledOperations) {
+		OnSessionOperationCancelled(Operation);
+	}
+
+	if (ActiveSessionOperation.IsSet()) {
+		CancelSessionOperation(FMultiplayerSessionOperationHandle{ ActiveSessionOperation->Id });
+	}
+}
+
+FMultiplayerSessionOperationHandle UMultiplayerSessionsSubsystem::EnqueueSessionOperation(FSessionOperation&& Operation)
+{
+	//Same request as the last one still waiting in the queue, its completion answers this call too. A request with
+	//other parameters is a different operation and gets its own place and handle
+	if (QueuedSessionOperations.Num() > 0 && IsSameSessionRequest(QueuedSessionOperations.Last(), Operation)) {
+		return FMultiplayerSessionOperationHandle{ QueuedSessionOperations.Last().Id };
+	}
+
+	//Same request as the one already running with nothing queued after it, its completion answers this call too
+	if (QueuedSessionOperations.IsEmpty() && ActiveSessionOperation.IsSet() && IsSameSessionRequest(*ActiveSessionOperation, Operation)) {
+		return FMultiplayerSessionOperationHandle{ ActiveSessionOperation->Id };
+	}
+
+	Operation.Id = NextSessionOperationId++;
+	if (NextSessionOperationId == 0) {
+		NextSessionOperationId = 1;
+	}
+	const FMultiplayerSessionOperationHandle OperationHandle{ Operation.Id };
+	QueuedSessionOperations.Add(MoveTemp(Operation));
+
+	ProcessNextSessionOperation();
+	return OperationHandle;
+}
+
+bool UMultiplayerSessionsSubsystem::IsSameSessionRequest(const FSessionOperation& A, const FSessionOperation& B)
+{
+	if (A.Type != B.Type) {
+		return false;
+	}
+	switch (A.Type) {
+	case ESessionOperationType::Create:
+		return A.NumPublicConnections == B.NumPublicConnections && A.MatchType == B.MatchType && A.MapName == B.MapName && A.bDedicated == B.bDedicated;
+	case ESessionOperationType::Join:
+		return A.SessionResult.GetSessionIdStr() == B.SessionResult.GetSessionIdStr() && A.bTravelAfterJoin == B.bTravelAfterJoin;
+	case ESessionOperationType::Find:
+		return A.MaxSearchResults == B.MaxSearchResults && A.SearchFilter == B.SearchFilter && A.bStreamSearchResults == B.bStreamSearchResults
+			&& A.SearchPageSize == B.SearchPageSize && A.StopAfterJoinable == B.StopAfterJoinable && A.bQuickJoin == B.bQuickJoin && A.bTravelAfterJoin == B.bTravelAfterJoin
+			&& A.RankingParams.MatchType == B.RankingParams.MatchType;
+	default:
+		return true;
+	}
+}
+
+void UMultiplayerSessionsSubsystem::ProcessNextSessionOperation()
+{
+	if (ActiveSessionOperation.IsSet() || QueuedSessionOperations.IsEmpty()) {
+		return;
+	}
+
+	ActiveSessionOperation = QueuedSessionOperations[0];
+	QueuedSessionOperations.RemoveAt(0);
+
+	//Copy, the execute functions may finish the operation synchronously and reset ActiveSessionOperation
+	const FSessionOperation Operation = *ActiveSessionOperation;
+	SessionOperationTimer = SessionMetrics.Start(GetSessionOperationMetric(Operation.Type));
+	switch (Operation.Type) {
+	case ESessionOperationType::Create:
+		ExecuteCreateSession(Operation);
+		break;
+	case ESessionOperationType::Find:
+		ExecuteFindSessions(Operation);
+		break;
+	case ESessionOperationType::Join:
+		ExecuteJoinSession(Operation);
+		break;
+	case ESessionOperationType::Destroy:
+		ExecuteDestroySession();
+		break;
+	case ESessionOperationType::Start:
+		ExecuteStartSession();
+		break;
+	}
+}
+
+void UMultiplayerSessionsSubsystem::FinishActiveSessionOperation(ESessionOperationType Type, bool bWasSuccessful)
+{
+	if (!IsActiveSessionOperation(Type)) {
+		return;
+	}
+	SessionMetrics.Stop(SessionOperationTimer, bWasSuccessful);
+	ActiveSessionOperation.Reset();
+	ProcessNextSessionOperation();
+
+	//Nothing left that travels, a join pipeline started for a request that never ran would otherwise stay open
+	if (bJoinTravelInProgress && !ConnectToSessionTimer.IsRunning() && !IsJoinTravelRequested()) {
+		FinishJoinTravel(false);
+	}
+}
+
+bool UMultiplayerSessionsSubsystem::IsJoinTravelRequested() const
+{
+	auto TravelsAfterJoin = [](const FSessionOperation& Operation) { return Operation.bTravelAfterJoin; };
+	return (ActiveSessionOperation.IsSet() && TravelsAfterJoin(*ActiveSessionOperation)) || QueuedSessionOperations.ContainsByPredicate(TravelsAfterJoin);
+}
+
+bool UMultiplayerSessionsSubsystem::IsActiveSessionOperation(ESessionOperationType Type) const
+{
+	return ActiveSessionOperation.IsSet() && ActiveSessionOperation->Type == Type;
+}
+
+bool UMultiplayerSessionsSubsystem::IsSessionOperationPending(ESessionOperationType Type) const
+{
+	return IsActiveSessionOperation(Type) || QueuedSessionOperations.ContainsByPredicate([Type](const FSessionOperation& Operation) { return Operation.Type == Type; });
+}
+
+EMultiplayerSessionMetric UMultiplayerSessionsSubsystem::GetSessionOperationMetric(ESessionOperationType Type)
+{
+	switch (Type) {
+	case ESessionOperationType::Create:
+		return EMultiplayerSessionMetric::CreateSession;
+	case ESessionOperationType::Find:
+		return EMultiplayerSessionMetric::FindSessions;
+	case ESessionOperationType::Join:
+		return EMultiplayerSessionMetric::JoinSession;
+	case ESessionOperationType::Destroy:
+		return EMultiplayerSessionMetric::DestroySession;
+	default:
+		return EMultiplayerSessionMetric::StartSession;
+	}
+}
+
+void UMultiplayerSessionsSubsystem::OnSessionOperationCancelled(const FSessionOperation& Operation)
+{
+	//Invites waiting for this create have no session to go out to unless another create or join still comes
+	if (Operation.Type == ESessionOperationType::Create && bInviteBatchesWaitingForSession
+		&& !IsSessionOperationPending(ESessionOperationType::Create) && !IsSessionOperationPending(ESessionOperationType::Join)) {
+		bInviteBatchesWaitingForSession = false;
+		FailInviteBatches();
+	}
+	if (Operation.bTravelAfterJoin) {
+		FinishJoinTravel(false);
+	}
+
+	//Only the caller holding the handle cares, the completion delegates stay reserved for operations that ran
+	MultiplayerOnSessionOperationCancelled.Broadcast(FMultiplayerSessionOperationHandle{ Operation.Id });
+}
+
+void UMultiplayerSessionsSubsystem::ExecuteCreateSession(const FSessionOperation& Operation)
 {
 	if (!IsValidSessionInterface()) {
-		MultiplayerOnCreateSessionComplete.Broadcast(false);
+		OnCreateSessionComplete(NAME_GameSession, false);
 		return;
 	}
 
-	auto ExistingSession = SessionInterface->GetNamedSession(NAME_GameSession);
-	if (ExistingSession != nullptr) {
-		DestroySession();
+	//An old session is still registered, destroy it first. OnDestroySessionComplete comes back here once it is gone
+	if (SessionInterface->GetNamedSession(NAME_GameSession) != nullptr) {
+		SetSessionState(EMultiplayerSessionState::Destroying);
+		ExecuteDestroySession();
+		return;
+	}
+
+	//Without a map name the session advertises the map we are on, which needs a world
+	const UWorld* World = GetWorld();
+	if (Operation.MapName.IsEmpty() && (World == nullptr || World->GetPackage() == nullptr)) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("No world to take the map name from in UMultiplayerSessionsSubsystem::ExecuteCreateSession"));
+		OnCreateSessionComplete(NAME_GameSession, false);
+		return;
 	}
 
+	SetSessionState(EMultiplayerSessionState::Creating);
+
 	//Store the delegate in a FDelegateHandle so we can remove it later from the delegate list
 	CreateSessionCompleteDelegateHandle = SessionInterface->AddOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate);
 
+	//Dedicated servers have no player to attach presence or a lobby to, they are advertised as game servers
 	LastSessionSettings = MakeShareable(new FOnlineSessionSettings());
-	LastSessionSettings->bIsLANMatch = false;
-	LastSessionSettings->NumPublicConnections = NumPublicConnections;
+	LastSessionSettings->bIsLANMatch = IsLanOnlySubsystem();
+	LastSessionSettings->bIsDedicated = Operation.bDedicated;
+	LastSessionSettings->NumPublicConnections = Operation.NumPublicConnections;
 	LastSessionSettings->bAllowJoinInProgress = true;
-	LastSessionSettings->bAllowJoinViaPresence = true;
+	LastSessionSettings->bAllowJoinViaPresence = !Operation.bDedicated;
 	LastSessionSettings->bShouldAdvertise = true;
-	LastSessionSettings->bUsesPresence = true;
-	LastSessionSettings->bUseLobbiesIfAvailable = true;
-	LastSessionSettings->Set(FName("MatchType"), FString("FreeForAll"), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	LastSessionSettings->bUsesPresence = !Operation.bDedicated;
+	LastSessionSettings->bUseLobbiesIfAvailable = !Operation.bDedicated;
+	LastSessionSettings->Set(MULTIPLAYER_SETTING_MATCHTYPE, Operation.MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	LastSessionSettings->Set(SETTING_MAPNAME, Operation.MapName.IsEmpty() ? UWorld::RemovePIEPrefix(World->GetPackage()->GetName()) : Operation.MapName, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	if (SessionBuildId != 0) {
+		LastSessionSettings->Set(MULTIPLAYER_SETTING_BUILDID, SessionBuildId, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	}
+	if (!SessionRegion.IsEmpty()) {
+		LastSessionSettings->Set(MULTIPLAYER_SETTING_REGION, SessionRegion, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	}
 
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	if (!SessionInterface->CreateSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, *LastSessionSettings)) {
-		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+	//A dedicated server has no local user to host with. The hosting player number overload is the one backends
+	//register game servers through, they read bIsDedicated from the settings and not the player
+	bool bCreateStarted = false;
+	if (Operation.bDedicated) {
+		UE_LOG(LogMultiplayerSession, Log, TEXT("Registering a dedicated session for %d players in UMultiplayerSessionsSubsystem::ExecuteCreateSession"), Operation.NumPublicConnections);
+		bCreateStarted = SessionInterface->CreateSession(DedicatedServerHostingPlayerNum, NAME_GameSession, *LastSessionSettings);
+	}
+	else if (const FUniqueNetIdPtr HostUserId = GetLocalUserNetId()) {
+		bCreateStarted = SessionInterface->CreateSession(*HostUserId, NAME_GameSession, *LastSessionSettings);
+	}
+	else {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("No local player to host the session in UMultiplayerSessionsSubsystem::ExecuteCreateSession"));
+	}
 
-		MultiplayerOnCreateSessionComplete.Broadcast(false);
+	if (!bCreateStarted) {
+		OnCreateSessionComplete(NAME_GameSession, false);
 	}
 }
 
-void UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults)
-{
-	if (!IsValidSessionInterface()) {
-		MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
-		return;
+FUniqueNetIdPtr UMultiplayerSessionsSubsystem::GetLocalUserNetId() const
+{
+	const UWorld* World = GetWorld();
+	const ULocalPlayer* LocalPlayer = World ? World->GetFirstLocalPlayerFromController() : nullptr;
+	const FUniqueNetIdPtr LocalUserId = LocalPlayer ? LocalPlayer->GetPreferredUniqueNetId().GetUniqueNetId() : nullptr;
+	return LocalUserId.IsValid() ? LocalUserId : OnlineServicesOverride.LocalUserId;
+}
+
+void UMultiplayerSessionsSubsystem::ExecuteFindSessions(const FSessionOperation& Operation)
+{
+	if (!IsValidSessionInterface()) {
+		OnFindSessionsComplete(false);
+		return;
+	}
+
+	FindSessionsCompleteDelegateHandle = SessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
+
+	LastSessionSearch = MakeShareable(new FOnlineSessionSearch());
+	LastSessionSearch->MaxSearchResults = Operation.MaxSearchResults;
+	Operation.SearchFilter.ApplyTo(*LastSessionSearch);
+	if (IsLanOnlySubsystem()) {
+		LastSessionSearch->bIsLanQuery = true;
+	}
+
+	SessionSearchCursor = 0;
+	SessionSearchCountedResults = 0;
+	SessionSearchJoinableCount = 0;
+
+	const FUniqueNetIdPtr LocalUserId = GetLocalUserNetId();
+	if (!LocalUserId.IsValid()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("No local player to search with in UMultiplayerSessionsSubsystem::ExecuteFindSessions"));
+		OnFindSessionsComplete(false);
+		return;
+	}
+	if (!SessionInterface->FindSessions(*LocalUserId, LastSessionSearch.ToSharedRef())) {
+		OnFindSessionsComplete(false);
+		return;
+	}
+
+	//Backends that fill SearchResults as responses come in get their results streamed before the search completes
+	UGameInstance* GameInstance = GetGameInstance();
+	if (Operation.bStreamSearchResults && GameInstance && IsActiveSessionOperation(ESessionOperationType::Find)) {
+		GameInstance->GetTimerManager().SetTimer(SessionSearchPollTimerHandle, this, &UMultiplayerSessionsSubsystem::PollStreamingSessionSearch, FMath::Max(SessionSearchPollInterval, 0.01f), true);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::PollStreamingSessionSearch()
+{
+	if (!IsActiveSessionOperation(ESessionOperationType::Find) || !ActiveSessionOperation->bStreamSearchResults || !LastSessionSearch.IsValid()) {
+		if (UGameInstance* GameInstance = GetGameInstance()) {
+			GameInstance->GetTimerManager().ClearTimer(SessionSearchPollTimerHandle);
+		}
+		return;
+	}
+
+	const TArray<FOnlineSessionSearchResult>& SearchResults = LastSessionSearch->SearchResults;
+	for (; SessionSearchCountedResults < SearchResults.Num(); ++SessionSearchCountedResults) {
+		if (IsSessionJoinable(SearchResults[SessionSearchCountedResults])) {
+			++SessionSearchJoinableCount;
+		}
+	}
+
+	//Found enough, stop the backend search and hand out what we have
+	const int32 StopAfterJoinable = ActiveSessionOperation->StopAfterJoinable;
+	if (StopAfterJoinable > 0 && SessionSearchJoinableCount >= StopAfterJoinable) {
+		if (SessionInterface) {
+			SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+			SessionInterface->CancelFindSessions();
+		}
+		FinishStreamingSessionSearch(true);
+		return;
+	}
+
+	EmitSessionSearchPages(false);
+}
+
+void UMultiplayerSessionsSubsystem::EmitSessionSearchPages(bool bIsLastPage)
+{
+	if (!IsActiveSessionOperation(ESessionOperationType::Find) || !LastSessionSearch.IsValid()) {
+		return;
+	}
+
+	const int32 PageSize = ActiveSessionOperation->SearchPageSize;
+	const int32 NumResults = LastSessionSearch->SearchResults.Num();
+	bool bEmittedLastPage = false;
+	while (NumResults - SessionSearchCursor >= PageSize) {
+		const TArrayView<const FOnlineSessionSearchResult> PageView = GetSessionSearchPage(SessionSearchCursor, PageSize);
+		const TArray<FOnlineSessionSearchResult> Page(PageView.GetData(), PageView.Num());
+		SessionSearchCursor += Page.Num();
+		bEmittedLastPage = bIsLastPage && SessionSearchCursor == NumResults;
+		MultiplayerOnFindSessionsPage.Broadcast(Page, SessionSearchCursor, bEmittedLastPage);
+	}
+
+	//The last page may be short, or empty if everything already went out in full pages
+	if (bIsLastPage && !bEmittedLastPage) {
+		const TArrayView<const FOnlineSessionSearchResult> PageView = GetSessionSearchPage(SessionSearchCursor, PageSize);
+		const TArray<FOnlineSessionSearchResult> Page(PageView.GetData(), PageView.Num());
+		SessionSearchCursor += Page.Num();
+		MultiplayerOnFindSessionsPage.Broadcast(Page, SessionSearchCursor, true);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::FinishStreamingSessionSearch(bool bWasSuccessful)
+{
+	if (UGameInstance* GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(SessionSearchPollTimerHandle);
+	}
+	EmitSessionSearchPages(true);
+
+	MultiplayerOnFindSessionsComplete.Broadcast(LastSessionSearch.IsValid() ? LastSessionSearch->SearchResults : TArray<FOnlineSessionSearchResult>(), bWasSuccessful);
+
+	//Queued before the search finishes so the join runs right after it
+	if (IsActiveSessionOperation(ESessionOperationType::Find) && ActiveSessionOperation->bQuickJoin) {
+		const FMultiplayerSessionRankingParams RankingParams = ActiveSessionOperation->RankingParams;
+		JoinBestSearchResult(RankingParams, ActiveSessionOperation->bTravelAfterJoin);
+	}
+	FinishActiveSessionOperation(ESessionOperationType::Find, bWasSuccessful);
+}
+
+void UMultiplayerSessionsSubsystem::ExecuteJoinSession(const FSessionOperation& Operation)
+{
+	if (!IsValidSessionInterface()) {
+		OnJoinSessionComplete(NAME_GameSession, EOnJoinSessionCompleteResult::UnknownError);
+		return;
+	}
+
+	SetSessionState(EMultiplayerSessionState::Joining);
+
+	const FUniqueNetIdPtr LocalUserId = GetLocalUserNetId();
+	if (!LocalUserId.IsValid()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("No local player to join with in UMultiplayerSessionsSubsystem::ExecuteJoinSession"));
+		OnJoinSessionComplete(NAME_GameSession, EOnJoinSessionCompleteResult::UnknownError);
+		return;
+	}
+
+	JoinSessionCompleteDelegateHandle = SessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
+
+	//The map loads from disk while the backend joins, both usually take a similar time
+	if (Operation.bTravelAfterJoin) {
+		BeginJoinTravel();
+		PreloadSessionMap(Operation.SessionResult);
+	}
+
+	if (!SessionInterface->JoinSession(*LocalUserId, NAME_GameSession, Operation.SessionResult)) {
+		OnJoinSessionComplete(NAME_GameSession, EOnJoinSessionCompleteResult::UnknownError);
+	}
+}
+
+bool UMultiplayerSessionsSubsystem::TravelToJoinedSession()
+{
+	if (!IsValidSessionInterface()) {
+		return false;
+	}
+
+	FString ConnectString;
+	FMultiplayerLatencyTimer ResolveTimer = SessionMetrics.Start(EMultiplayerSessionMetric::ResolveConnectString);
+	const bool bResolved = SessionInterface->GetResolvedConnectString(NAME_GameSession, ConnectString);
+	SessionMetrics.Stop(ResolveTimer, bResolved);
+	if (!bResolved) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Could not resolve connect string in UMultiplayerSessionsSubsystem::TravelToJoinedSession"));
+		return false;
+	}
+
+	const UGameInstance* GameInstance = GetGameInstance();
+	APlayerController* PlayerController = GameInstance ? GameInstance->GetFirstLocalPlayerController() : nullptr;
+	if (!PlayerController) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("No local player controller to travel with in UMultiplayerSessionsSubsystem::TravelToJoinedSession"));
+		return false;
+	}
+
+	//Runs until the host's map is loaded, through the handshake and whatever of the preload is left
+	if (bJoinTravelInProgress) {
+		SessionMetrics.Stop(ConnectToSessionTimer, false);
+		ConnectToSessionTimer = SessionMetrics.Start(EMultiplayerSessionMetric::ConnectToSession);
+	}
+	PlayerController->ClientTravel(ConnectString, ETravelType::TRAVEL_Absolute);
+	return true;
+}
+
+void UMultiplayerSessionsSubsystem::BeginJoinTravel()
+{
+	if (bJoinTravelInProgress) {
+		return;
+	}
+	bJoinTravelInProgress = true;
+	JoinToGameTimer = SessionMetrics.Start(EMultiplayerSessionMetric::JoinToGame);
+
+	PostLoadMapDelegateHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &ThisClass::OnJoinTravelMapLoaded);
+	if (GEngine) {
+		TravelFailureDelegateHandle = GEngine->OnTravelFailure().AddUObject(this, &ThisClass::OnJoinTravelFailure);
+		NetworkFailureDelegateHandle = GEngine->OnNetworkFailure().AddUObject(this, &ThisClass::OnJoinNetworkFailure);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::PreloadSessionMap(const FOnlineSessionSearchResult& SessionResult)
+{
+	FString MapName;
+	if (!bPreloadJoinedSessionMap || !SessionResult.Session.SessionSettings.Get(SETTING_MAPNAME, MapName) || !FPackageName::IsValidLongPackageName(MapName)) {
+		return;
+	}
+	//PIE travel loads a prefixed copy of the map, the plain package would be loaded for nothing
+	const UWorld* World = GetWorld();
+	if (World && World->IsPlayInEditor()) {
+		return;
+	}
+
+	const FName PackageName(*MapName);
+	if (PackageName == PreloadingMapName) {
+		return;
+	}
+	PreloadingMapName = PackageName;
+	PreloadedMapWorld = nullptr;
+
+	if (UPackage* Package = FindPackage(nullptr, *MapName); Package && Package->IsFullyLoaded()) {
+		PreloadedMapWorld = UWorld::FindWorldInPackage(Package);
+		return;
+	}
+
+	//A preload of another map still running is no longer wanted
+	SessionMetrics.Discard(PreloadMapTimer);
+	PreloadMapTimer = SessionMetrics.Start(EMultiplayerSessionMetric::PreloadMap);
+	LoadPackageAsync(MapName, FLoadPackageAsyncDelegate::CreateUObject(this, &ThisClass::OnSessionMapPreloaded));
+}
+
+void UMultiplayerSessionsSubsystem::OnSessionMapPreloaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result)
+{
+	//The join moved on to another session or already ended, the timer was stopped then
+	if (!bJoinTravelInProgress || PackageName != PreloadingMapName) {
+		return;
+	}
+	SessionMetrics.Stop(PreloadMapTimer, Result == EAsyncLoadingResult::Succeeded);
+	if (Result != EAsyncLoadingResult::Succeeded || !Package) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Preloading %s failed in UMultiplayerSessionsSubsystem::OnSessionMapPreloaded, travel loads it instead"), *PackageName.ToString());
+		return;
+	}
+	PreloadedMapWorld = UWorld::FindWorldInPackage(Package);
+}
+
+void UMultiplayerSessionsSubsystem::OnJoinTravelMapLoaded(UWorld* LoadedWorld)
+{
+	if (ConnectToSessionTimer.IsRunning() && LoadedWorld && LoadedWorld->GetNetMode() == NM_Client) {
+		FinishJoinTravel(true);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::OnJoinTravelFailure(UWorld* World, ETravelFailure::Type FailureType, const FString& ErrorString)
+{
+	if (ConnectToSessionTimer.IsRunning()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Travel to the joined session failed with %s '%s' in UMultiplayerSessionsSubsystem::OnJoinTravelFailure"), ETravelFailure::ToString(FailureType), *ErrorString);
+		FinishJoinTravel(false);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::OnJoinNetworkFailure(UWorld* World, UNetDriver* NetDriver, ENetworkFailure::Type FailureType, const FString& ErrorString)
+{
+	if (ConnectToSessionTimer.IsRunning()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Connecting to the joined session failed with %s '%s' in UMultiplayerSessionsSubsystem::OnJoinNetworkFailure"), ENetworkFailure::ToString(FailureType), *ErrorString);
+		FinishJoinTravel(false);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::FinishJoinTravel(bool bWasSuccessful)
+{
+	if (!bJoinTravelInProgress) {
+		return;
+	}
+	bJoinTravelInProgress = false;
+	ClearJoinTravelDelegates();
+
+	SessionMetrics.Stop(ConnectToSessionTimer, bWasSuccessful);
+	SessionMetrics.Stop(JoinToGameTimer, bWasSuccessful);
+	//LoadMap flushes a preload of the map it travels to, one still running here was for nothing
+	SessionMetrics.Discard(PreloadMapTimer);
+
+	//LoadMap took the preloaded world over, or travel isn't going to need it
+	PreloadedMapWorld = nullptr;
+	PreloadingMapName = NAME_None;
+
+	MultiplayerOnJoinTravelComplete.Broadcast(bWasSuccessful);
+}
+
+void UMultiplayerSessionsSubsystem::ClearJoinTravelDelegates()
+{
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapDelegateHandle);
+	if (GEngine) {
+		GEngine->OnTravelFailure().Remove(TravelFailureDelegateHandle);
+		GEngine->OnNetworkFailure().Remove(NetworkFailureDelegateHandle);
+	}
+	PostLoadMapDelegateHandle.Reset();
+	TravelFailureDelegateHandle.Reset();
+	NetworkFailureDelegateHandle.Reset();
+}
+
+void UMultiplayerSessionsSubsystem::ExecuteDestroySession()
+{
+	if(!IsValidSessionInterface()) {
+		OnDestroySessionComplete(NAME_GameSession, false);
+		return;
+	}
+
+	//Nothing to destroy
+	if (SessionInterface->GetNamedSession(NAME_GameSession) == nullptr) {
+		OnDestroySessionComplete(NAME_GameSession, true);
+		return;
+	}
+
+	SetSessionState(EMultiplayerSessionState::Destroying);
+
+	//The match is over, its stats shouldn't wait for the timer
+	FlushStats();
+
+	DestroySessionCompleteDelegateHandle = SessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
+
+	if(!SessionInterface->DestroySession(NAME_GameSession)) {
+		OnDestroySessionComplete(NAME_GameSession, false);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::ExecuteStartSession()
+{
+	if (!IsValidSessionInterface() || !HasSessionAvailable()) {
+		OnStartSessionComplete(NAME_GameSession, false);
+		return;
+	}
+
+	//Already running
+	if (SessionState == EMultiplayerSessionState::InProgress) {
+		OnStartSessionComplete(NAME_GameSession, true);
+		return;
+	}
+
+	SetSessionState(EMultiplayerSessionState::Starting);
+
+	StartSessionCompleteDelegateHandle = SessionInterface->AddOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegate);
+
+	if (!SessionInterface->StartSession(NAME_GameSession)) {
+		OnStartSessionComplete(NAME_GameSession, false);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::SetSessionState(EMultiplayerSessionState NewState)
+{
+	if (SessionState == NewState) {
+		return;
+	}
+	const EMultiplayerSessionState OldState = SessionState;
+	SessionState = NewState;
+	MultiplayerOnSessionStateChanged.Broadcast(OldState, NewState);
+}
+
+EMultiplayerSessionState UMultiplayerSessionsSubsystem::GetStateFromNamedSession() const
+{
+	const FNamedOnlineSession* NamedSession = SessionInterface ? SessionInterface->GetNamedSession(NAME_GameSession) : nullptr;
+	if (!NamedSession) {
+		return EMultiplayerSessionState::Idle;
+	}
+
+	switch (NamedSession->SessionState) {
+	case EOnlineSessionState::Creating:
+		return EMultiplayerSessionState::Creating;
+	case EOnlineSessionState::Starting:
+		return EMultiplayerSessionState::Starting;
+	case EOnlineSessionState::InProgress:
+	case EOnlineSessionState::Ending:
+		return EMultiplayerSessionState::InProgress;
+	case EOnlineSessionState::Destroying:
+		return EMultiplayerSessionState::Destroying;
+	case EOnlineSessionState::NoSession:
+		return EMultiplayerSessionState::Idle;
+	default:
+		return EMultiplayerSessionState::Created;
+	}
+}
+
+bool UMultiplayerSessionsSubsystem::IsLanOnlySubsystem()
+{
+	const IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
+	return Subsystem && Subsystem->GetSubsystemName() == NULL_SUBSYSTEM;
+}
+
+bool UMultiplayerSessionsSubsystem::HasSessionAvailable() const
+{
+	return SessionState == EMultiplayerSessionState::Created || SessionState == EMultiplayerSessionState::Starting || SessionState == EMultiplayerSessionState::InProgress;
+}
+
+FMultiplayerInviteHandle UMultiplayerSessionsSubsystem::SendSessionInviteToFriend(APlayerController* PlayerController, const FUniqueNetIdPtr FriendUniqueNetId, const FMultiplayerOnSessionInviteSent& OnInviteSent)
+{
+	TArray<FUniqueNetIdRef> FriendUniqueNetIds;
+	if (FriendUniqueNetId.IsValid()) {
+		FriendUniqueNetIds.Add(FriendUniqueNetId.ToSharedRef());
+	}
+
+	//A single invite is a batch of one
+	return SendSessionInvitesToFriends(PlayerController, FriendUniqueNetIds, FMultiplayerOnSessionInvitesSent::CreateLambda(
+		[OnInviteSent](FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results) {
+			OnInviteSent.ExecuteIfBound(InviteHandle, Results.Num() == 1 && Results[0].bWasSuccessful);
+		}));
+}
+
+FMultiplayerInviteHandle UMultiplayerSessionsSubsystem::SendSessionInvitesToFriends(APlayerController* PlayerController, const TArray<FUniqueNetIdRef>& FriendUniqueNetIds, const FMultiplayerOnSessionInvitesSent& OnInvitesSent)
+{
+	FMultiplayerInviteHandle InviteHandle;
+	InviteHandle.Id = NextInviteHandleId++;
+	if (NextInviteHandleId == 0) {
+		NextInviteHandleId = 1;
+	}
+	PendingInviteCallbacks.Add(InviteHandle.Id, OnInvitesSent);
+	InviteTimers.Add(InviteHandle.Id, SessionMetrics.Start(EMultiplayerSessionMetric::SendSessionInvite));
+
+	TArray<FMultiplayerInviteResult> FailedResults;
+	for (const FUniqueNetIdRef& FriendUniqueNetId : FriendUniqueNetIds) {
+		FailedResults.Add(FMultiplayerInviteResult{ FriendUniqueNetId, false });
 	}
 
-	FindSessionsCompleteDelegateHandle = SessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
+	//Checking whether the input data is valid
+	if (!IsValidSessionInterface()) { 
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Session Interface is not valid in UMultiplayerSessionsSubsystem::SendSessionInvitesToFriends")); CompleteInviteBatch(InviteHandle, FailedResults); return InviteHandle; }
+	if (FriendUniqueNetIds.IsEmpty()) { 
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("No friend Unique Net IDs given in UMultiplayerSessionsSubsystem::SendSessionInvitesToFriends")); CompleteInviteBatch(InviteHandle, FailedResults); return InviteHandle; }
+	if (!PlayerController) { 
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Player Controller is not valid in UMultiplayerSessionsSubsystem::SendSessionInvitesToFriends")); CompleteInviteBatch(InviteHandle, FailedResults); return InviteHandle; }
 
-	LastSessionSearch = MakeShareable(new FOnlineSessionSearch());
-	LastSessionSearch->MaxSearchResults = MaxSearchResults;
-	LastSessionSearch->bIsLanQuery = false;
+	//Creating and checking a local player
+	ULocalPlayer* Player = Cast<ULocalPlayer>(PlayerController->Player);	
+	if (!Player) { 
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Local Player is not valid in UMultiplayerSessionsSubsystem::SendSessionInvitesToFriends")); CompleteInviteBatch(InviteHandle, FailedResults); return InviteHandle; }
 
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	if (!SessionInterface->FindSessions(*LocalPlayer->GetPreferredUniqueNetId(), LastSessionSearch.ToSharedRef())) {
-		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+	FPendingInviteBatch& Batch = InviteBatches.AddDefaulted_GetRef();
+	Batch.InviteHandle = InviteHandle;
+	Batch.ControllerId = Player->GetControllerId();
+	Batch.FriendIds = FriendUniqueNetIds;
+	Batch.Results.Reserve(FriendUniqueNetIds.Num());
 
-		MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
-	}
+	ProcessInviteBatches();
+	return InviteHandle;
 }
 
-void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult)
+void UMultiplayerSessionsSubsystem::UnbindSessionInviteCallback(FMultiplayerInviteHandle InviteHandle)
 {
-	if (!IsValidSessionInterface()) {
-		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+	PendingInviteCallbacks.Remove(InviteHandle.Id);
+}
+
+void UMultiplayerSessionsSubsystem::ProcessInviteBatches()
+{
+	UGameInstance* GameInstance = GetGameInstance();
+	if (InviteBatches.IsEmpty() || !IsValidSessionInterface() || !GameInstance) {
+		if (GameInstance) {
+			GameInstance->GetTimerManager().ClearTimer(InviteBatchTimerHandle);
+		}
 		return;
 	}
 
-	JoinSessionCompleteDelegateHandle = SessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
+	//Creating session if didnt create before. SendSessionInvite wont work if host who sends invite dont have session avaiable.
+	//Every pending batch waits for the same create, OnCreateSessionComplete resumes them
+	if (!HasSessionAvailable()) {
+		if (!bInviteBatchesWaitingForSession) {
+			bInviteBatchesWaitingForSession = true;
+
+			//A create or join already on its way is good enough, otherwise host a session sized for everybody invited
+			if (!IsSessionOperationPending(ESessionOperationType::Create) && !IsSessionOperationPending(ESessionOperationType::Join)) {
+				int32 NumInvitees = 0;
+				for (const FPendingInviteBatch& Batch : InviteBatches) {
+					NumInvitees += Batch.FriendIds.Num();
+				}
+				CreateSession(NumInvitees + 1, LastMatchType.IsEmpty() ? FString("Default") : LastMatchType);
+			}
+		}
+		return;
+	}
 
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	if (!SessionInterface->JoinSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, SessionResult)) {
-		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+	//Refilling the token bucket for the time passed since the last send
+	const double Now = FPlatformTime::Seconds();
+	const double Rate = FMath::Max(InvitesPerSecond, KINDA_SMALL_NUMBER);
+	InviteTokens = LastInviteTokenTime > 0.0 ? FMath::Min<double>(InviteTokens + (Now - LastInviteTokenTime) * Rate, FMath::Max(MaxInviteBurst, 1)) : FMath::Max(MaxInviteBurst, 1);
+	LastInviteTokenTime = Now;
+
+	while (InviteTokens >= 1.0 && !InviteBatches.IsEmpty()) {
+		FPendingInviteBatch& Batch = InviteBatches[0];
+		const FUniqueNetIdRef& FriendUniqueNetId = Batch.FriendIds[Batch.Results.Num()];
+		InviteTokens -= 1.0;
+
+		//Sending session invite, session must be created on player who is sending invite. Using SessionInterface function, because Friends
+		//Interface SendInvite() is implemented only on EOS and EOSPlus
+		const bool bWasSent = SessionInterface->SendSessionInviteToFriend(Batch.ControllerId, NAME_GameSession, *FriendUniqueNetId);
+		if (!bWasSent) {
+			UE_LOG(LogMultiplayerSession, Warning, TEXT("SessionInterface->SendSessionInviteToFriend returned false for %s in UMultiplayerSessionsSubsystem::ProcessInviteBatches"), *FriendUniqueNetId->ToDebugString());
+		}
+		Batch.Results.Add(FMultiplayerInviteResult{ FriendUniqueNetId, bWasSent });
 
-		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+		if (Batch.Results.Num() == Batch.FriendIds.Num()) {
+			CompleteInviteBatch(Batch.InviteHandle, Batch.Results);
+			InviteBatches.RemoveAt(0);
+		}
 	}
-}
 
-void UMultiplayerSessionsSubsystem::DestroySession()
-{
-	if(!IsValidSessionInterface()) {
-		MultiplayerOnDestroySessionComplete.Broadcast(false);
-		return;
+	FTimerManager& TimerManager = GameInstance->GetTimerManager();
+	if (InviteBatches.IsEmpty()) {
+		TimerManager.ClearTimer(InviteBatchTimerHandle);
 	}
-	DestroySessionCompleteDelegateHandle = SessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
-
-	if(!SessionInterface->DestroySession(NAME_GameSession)) {
-		SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
-
-		MultiplayerOnDestroySessionComplete.Broadcast(false);
+	else if (!TimerManager.IsTimerActive(InviteBatchTimerHandle)) {
+		TimerManager.SetTimer(InviteBatchTimerHandle, this, &UMultiplayerSessionsSubsystem::ProcessInviteBatches, 1.f / Rate, true);
 	}
 }
 
-void UMultiplayerSessionsSubsystem::StartSession()
+void UMultiplayerSessionsSubsystem::FailInviteBatches()
 {
-	if (!IsValidSessionInterface()) {
-		MultiplayerOnStartSessionComplete.Broadcast(false);
-		return;
+	for (FPendingInviteBatch& Batch : InviteBatches) {
+		for (int32 Index = Batch.Results.Num(); Index < Batch.FriendIds.Num(); ++Index) {
+			Batch.Results.Add(FMultiplayerInviteResult{ Batch.FriendIds[Index], false });
+		}
+		CompleteInviteBatch(Batch.InviteHandle, Batch.Results);
 	}
+	InviteBatches.Reset();
 
-	StartSessionCompleteDelegateHandle = SessionInterface->AddOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegate);
-
-	if (!SessionInterface->StartSession(NAME_GameSession)) {
-		SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
-
-		MultiplayerOnStartSessionComplete.Broadcast(false);
+	if (UGameInstance* GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(InviteBatchTimerHandle);
 	}
 }
 
-void UMultiplayerSessionsSubsystem::SendSessionInviteToFriend(APlayerController* PlayerController, const FUniqueNetIdPtr FriendUniqueNetId)
+void UMultiplayerSessionsSubsystem::CompleteInviteBatch(FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results)
 {
-	//Checking whether the input data is valid
-	if (!IsValidSessionInterface()) { 
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Session Interface is not valid in UMultiplayerSessionsSubsystem::SendSessionInviteToFriend")); MultiplayerOnSesionInviteSentComplete.Broadcast(false); return; }
-	if (!FriendUniqueNetId.IsValid()) { 
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Friend Unique Net ID is not valid in UMultiplayerSessionsSubsystem::SendSessionInviteToFriend")); MultiplayerOnSesionInviteSentComplete.Broadcast(false); return; }
-	if (!PlayerController) { 
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Player Controller is not valid in UMultiplayerSessionsSubsystem::SendSessionInviteToFriend")); MultiplayerOnSesionInviteSentComplete.Broadcast(false); return; }
-
-	//Creating and checking a local player
-	ULocalPlayer* Player = Cast<ULocalPlayer>(PlayerController->Player);	
-	if (!Player) { 
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Local Player is not valid in UMultiplayerSessionsSubsystem::SendSessionInviteToFriend")); MultiplayerOnSesionInviteSentComplete.Broadcast(false); return; }
-
-	//Creating session if didnt create before. SendSessionInvite wont work if host who sends invite dont have session avaiable
-	if (SessionInterface->GetNamedSession(NAME_GameSession) == nullptr) {
-		CreateSession();
+	FMultiplayerLatencyTimer InviteTimer;
+	if (InviteTimers.RemoveAndCopyValue(InviteHandle.Id, InviteTimer)) {
+		const bool bAllSent = !Results.IsEmpty() && !Results.ContainsByPredicate([](const FMultiplayerInviteResult& Result) { return !Result.bWasSuccessful; });
+		SessionMetrics.Stop(InviteTimer, bAllSent);
 	}
 
-	SessionInviteAcceptedDelegateHandle = SessionInterface->AddOnSessionUserInviteAcceptedDelegate_Handle(SessionInviteAcceptedDelegate);
-
-	//Sending session invite, session must be created on player who is sending invite. Using SessionInterface function, because Friends
-	//Interface SendInvite() is implemented only on EOS and EOSPlus
-	if (SessionInterface->SendSessionInviteToFriend(Player->GetControllerId(), NAME_GameSession, *FriendUniqueNetId)) {
-		MultiplayerOnSesionInviteSentComplete.Broadcast(true); return; 
+	//Deferred to the next tick so the caller always holds the handle before its completion arrives
+	UGameInstance* GameInstance = GetGameInstance();
+	if (GameInstance) {
+		GameInstance->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(this, &UMultiplayerSessionsSubsystem::DispatchInviteBatchComplete, InviteHandle, Results));
 	}
 	else {
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("SessionInterface->SendSessionInviteToFriend returned false, and didnt send invite in UMultiplayerSessionsSubsystem::SendSessionInviteToFriend"));
-		MultiplayerOnSesionInviteSentComplete.Broadcast(false); 
-		SessionInterface->ClearOnSessionUserInviteAcceptedDelegate_Handle(SessionInviteAcceptedDelegateHandle); return;
+		DispatchInviteBatchComplete(InviteHandle, Results);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::DispatchInviteBatchComplete(FMultiplayerInviteHandle InviteHandle, TArray<FMultiplayerInviteResult> Results)
+{
+	FMultiplayerOnSessionInvitesSent OnInvitesSent;
+	if (PendingInviteCallbacks.RemoveAndCopyValue(InviteHandle.Id, OnInvitesSent)) {
+		OnInvitesSent.ExecuteIfBound(InviteHandle, Results);
 	}
 }
 
-void UMultiplayerSessionsSubsystem::GetFriendsList(APlayerController* PlayerController)
+bool UMultiplayerSessionsSubsystem::GetFriendsList(APlayerController* PlayerController, bool bForceRefresh)
 {
 	if (!IsValidFriendsInterface()) {
 		UE_LOG(LogTemp, Warning, TEXT("Friends Interface is not valid in UMultiplayerSessionsSubsystem::GetFriendList"));
-		MultiplayerOnGetFriendsListComplete.Broadcast(false, TArray<TSharedRef<FOnlineFriend>>()); return; }
+		MultiplayerOnGetFriendsListComplete.Broadcast(false, FMultiplayerFriendsListDelta()); return false; }
 	if (!PlayerController) {
 		UE_LOG(LogTemp, Warning, TEXT("Player Controller is not valid in UMultiplayerSessionsSubsystem::GetFriendList"));
-		MultiplayerOnGetFriendsListComplete.Broadcast(false, TArray<TSharedRef<FOnlineFriend>>()); return; }
+		MultiplayerOnGetFriendsListComplete.Broadcast(false, FMultiplayerFriendsListDelta()); return false; }
 
 	ULocalPlayer* Player = Cast<ULocalPlayer>(PlayerController->Player);
 
 	if (!Player) {
 		UE_LOG(LogTemp, Warning, TEXT("Local Player is not valid in UMultiplayerSessionsSubsystem::GetFriendList"));
-		MultiplayerOnGetFriendsListComplete.Broadcast(false, TArray<TSharedRef<FOnlineFriend>>()); return;
+		MultiplayerOnGetFriendsListComplete.Broadcast(false, FMultiplayerFriendsListDelta()); return false;
 	}
 
-	if (!FriendsInterface->ReadFriendsList(Player->GetControllerId(), EFriendsLists::ToString((EFriendsLists::Default)), ReadFriendsListCompleteDelegate)) {
-		MultiplayerOnGetFriendsListComplete.Broadcast(false, TArray<TSharedRef<FOnlineFriend>>());
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("FriendsInterface->ReadFriendsList is failed")));
+	//The cache belongs to a single local user, drop it if another one asks
+	if (CachedFriendsLocalUserNum != Player->GetControllerId()) {
+		InvalidateFriendsListCache();
+		CachedFriendsLocalUserNum = Player->GetControllerId();
 	}
-	else {
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("FriendsInterface->ReadFriendsList is started")));
+
+	//A read is already running, its completion will notify every listener. One issued for another user is dropped
+	//when it lands and this user's read follows it
+	if (bReadFriendsListInFlight) {
+		bReadFriendsListQueued = ReadFriendsListLocalUserNum != CachedFriendsLocalUserNum;
+		return false;
+	}
+
+	//Cache is still fresh, nothing could have changed from the caller's point of view. Only the caller gets the
+	//cached list, listeners already have it
+	if (!bForceRefresh && CachedFriendsReadTime > 0.0 && FPlatformTime::Seconds() - CachedFriendsReadTime < FriendsListCacheTTL) {
+		return true;
+	}
+
+	StartReadFriendsList(CachedFriendsLocalUserNum);
+	return false;
+}
+
+void UMultiplayerSessionsSubsystem::StartReadFriendsList(int32 LocalUserNum)
+{
+	bReadFriendsListInFlight = true;
+	ReadFriendsListLocalUserNum = LocalUserNum;
+	ReadFriendsListTimer = SessionMetrics.Start(EMultiplayerSessionMetric::ReadFriendsList);
+	if (!FriendsInterface->ReadFriendsList(LocalUserNum, EFriendsLists::ToString((EFriendsLists::Default)), ReadFriendsListCompleteDelegate)) {
+		bReadFriendsListInFlight = false;
+		SessionMetrics.Stop(ReadFriendsListTimer, false);
+		MultiplayerOnGetFriendsListComplete.Broadcast(false, FMultiplayerFriendsListDelta());
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("FriendsInterface->ReadFriendsList failed in UMultiplayerSessionsSubsystem::StartReadFriendsList"));
+	}
+}
+
+void UMultiplayerSessionsSubsystem::InvalidateFriendsListCache()
+{
+	bReadFriendsListQueued = false;
+	CachedFriends.Reset();
+	CachedFriendsList.Reset();
+	CachedFriendsReadTime = 0.0;
+}
+
+uint32 UMultiplayerSessionsSubsystem::GetFriendInfoHash(const FOnlineFriend& Friend)
+{
+	uint32 Hash = GetTypeHash(Friend.GetDisplayName());
+	Hash = HashCombine(Hash, GetTypeHash(Friend.GetRealName()));
+	Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(Friend.GetInviteStatus())));
+	return Hash;
+}
+
+uint32 UMultiplayerSessionsSubsystem::GetPresenceHash(const FOnlineUserPresence& Presence)
+{
+	uint32 Hash = GetTypeHash(static_cast<uint8>(Presence.Status.State));
+	Hash = HashCombine(Hash, GetTypeHash(Presence.Status.StatusStr));
+	Hash = HashCombine(Hash, GetTypeHash(Presence.bIsOnline | (Presence.bIsPlaying << 1) | (Presence.bIsPlayingThisGame << 2) | (Presence.bIsJoinable << 3)));
+	return Hash;
+}
+
+uint32 UMultiplayerSessionsSubsystem::GetFriendStateHash(const FOnlineFriend& Friend)
+{
+	return HashCombine(GetFriendInfoHash(Friend), GetPresenceHash(Friend.GetPresence()));
+}
+
+void UMultiplayerSessionsSubsystem::UpdateFriendsListCache(const TArray<TSharedRef<FOnlineFriend>>& FriendsList, FMultiplayerFriendsListDelta& OutDelta)
+{
+	TUniqueNetIdMap<FCachedFriend> NewCachedFriends;
+	NewCachedFriends.Reserve(FriendsList.Num());
+
+	for (const TSharedRef<FOnlineFriend>& Friend : FriendsList) {
+		const uint32 StateHash = GetFriendStateHash(*Friend);
+		const FCachedFriend* Previous = CachedFriends.Find(Friend->GetUserId());
+		if (!Previous) {
+			OutDelta.Added.Add(Friend);
+		}
+		else if (Previous->StateHash != StateHash) {
+			OutDelta.Changed.Add(Friend);
+		}
+		NewCachedFriends.Add(Friend->GetUserId(), FCachedFriend{ Friend, StateHash });
+	}
+
+	for (const TPair<FUniqueNetIdRef, FCachedFriend>& Previous : CachedFriends) {
+		if (!NewCachedFriends.Contains(Previous.Key)) {
+			OutDelta.Removed.Add(Previous.Key);
+		}
 	}
+
+	CachedFriends = MoveTemp(NewCachedFriends);
+	CachedFriendsList = FriendsList;
+	CachedFriendsReadTime = FPlatformTime::Seconds();
 }
 
 TSharedPtr<FOnlineFriend> UMultiplayerSessionsSubsystem::GetFriend(APlayerController* PlayerController, const FUniqueNetIdPtr FriendUniqueNetId)
@@ -278,6 +1341,127 @@ bool UMultiplayerSessionsSubsystem::IsAFriend(APlayerController* PlayerControlle
 	return FriendsInterface->IsFriend(Player->GetControllerId(), *UniqueNetId.Get(), EFriendsLists::ToString(EFriendsLists::Default));;
 }
 
+FMultiplayerPresenceSubscriptionHandle UMultiplayerSessionsSubsystem::SubscribeToFriendPresence(const FMultiplayerOnFriendPresenceChanged& OnPresenceChanged)
+{
+	if (!IsValidPresenceInterface()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Presence Interface is not valid in UMultiplayerSessionsSubsystem::SubscribeToFriendPresence"));
+		return FMultiplayerPresenceSubscriptionHandle();
+	}
+
+	FMultiplayerPresenceSubscriptionHandle SubscriptionHandle;
+	SubscriptionHandle.Id = NextPresenceSubscriptionId++;
+	PresenceSubscribers.Add(SubscriptionHandle.Id, OnPresenceChanged);
+
+	if (!PresenceReceivedDelegateHandle.IsValid()) {
+		PresenceReceivedDelegateHandle = PresenceInterface->AddOnPresenceReceivedDelegate_Handle(PresenceReceivedDelegate);
+	}
+	return SubscriptionHandle;
+}
+
+void UMultiplayerSessionsSubsystem::UnsubscribeFromFriendPresence(FMultiplayerPresenceSubscriptionHandle SubscriptionHandle)
+{
+	PresenceSubscribers.Remove(SubscriptionHandle.Id);
+
+	//Nobody is listening, stop receiving events until someone subscribes again
+	if (PresenceSubscribers.IsEmpty()) {
+		ClearPresenceDelegates();
+	}
+}
+
+const FOnlineUserPresence* UMultiplayerSessionsSubsystem::GetFriendPresence(const FUniqueNetIdPtr FriendUniqueNetId) const
+{
+	const FCachedFriend* CachedFriend = FriendUniqueNetId.IsValid() ? CachedFriends.Find(FriendUniqueNetId.ToSharedRef()) : nullptr;
+	if (!CachedFriend) {
+		return nullptr;
+	}
+	return CachedFriend->Presence.IsValid() ? CachedFriend->Presence.Get() : &CachedFriend->Friend->GetPresence();
+}
+
+void UMultiplayerSessionsSubsystem::OnPresenceReceived(const FUniqueNetId& UserId, const TSharedRef<FOnlineUserPresence>& Presence)
+{
+	//The newest event of a friend replaces the one still waiting for the batch
+	const FUniqueNetIdRef UserIdRef = UserId.AsShared();
+	if (!CachedFriends.Contains(UserIdRef)) {
+		return;
+	}
+	PendingPresenceChanges.Add(UserIdRef, Presence);
+
+	UGameInstance* GameInstance = GetGameInstance();
+	if (GameInstance && !GameInstance->GetTimerManager().IsTimerActive(PresenceCoalesceTimerHandle)) {
+		GameInstance->GetTimerManager().SetTimer(PresenceCoalesceTimerHandle, this, &UMultiplayerSessionsSubsystem::FlushPresenceChanges, FMath::Max(PresenceCoalesceWindow, 0.01f), false);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::FlushPresenceChanges()
+{
+	TArray<FMultiplayerFriendPresenceChange> Changes;
+	Changes.Reserve(PendingPresenceChanges.Num());
+
+	for (const TPair<FUniqueNetIdRef, TSharedRef<FOnlineUserPresence>>& PendingChange : PendingPresenceChanges) {
+		FCachedFriend* CachedFriend = CachedFriends.Find(PendingChange.Key);
+		if (!CachedFriend) {
+			continue;
+		}
+
+		//Repeated events, or a friend that went back to where they were within the window
+		const uint32 StateHash = HashCombine(GetFriendInfoHash(*CachedFriend->Friend), GetPresenceHash(*PendingChange.Value));
+		if (StateHash == CachedFriend->StateHash) {
+			continue;
+		}
+
+		//The cache takes the change too, so the next friends read doesn't report it again
+		CachedFriend->StateHash = StateHash;
+		CachedFriend->Presence = PendingChange.Value;
+		Changes.Add(FMultiplayerFriendPresenceChange{ PendingChange.Key, PendingChange.Value });
+	}
+	PendingPresenceChanges.Reset();
+
+	if (Changes.IsEmpty()) {
+		return;
+	}
+
+	//Subscribers may unsubscribe from their callback
+	TArray<FMultiplayerOnFriendPresenceChanged> Subscribers;
+	PresenceSubscribers.GenerateValueArray(Subscribers);
+	for (const FMultiplayerOnFriendPresenceChanged& Subscriber : Subscribers) {
+		Subscriber.ExecuteIfBound(Changes);
+	}
+}
+
+FMultiplayerAvatarService& UMultiplayerSessionsSubsystem::GetAvatarService()
+{
+	if (!AvatarService) {
+		AvatarService = MakeUnique<FMultiplayerAvatarService>(AvatarCacheBudgetKB, MaxAvatarUploadsPerFrame);
+		AvatarService->SetProvider(AvatarProviderOverride ? AvatarProviderOverride : FMultiplayerAvatarService::CreatePlatformProvider());
+	}
+	return *AvatarService;
+}
+
+UTexture2D* UMultiplayerSessionsSubsystem::GetFriendAvatar(const FUniqueNetIdPtr UniqueNetId, SteamAvatarSize AvatarSize, const FMultiplayerOnAvatarReady& OnReady, FMultiplayerAvatarRequestHandle& OutHandle)
+{
+	OutHandle.Reset();
+	if (!UniqueNetId.IsValid()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Unique Net ID is not valid in UMultiplayerSessionsSubsystem::GetFriendAvatar"));
+		return nullptr;
+	}
+	return GetAvatarService().RequestAvatar(*UniqueNetId, AvatarSize, OnReady, OutHandle);
+}
+
+void UMultiplayerSessionsSubsystem::CancelFriendAvatarRequest(FMultiplayerAvatarRequestHandle RequestHandle)
+{
+	if (AvatarService) {
+		AvatarService->CancelRequest(RequestHandle);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::SetAvatarProviderOverride(const FMultiplayerAvatarProviderPtr& Provider)
+{
+	AvatarProviderOverride = Provider;
+	if (AvatarService) {
+		AvatarService->SetProvider(AvatarProviderOverride ? AvatarProviderOverride : FMultiplayerAvatarService::CreatePlatformProvider());
+	}
+}
+
 bool UMultiplayerSessionsSubsystem::ServerTravel(UObject* WorldContextObject, const FString& InURL, bool bAbsolute, bool bShouldSkipGameNotify)
 {
 	if (!WorldContextObject) {
@@ -394,56 +1578,213 @@ void UMultiplayerSessionsSubsystem::ShowSendMessageToUserUI(APlayerController* P
 	ExternalUIInterface->ShowSendMessageToUserUI(Player->GetControllerId(), Recipient, ShowParams);
 }
 
-void UMultiplayerSessionsSubsystem::ReadAchievements(const FUniqueNetIdPtr PlayerId)
+void UMultiplayerSessionsSubsystem::PrefetchAchievements(const FUniqueNetIdPtr PlayerId, bool bForceRefresh)
 {
 	if (!IsValidAchievementsInterface()) {
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Achievements Interface is not valid in UMultiplayerSessionsSubsystem::ReadAchievements")); return; }
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Achievements Interface is not valid in UMultiplayerSessionsSubsystem::PrefetchAchievements")); return; }
+	if (!PlayerId.IsValid()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Player Id is not valid in UMultiplayerSessionsSubsystem::PrefetchAchievements")); return; }
+
+	if (!AchievementUnlockedDelegateHandle.IsValid()) {
+		AchievementUnlockedDelegateHandle = AchievementsInterface->AddOnAchievementUnlockedDelegate_Handle(
+			FOnAchievementUnlockedDelegate::CreateUObject(this, &ThisClass::OnAchievementUnlocked));
+	}
+
+	//A query still running for the previous player completes as stale, the new player gets its own
+	if (!AchievementsPlayerId.IsValid() || *AchievementsPlayerId != *PlayerId) {
+		AchievementsPlayerId = PlayerId;
+		AchievementSnapshot.Reset();
+		bAchievementsQueryInFlight = false;
+	}
+	else if (AchievementSnapshot.IsValid() && !bForceRefresh) {
+		MultiplayerOnAchievementsReady.Broadcast(true);
+		return;
+	}
 
-	AchievementsInterface->QueryAchievements(*PlayerId);
+	if (!bAchievementsQueryInFlight) {
+		QueryPlayerAchievements();
+	}
+	if (!bAchievementDescriptionsLoaded && !bAchievementDescriptionsQueryInFlight) {
+		bAchievementDescriptionsQueryInFlight = true;
+		FMultiplayerLatencyTimer QueryTimer = SessionMetrics.Start(EMultiplayerSessionMetric::QueryAchievementDescriptions);
+		AchievementsInterface->QueryAchievementDescriptions(*PlayerId, FOnQueryAchievementsCompleteDelegate::CreateWeakLambda(this,
+			[this, QueryTimer](const FUniqueNetId& QueriedPlayerId, const bool bWasSuccessful) mutable {
+				SessionMetrics.Stop(QueryTimer, bWasSuccessful);
+				OnQueryAchievementDescriptionsComplete(QueriedPlayerId, bWasSuccessful);
+			}));
+	}
 }
 
-void UMultiplayerSessionsSubsystem::ReadAchievementDescriptions(const FUniqueNetIdPtr PlayerId)
+const FOnlineAchievement* UMultiplayerSessionsSubsystem::FindAchievement(FName AchievementId) const
 {
-	if (!IsValidAchievementsInterface()) {
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Achievements Interface is not valid in UMultiplayerSessionsSubsystem::ReadAchievementDescriptions")); return; }
+	return AchievementSnapshot.IsValid() ? AchievementSnapshot->FindAchievement(AchievementId) : nullptr;
+}
 
-	AchievementsInterface->QueryAchievementDescriptions(*PlayerId);
+const FOnlineAchievementDesc* UMultiplayerSessionsSubsystem::FindAchievementDescription(FName AchievementId) const
+{
+	return AchievementSnapshot.IsValid() ? AchievementSnapshot->FindDescription(AchievementId) : nullptr;
 }
 
-FOnlineAchievement UMultiplayerSessionsSubsystem::GetAchievement(const FUniqueNetIdPtr PlayerId, FString AchievementId)
+void UMultiplayerSessionsSubsystem::QueryPlayerAchievements()
 {
-	if (!IsValidAchievementsInterface()) {
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Achievements Interface is not valid in UMultiplayerSessionsSubsystem::GetAchievement")); return FOnlineAchievement(); }
-	FOnlineAchievement AchievementStatus;
-	if(AchievementsInterface->GetCachedAchievement(*PlayerId, AchievementId, AchievementStatus) == EOnlineCachedResult::Success) {
-		return AchievementStatus;
+	bAchievementsQueryInFlight = true;
+	FMultiplayerLatencyTimer QueryTimer = SessionMetrics.Start(EMultiplayerSessionMetric::QueryAchievements);
+	AchievementsInterface->QueryAchievements(*AchievementsPlayerId, FOnQueryAchievementsCompleteDelegate::CreateWeakLambda(this,
+		[this, QueryTimer](const FUniqueNetId& QueriedPlayerId, const bool bWasSuccessful) mutable {
+			SessionMetrics.Stop(QueryTimer, bWasSuccessful);
+			OnQueryAchievementsComplete(QueriedPlayerId, bWasSuccessful);
+		}));
+}
+
+void UMultiplayerSessionsSubsystem::OnQueryAchievementsComplete(const FUniqueNetId& PlayerId, const bool bWasSuccessful)
+{
+	if (!AchievementsPlayerId.IsValid() || *AchievementsPlayerId != PlayerId) {
+		return;
 	}
-	else {
-		return FOnlineAchievement();
+	bAchievementsQueryInFlight = false;
+	bAchievementQueriesFailed |= !bWasSuccessful;
+	FinishAchievementPrefetch();
+}
+
+void UMultiplayerSessionsSubsystem::OnQueryAchievementDescriptionsComplete(const FUniqueNetId& PlayerId, const bool bWasSuccessful)
+{
+	bAchievementDescriptionsQueryInFlight = false;
+	bAchievementDescriptionsLoaded = bWasSuccessful;
+	bAchievementQueriesFailed |= !bWasSuccessful;
+	FinishAchievementPrefetch();
+}
+
+void UMultiplayerSessionsSubsystem::FinishAchievementPrefetch()
+{
+	if (bAchievementsQueryInFlight || bAchievementDescriptionsQueryInFlight || !AchievementsPlayerId.IsValid() || !IsValidAchievementsInterface()) {
+		return;
+	}
+
+	if (bAchievementQueriesFailed) {
+		//A failed refresh keeps the previous snapshot, readers only lose freshness
+		bAchievementQueriesFailed = false;
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Querying achievements of %s failed in UMultiplayerSessionsSubsystem::FinishAchievementPrefetch"), *AchievementsPlayerId->ToDebugString());
+		MultiplayerOnAchievementsReady.Broadcast(false);
+		return;
 	}
+
+	AchievementSnapshot = FMultiplayerAchievementSnapshot::Create(*AchievementsInterface, *AchievementsPlayerId);
+	MultiplayerOnAchievementsReady.Broadcast(true);
 }
 
-FOnlineAchievementDesc UMultiplayerSessionsSubsystem::GetAchievementDescription(FString AchievementId)
+void UMultiplayerSessionsSubsystem::OnAchievementUnlocked(const FUniqueNetId& PlayerId, const FString& AchievementId)
 {
-	if (!IsValidAchievementsInterface()) {
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Achievements Interface is not valid in UMultiplayerSessionsSubsystem::GetAchievementDescription")); return FOnlineAchievementDesc(); }
-	FOnlineAchievementDesc AchievementDescriptionStatus;
-	if (AchievementsInterface->GetCachedAchievementDescription(AchievementId, AchievementDescriptionStatus) == EOnlineCachedResult::Success) {
-		return AchievementDescriptionStatus;
+	//Descriptions don't change with an unlock, only the player's progress is queried again
+	if (AchievementsPlayerId.IsValid() && *AchievementsPlayerId == PlayerId && !bAchievementsQueryInFlight && IsValidAchievementsInterface()) {
+		QueryPlayerAchievements();
 	}
-	else {
-		return FOnlineAchievementDesc();
+}
+
+void UMultiplayerSessionsSubsystem::ClearAchievementDelegates()
+{
+	if (AchievementsInterface) {
+		AchievementsInterface->ClearOnAchievementUnlockedDelegate_Handle(AchievementUnlockedDelegateHandle);
 	}
+	AchievementUnlockedDelegateHandle.Reset();
 }
 
 void UMultiplayerSessionsSubsystem::WriteAchievement(const FUniqueNetIdPtr UniqueNetId, FName StatName, float Value)
 {
+	QueueStat(UniqueNetId, StatName, Value, true);
+}
+
+void UMultiplayerSessionsSubsystem::AddStat(const FUniqueNetIdPtr UniqueNetId, FName StatName, float Delta)
+{
+	QueueStat(UniqueNetId, StatName, Delta, false);
+}
+
+bool UMultiplayerSessionsSubsystem::QueueStat(const FUniqueNetIdPtr& UniqueNetId, FName StatName, float Value, bool bIsSet)
+{
+	if (!UniqueNetId.IsValid()) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Unique Net ID is not valid in UMultiplayerSessionsSubsystem::QueueStat")); return false; }
+
+	//Full queue, write what can be written now to make room
+	if (StatAggregator.IsFull()) {
+		FlushStats();
+	}
+
+	const FUniqueNetIdRef PlayerId = UniqueNetId.ToSharedRef();
+	const bool bQueued = bIsSet ? StatAggregator.SetStat(PlayerId, StatName, Value) : StatAggregator.AddStat(PlayerId, StatName, Value);
+	if (!bQueued) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Stat queue is full, dropping %s in UMultiplayerSessionsSubsystem::QueueStat"), *StatName.ToString());
+		return false;
+	}
+
+	UGameInstance* GameInstance = GetGameInstance();
+	if (GameInstance && !GameInstance->GetTimerManager().IsTimerActive(StatFlushTimerHandle)) {
+		ScheduleStatFlush();
+	}
+	return true;
+}
+
+void UMultiplayerSessionsSubsystem::FlushStats()
+{
+	if (UGameInstance* GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(StatFlushTimerHandle);
+	}
+	if (!StatAggregator.HasPendingStats()) {
+		return;
+	}
 	if (!IsValidAchievementsInterface()) {
-		UE_LOG(LogMultiplayerSession, Warning, TEXT("Achievements Interface is not valid in UMultiplayerSessionsSubsystem::WriteAchievement")); return; }
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Achievements Interface is not valid in UMultiplayerSessionsSubsystem::FlushStats"));
+		ScheduleStatFlush();
+		return;
+	}
+
+	TArray<TPair<FUniqueNetIdRef, FOnlineAchievementsWriteRef>> Writes;
+	StatAggregator.TakeWrites(FPlatformTime::Seconds(), Writes);
+	for (TPair<FUniqueNetIdRef, FOnlineAchievementsWriteRef>& Write : Writes) {
+		FMultiplayerLatencyTimer WriteTimer = SessionMetrics.Start(EMultiplayerSessionMetric::WriteAchievements);
+		AchievementsInterface->WriteAchievements(*Write.Key, Write.Value, FOnAchievementsWrittenDelegate::CreateWeakLambda(this,
+			[this, PlayerId = Write.Key, WriteTimer](const FUniqueNetId& WrittenPlayerId, bool bWasSuccessful) mutable {
+				SessionMetrics.Stop(WriteTimer, bWasSuccessful);
+				OnStatsWritten(PlayerId, bWasSuccessful);
+			}));
+	}
+
+	//Players with a write in flight or waiting to retry go out with a later flush
+	if (StatAggregator.HasPendingStats()) {
+		ScheduleStatFlush();
+	}
+}
+
+void UMultiplayerSessionsSubsystem::ScheduleStatFlush()
+{
+	UGameInstance* GameInstance = GetGameInstance();
+	if (!GameInstance) {
+		return;
+	}
+
+	float Delay = FMath::Max(StatFlushInterval, 0.1f);
+	const double NextRetryTime = StatAggregator.GetNextRetryTime();
+	if (NextRetryTime > 0.0) {
+		Delay = FMath::Clamp(float(NextRetryTime - FPlatformTime::Seconds()), 0.1f, Delay);
+	}
+
+	//Only ever brought forward
+	FTimerManager& TimerManager = GameInstance->GetTimerManager();
+	if (TimerManager.IsTimerActive(StatFlushTimerHandle) && TimerManager.GetTimerRemaining(StatFlushTimerHandle) <= Delay) {
+		return;
+	}
+	TimerManager.SetTimer(StatFlushTimerHandle, this, &UMultiplayerSessionsSubsystem::FlushStats, Delay, false);
+}
+
+void UMultiplayerSessionsSubsystem::OnStatsWritten(const FUniqueNetIdRef& PlayerId, bool bWasSuccessful)
+{
+	if (!bWasSuccessful) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("WriteAchievements failed for %s in UMultiplayerSessionsSubsystem::OnStatsWritten"), *PlayerId->ToDebugString());
+	}
+	StatAggregator.CompleteWrite(PlayerId, bWasSuccessful, FPlatformTime::Seconds());
 
-	FOnlineAchievementsWriteRef WriteObject;
-	WriteObject->SetFloatStat(StatName, Value);
-	AchievementsInterface->WriteAchievements(*UniqueNetId, WriteObject);
+	//A retry or changes queued while this write was in flight
+	if (StatAggregator.HasPendingStats()) {
+		ScheduleStatFlush();
+	}
 }
 
 void UMultiplayerSessionsSubsystem::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
@@ -452,7 +1793,21 @@ void UMultiplayerSessionsSubsystem::OnCreateSessionComplete(FName SessionName, b
 		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
 	}
 
+	SetSessionState(bWasSuccessful ? EMultiplayerSessionState::Created : GetStateFromNamedSession());
+
+	//Resuming the invite batches that were waiting for the host session
+	if (bInviteBatchesWaitingForSession) {
+		bInviteBatchesWaitingForSession = false;
+		if (bWasSuccessful) {
+			ProcessInviteBatches();
+		}
+		else {
+			FailInviteBatches();
+		}
+	}
+
 	MultiplayerOnCreateSessionComplete.Broadcast(bWasSuccessful);
+	FinishActiveSessionOperation(ESessionOperationType::Create, bWasSuccessful);
 }
 
 void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
@@ -460,16 +1815,29 @@ void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
 	if (SessionInterface) {
 		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
 	}
-	if (LastSessionSearch->SearchResults.Num() <= 0) {
-		MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+
+	if (IsActiveSessionOperation(ESessionOperationType::Find) && ActiveSessionOperation->bStreamSearchResults) {
+		FinishStreamingSessionSearch(bWasSuccessful);
 		return;
 	}
 
-	MultiplayerOnFindSessionsComplete.Broadcast(LastSessionSearch->SearchResults, bWasSuccessful);
+	//An empty result is a successful search that found nothing, only bWasSuccessful tells about failures
+	MultiplayerOnFindSessionsComplete.Broadcast(LastSessionSearch.IsValid() ? LastSessionSearch->SearchResults : TArray<FOnlineSessionSearchResult>(), bWasSuccessful);
+	FinishActiveSessionOperation(ESessionOperationType::Find, bWasSuccessful);
 }
 
 void UMultiplayerSessionsSubsystem::OnCancelFindSessionsComplete(bool bWasSuccessful)
 {
+	if (SessionInterface) {
+		SessionInterface->ClearOnCancelFindSessionsCompleteDelegate_Handle(CancelFindSessionsCompleteDelegateHandle);
+	}
+	MultiplayerOnCancelFindSessionsComplete.Broadcast(bWasSuccessful);
+
+	//The cancelled search won't report on its own anymore. It didn't fail, so it leaves no sample behind
+	if (bWasSuccessful && IsActiveSessionOperation(ESessionOperationType::Find)) {
+		SessionMetrics.Discard(SessionOperationTimer);
+		OnFindSessionsComplete(false);
+	}
 }
 
 void UMultiplayerSessionsSubsystem::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
@@ -477,7 +1845,26 @@ void UMultiplayerSessionsSubsystem::OnJoinSessionComplete(FName SessionName, EOn
 	if (SessionInterface) {
 		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
 	}
+	SetSessionState(GetStateFromNamedSession());
+
+	//Invite joins, and callers that asked for it, have no menu travelling for them, so the subsystem takes the player to the host itself
+	if (ActiveSessionOperation.IsSet() && ActiveSessionOperation->bTravelAfterJoin) {
+		if (Result != EOnJoinSessionCompleteResult::Success || !TravelToJoinedSession()) {
+			FinishJoinTravel(false);
+		}
+	}
+
+	const bool bResumeInviteBatches = bInviteBatchesWaitingForSession;
+	bInviteBatchesWaitingForSession = false;
+
 	MultiplayerOnJoinSessionComplete.Broadcast(Result);
+	FinishActiveSessionOperation(ESessionOperationType::Join, Result == EOnJoinSessionCompleteResult::Success);
+
+	//Invites can go out to the joined session, or a new one gets created if joining failed. Only once the join is
+	//finished, while it is still pending ProcessInviteBatches would keep waiting for it
+	if (bResumeInviteBatches) {
+		ProcessInviteBatches();
+	}
 }
 
 void UMultiplayerSessionsSubsystem::OnDestroySessionComplete(FName SessionName, bool bWasSuccessful)
@@ -485,11 +1872,22 @@ void UMultiplayerSessionsSubsystem::OnDestroySessionComplete(FName SessionName,
 	if (SessionInterface) {
 		SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
 	}
-	if (bWasSuccessful && bCreateSessionOnDestroy) {
-		bCreateSessionOnDestroy = false;
-		CreateSession(LastNumPublicConnections, LastMatchType);
-	}
+	SetSessionState(bWasSuccessful ? EMultiplayerSessionState::Idle : GetStateFromNamedSession());
+
 	MultiplayerOnDestroySessionComplete.Broadcast(bWasSuccessful);
+
+	//Destroy was the first half of a create, carry on with the create now that the old session is gone
+	if (IsActiveSessionOperation(ESessionOperationType::Create)) {
+		if (bWasSuccessful) {
+			const FSessionOperation Operation = *ActiveSessionOperation;
+			ExecuteCreateSession(Operation);
+		}
+		else {
+			OnCreateSessionComplete(NAME_GameSession, false);
+		}
+		return;
+	}
+	FinishActiveSessionOperation(ESessionOperationType::Destroy, bWasSuccessful);
 }
 
 void UMultiplayerSessionsSubsystem::OnStartSessionComplete(FName SessionName,bool bWasSuccessful)
@@ -497,41 +1895,61 @@ void UMultiplayerSessionsSubsystem::OnStartSessionComplete(FName SessionName,boo
 	if (SessionInterface) {
 		SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
 	}
+	SetSessionState(bWasSuccessful ? EMultiplayerSessionState::InProgress : GetStateFromNamedSession());
+
 	MultiplayerOnStartSessionComplete.Broadcast(bWasSuccessful);
+	FinishActiveSessionOperation(ESessionOperationType::Start, bWasSuccessful);
 }
 
 void UMultiplayerSessionsSubsystem::OnSessionInviteReceived(const FUniqueNetId& UserId, const FUniqueNetId& FromId, const FString& AppId, const FOnlineSessionSearchResult& InviteResult)
 {
-	UE_LOG(LogTemp, Warning, TEXT("Session invite received successfuly"));
-	GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("OnSessionInviteReceived")));
+	UE_LOG(LogMultiplayerSession, Log, TEXT("Session invite from %s received in UMultiplayerSessionsSubsystem::OnSessionInviteReceived"), *FromId.ToDebugString());
 	MultiplayerOnSessionInviteReceived.Broadcast(UserId, FromId,InviteResult);
 }
 
 void UMultiplayerSessionsSubsystem::OnSessionUserInviteAccepted(const bool bWasSuccessful, const int32 ControllerId, FUniqueNetIdPtr UserId, const FOnlineSessionSearchResult& InviteResult)
 {
-	UE_LOG(LogTemp, Warning, TEXT("Session invite accepted successfuly"));
-	if (SessionInterface) {
-		SessionInterface->ClearOnSessionUserInviteAcceptedDelegate_Handle(SessionInviteAcceptedDelegateHandle);
+	if (!bWasSuccessful) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Session invite accept failed in UMultiplayerSessionsSubsystem::OnSessionUserInviteAccepted"));
+		return;
 	}
-	ServerTravel(this, "/Game/Maps/BasicLevel", false, false);
+
+	//The invitee joins the host's session and connects to it. Moving the lobby to the match map is the host's job
+	FSessionOperation Operation;
+	Operation.Type = ESessionOperationType::Join;
+	Operation.SessionResult = InviteResult;
+	Operation.bTravelAfterJoin = true;
+	BeginJoinTravel();
+	EnqueueSessionOperation(MoveTemp(Operation));
 }
 
 void UMultiplayerSessionsSubsystem::OnReadFriendsListComplete(int32 LocalUserNum, bool bWasSuccessful, const FString& ListName, const FString& ErrorStr)
 {
-	GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("UMultiplayerSessionsSubsystem::OnReadFriendsListComplete")));
-	if (bWasSuccessful) {
-		TArray<TSharedRef<FOnlineFriend>> FriendList;
-		if (FriendsInterface->GetFriendsList(LocalUserNum, EFriendsLists::ToString((EFriendsLists::Default)), FriendList)) {
-			MultiplayerOnGetFriendsListComplete.Broadcast(true, FriendList);
-			GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("UMultiplayerSessionsSubsystem::OnReadFriendsListComplete successfuly")));
-		}
-		else {
-			MultiplayerOnGetFriendsListComplete.Broadcast(false, TArray<TSharedRef<FOnlineFriend>>());
-			GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("FriendsInterface->GetFriendsList failed")));
+	bReadFriendsListInFlight = false;
+	SessionMetrics.Stop(ReadFriendsListTimer, bWasSuccessful);
+
+	//Another local user took the cache over while this read was running, the list belongs to the previous one
+	if (ReadFriendsListLocalUserNum != CachedFriendsLocalUserNum) {
+		UE_LOG(LogMultiplayerSession, Verbose, TEXT("Dropping the friends list of local user %d in UMultiplayerSessionsSubsystem::OnReadFriendsListComplete"), ReadFriendsListLocalUserNum);
+		if (bReadFriendsListQueued && IsValidFriendsInterface()) {
+			bReadFriendsListQueued = false;
+			StartReadFriendsList(CachedFriendsLocalUserNum);
 		}
+		return;
 	}
-	else {
-		MultiplayerOnGetFriendsListComplete.Broadcast(false, TArray<TSharedRef<FOnlineFriend>>());
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("UMultiplayerSessionsSubsystem::OnReadFriendsListComplete bWasSuccessful is false")));
+
+	if (!bWasSuccessful) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("ReadFriendsList failed with error '%s' in UMultiplayerSessionsSubsystem::OnReadFriendsListComplete"), *ErrorStr);
+		MultiplayerOnGetFriendsListComplete.Broadcast(false, FMultiplayerFriendsListDelta()); return;
 	}
-}
\ No newline at end of file
+
+	TArray<TSharedRef<FOnlineFriend>> FriendList;
+	if (!FriendsInterface || !FriendsInterface->GetFriendsList(LocalUserNum, ListName, FriendList)) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("FriendsInterface->GetFriendsList failed in UMultiplayerSessionsSubsystem::OnReadFriendsListComplete"));
+		MultiplayerOnGetFriendsListComplete.Broadcast(false, FMultiplayerFriendsListDelta()); return;
+	}
+
+	FMultiplayerFriendsListDelta Delta;
+	UpdateFriendsListCache(FriendList, Delta);
+	MultiplayerOnGetFriendsListComplete.Broadcast(true, Delta);
+}
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerStatAggregator.h"
+#include "MultiplayerSessionsSubsystem.h"
+
+void FMultiplayerPendingStat::Merge(const FMultiplayerPendingStat& Newer)
+{
+	if (Newer.bIsSet) {
+		*this = Newer;
+	}
+	else {
+		Value += Newer.Value;
+	}
+}
+
+bool FMultiplayerStatAggregator::AddStat(const FUniqueNetIdRef& PlayerId, FName StatName, float Delta)
+{
+	return QueueStat(PlayerId, StatName, FMultiplayerPendingStat{ Delta, false });
+}
+
+bool FMultiplayerStatAggregator::SetStat(const FUniqueNetIdRef& PlayerId, FName StatName, float Value)
+{
+	return QueueStat(PlayerId, StatName, FMultiplayerPendingStat{ Value, true });
+}
+
+bool FMultiplayerStatAggregator::QueueStat(const FUniqueNetIdRef& PlayerId, FName StatName, const FMultiplayerPendingStat& Change)
+{
+	FPlayerStats* PlayerStats = Players.Find(PlayerId);
+	FMultiplayerPendingStat* PendingStat = PlayerStats ? PlayerStats->PendingStats.Find(StatName) : nullptr;
+
+	//Merging into a queued stat doesn't grow the queue, only new stats are bounded
+	if (PendingStat) {
+		PendingStat->Merge(Change);
+		return true;
+	}
+	if (IsFull()) {
+		return false;
+	}
+
+	if (!PlayerStats) {
+		PlayerStats = &Players.Add(PlayerId);
+	}
+	PlayerStats->PendingStats.Add(StatName, Change);
+	++NumPendingStats;
+	return true;
+}
+
+void FMultiplayerStatAggregator::TakeWrites(double Now, TArray<TPair<FUniqueNetIdRef, FOnlineAchievementsWriteRef>>& OutWrites)
+{
+	for (TPair<FUniqueNetIdRef, FPlayerStats>& Player : Players) {
+		FPlayerStats& PlayerStats = Player.Value;
+		if (PlayerStats.bWriteInFlight || PlayerStats.PendingStats.IsEmpty() || PlayerStats.RetryTime > Now) {
+			continue;
+		}
+
+		FOnlineAchievementsWriteRef WriteObject = MakeShared<FOnlineAchievementsWrite, ESPMode::ThreadSafe>();
+		for (const TPair<FName, FMultiplayerPendingStat>& PendingStat : PlayerStats.PendingStats) {
+			if (PendingStat.Value.bIsSet) {
+				WriteObject->SetFloatStat(PendingStat.Key, PendingStat.Value.Value);
+			}
+			else {
+				WriteObject->IncrementFloatStat(PendingStat.Key, PendingStat.Value.Value);
+			}
+		}
+
+		NumPendingStats -= PlayerStats.PendingStats.Num();
+		PlayerStats.InFlightStats = MoveTemp(PlayerStats.PendingStats);
+		PlayerStats.PendingStats.Reset();
+		PlayerStats.bWriteInFlight = true;
+		OutWrites.Emplace(Player.Key, WriteObject);
+	}
+}
+
+void FMultiplayerStatAggregator::CompleteWrite(const FUniqueNetIdRef& PlayerId, bool bWasSuccessful, double Now)
+{
+	FPlayerStats* PlayerStats = Players.Find(PlayerId);
+	if (!PlayerStats || !PlayerStats->bWriteInFlight) {
+		return;
+	}
+	PlayerStats->bWriteInFlight = false;
+
+	if (!bWasSuccessful && PlayerStats->Retries < Limits.MaxRetries) {
+		//The failed changes are older than whatever was queued while they were in flight
+		TMap<FName, FMultiplayerPendingStat> RetryStats = MoveTemp(PlayerStats->InFlightStats);
+		for (const TPair<FName, FMultiplayerPendingStat>& PendingStat : PlayerStats->PendingStats) {
+			RetryStats.FindOrAdd(PendingStat.Key).Merge(PendingStat.Value);
+		}
+		NumPendingStats += RetryStats.Num() - PlayerStats->PendingStats.Num();
+		PlayerStats->PendingStats = MoveTemp(RetryStats);
+		PlayerStats->RetryTime = Now + Limits.RetryDelaySeconds * FMath::Pow(2.f, float(PlayerStats->Retries));
+		++PlayerStats->Retries;
+		return;
+	}
+
+	if (!bWasSuccessful) {
+		UE_LOG(LogMultiplayerSession, Warning, TEXT("Dropping %d stat changes of %s after %d retries in FMultiplayerStatAggregator::CompleteWrite"),
+			PlayerStats->InFlightStats.Num(), *PlayerId->ToDebugString(), PlayerStats->Retries);
+	}
+	PlayerStats->InFlightStats.Reset();
+	PlayerStats->Retries = 0;
+	PlayerStats->RetryTime = 0.0;
+	if (PlayerStats->PendingStats.IsEmpty()) {
+		Players.Remove(PlayerId);
+	}
+}
+
+double FMultiplayerStatAggregator::GetNextRetryTime() const
+{
+	double NextRetryTime = 0.0;
+	for (const TPair<FUniqueNetIdRef, FPlayerStats>& Player : Players) {
+		if (Player.Value.RetryTime > 0.0 && !Player.Value.PendingStats.IsEmpty() && (NextRetryTime == 0.0 || Player.Value.RetryTime < NextRetryTime)) {
+			NextRetryTime = Player.Value.RetryTime;
+		}
+	}
+	return NextRetryTime;
+}
+
+void FMultiplayerStatAggregator::Reset()
+{
+	Players.Reset();
+	NumPendingStats = 0;
+}
@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerFakeOnlineServices.h"
+#include "OnlineSubsystemTypes.h"
+#include "Misc/AutomationTest.h"
+#include "Containers/Ticker.h"
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Drives UMultiplayerSessionsSubsystem through FMultiplayerFakeOnlineBackend in a standalone game instance. Every
+ * case gets its own game instance and backend, the settings decide how the fake answers
+ */
+BEGIN_DEFINE_SPEC(FMultiplayerSessionsSubsystemSpec, "MultiplayerSessions.Subsystem", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	UGameInstance* GameInstance{ nullptr };
+	UMultiplayerSessionsSubsystem* Subsystem{ nullptr };
+	APlayerController* PlayerController{ nullptr };
+	TSharedPtr<FMultiplayerFakeOnlineBackend, ESPMode::ThreadSafe> Backend;
+	FTSTicker::FDelegateHandle TimerTickerHandle;
+
+	void SetUpSubsystem(const FMultiplayerFakeOnlineSettings& Settings);
+	void TearDownSubsystem();
+	TArray<FUniqueNetIdRef> MakeFriendIds(int32 NumFriends) const;
+
+END_DEFINE_SPEC(FMultiplayerSessionsSubsystemSpec)
+
+void FMultiplayerSessionsSubsystemSpec::SetUpSubsystem(const FMultiplayerFakeOnlineSettings& Settings)
+{
+	GameInstance = NewObject<UGameInstance>(GetTransientPackage());
+	GameInstance->AddToRoot();
+	GameInstance->InitializeStandalone();
+
+	//The standalone world isn't ticked by the engine, its timers carry the subsystem's deferred completions
+	TWeakObjectPtr<UGameInstance> WeakGameInstance = GameInstance;
+	TimerTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakGameInstance](float DeltaTime) {
+		if (UGameInstance* TickedGameInstance = WeakGameInstance.Get()) {
+			TickedGameInstance->GetTimerManager().Tick(DeltaTime);
+		}
+		return true;
+	}));
+
+	ULocalPlayer* LocalPlayer = NewObject<ULocalPlayer>(GameInstance);
+	PlayerController = GameInstance->GetWorld()->SpawnActor<APlayerController>();
+	PlayerController->Player = LocalPlayer;
+
+	Backend = FMultiplayerFakeOnlineBackend::Create(Settings);
+	Subsystem = GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>();
+	Subsystem->SetOnlineServicesOverride(Backend->MakeServices());
+	Subsystem->SetAvatarProviderOverride(Backend->MakeAvatarProvider());
+}
+
+void FMultiplayerSessionsSubsystemSpec::TearDownSubsystem()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TimerTickerHandle);
+
+	if (Subsystem) {
+		Subsystem->CancelAllSessionOperations();
+		Subsystem->SetOnlineServicesOverride(FMultiplayerOnlineServices());
+		Subsystem->SetAvatarProviderOverride(nullptr);
+	}
+	if (GameInstance) {
+		UWorld* World = GameInstance->GetWorld();
+		GameInstance->Shutdown();
+		if (World) {
+			World->DestroyWorld(false);
+		}
+		GameInstance->RemoveFromRoot();
+	}
+
+	GameInstance = nullptr;
+	Subsystem = nullptr;
+	PlayerController = nullptr;
+	Backend.Reset();
+}
+
+TArray<FUniqueNetIdRef> FMultiplayerSessionsSubsystemSpec::MakeFriendIds(int32 NumFriends) const
+{
+	TArray<FUniqueNetIdRef> FriendIds;
+	for (int32 Index = 0; Index < NumFriends; ++Index) {
+		FriendIds.Add(FUniqueNetIdString::Create(FString::Printf(TEXT("SpecFriend%d"), Index), FName(TEXT("Fake"))));
+	}
+	return FriendIds;
+}
+
+void FMultiplayerSessionsSubsystemSpec::Define()
+{
+	AfterEach([this]() {
+		TearDownSubsystem();
+	});
+
+	Describe("Friends", [this]() {
+		BeforeEach([this]() {
+			FMultiplayerFakeOnlineSettings Settings;
+			Settings.NumFriends = 25;
+			SetUpSubsystem(Settings);
+		});
+
+		LatentIt("reports every friend of the first read as added", [this](const FDoneDelegate& Done) {
+			Subsystem->MultiplayerOnGetFriendsListComplete.AddLambda([this, Done](bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta) {
+				TestTrue(TEXT("Read succeeded"), bWasSuccessful);
+				TestEqual(TEXT("Added friends"), FriendsListDelta.Added.Num(), 25);
+				TestEqual(TEXT("Cached friends"), Subsystem->GetCachedFriendsList().Num(), 25);
+				Done.Execute();
+			});
+			Subsystem->GetFriendsList(PlayerController);
+		});
+
+		LatentIt("reports an empty delta when a forced re-read changed nothing", [this](const FDoneDelegate& Done) {
+			TSharedRef<int32> NumReads = MakeShared<int32>(0);
+			Subsystem->MultiplayerOnGetFriendsListComplete.AddLambda([this, Done, NumReads](bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta) {
+				if (++(*NumReads) == 1) {
+					Subsystem->GetFriendsList(PlayerController, true);
+					return;
+				}
+				TestTrue(TEXT("Re-read succeeded"), bWasSuccessful);
+				TestTrue(TEXT("Delta is empty"), FriendsListDelta.IsEmpty());
+				Done.Execute();
+			});
+			Subsystem->GetFriendsList(PlayerController);
+		});
+
+		LatentIt("answers a read within the cache TTL to the caller only", [this](const FDoneDelegate& Done) {
+			TSharedRef<int32> NumBroadcasts = MakeShared<int32>(0);
+			Subsystem->MultiplayerOnGetFriendsListComplete.AddLambda([this, Done, NumBroadcasts](bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta) {
+				++(*NumBroadcasts);
+				TestTrue(TEXT("Answered from the cache"), Subsystem->GetFriendsList(PlayerController));
+				TestEqual(TEXT("Broadcasts"), *NumBroadcasts, 1);
+				Done.Execute();
+			});
+			Subsystem->GetFriendsList(PlayerController);
+		});
+	});
+
+	Describe("Sessions", [this]() {
+		BeforeEach([this]() {
+			FMultiplayerFakeOnlineSettings Settings;
+			Settings.NumSearchResults = 40;
+			SetUpSubsystem(Settings);
+		});
+
+		LatentIt("returns at most MaxSearchResults sessions", [this](const FDoneDelegate& Done) {
+			Subsystem->MultiplayerOnFindSessionsComplete.AddLambda([this, Done](const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful) {
+				TestTrue(TEXT("Search succeeded"), bWasSuccessful);
+				TestEqual(TEXT("Results"), SessionResults.Num(), 10);
+				Done.Execute();
+			});
+			Subsystem->FindSessions(10);
+		});
+
+		LatentIt("joins a session that was found", [this](const FDoneDelegate& Done) {
+			Subsystem->MultiplayerOnFindSessionsComplete.AddLambda([this](const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful) {
+				if (TestTrue(TEXT("Found a session"), bWasSuccessful && SessionResults.Num() > 0)) {
+					Subsystem->JoinSession(SessionResults[0]);
+				}
+			});
+			Subsystem->MultiplayerOnJoinSessionComplete.AddLambda([this, Done](EOnJoinSessionCompleteResult::Type Result) {
+				TestEqual(TEXT("Join result"), Result, EOnJoinSessionCompleteResult::Success);
+				TestTrue(TEXT("Session is registered"), Subsystem->GetSessionState() != EMultiplayerSessionState::Idle);
+				Done.Execute();
+			});
+			Subsystem->FindSessions(10);
+		});
+
+		LatentIt("quick joins the best session of a match type", [this](const FDoneDelegate& Done) {
+			Subsystem->MultiplayerOnJoinSessionComplete.AddLambda([this, Done](EOnJoinSessionCompleteResult::Type Result) {
+				TestEqual(TEXT("Join result"), Result, EOnJoinSessionCompleteResult::Success);
+				Done.Execute();
+			});
+			Subsystem->QuickJoinBestSession(TEXT("Default"), 20);
+		});
+	});
+
+	Describe("Invites", [this]() {
+		BeforeEach([this]() {
+			SetUpSubsystem(FMultiplayerFakeOnlineSettings());
+		});
+
+		LatentIt("hosts a session and reports a result per invited friend", [this](const FDoneDelegate& Done) {
+			const TArray<FUniqueNetIdRef> FriendIds = MakeFriendIds(3);
+			Subsystem->SendSessionInvitesToFriends(PlayerController, FriendIds, FMultiplayerOnSessionInvitesSent::CreateLambda(
+				[this, Done](FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results) {
+					TestEqual(TEXT("Results"), Results.Num(), 3);
+					TestFalse(TEXT("Every invite was sent"), Results.ContainsByPredicate([](const FMultiplayerInviteResult& Result) { return !Result.bWasSuccessful; }));
+					TestTrue(TEXT("Session was hosted"), Subsystem->GetSessionState() == EMultiplayerSessionState::Created);
+					Done.Execute();
+				}));
+		});
+
+		LatentIt("hosts a session for invites that waited on a failed join", [this](const FDoneDelegate& Done) {
+			//An empty search result never joins, the invites are sent while that join is still running
+			Subsystem->JoinSession(FOnlineSessionSearchResult());
+			Subsystem->SendSessionInvitesToFriends(PlayerController, MakeFriendIds(2), FMultiplayerOnSessionInvitesSent::CreateLambda(
+				[this, Done](FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results) {
+					TestEqual(TEXT("Results"), Results.Num(), 2);
+					TestFalse(TEXT("Every invite was sent"), Results.ContainsByPredicate([](const FMultiplayerInviteResult& Result) { return !Result.bWasSuccessful; }));
+					TestTrue(TEXT("Session was hosted"), Subsystem->GetSessionState() == EMultiplayerSessionState::Created);
+					Done.Execute();
+				}));
+		});
+
+		LatentIt("reports a cancelled create through its handle only", [this](const FDoneDelegate& Done) {
+			//The first create runs right away, the second one waits in the queue and can be cancelled
+			Subsystem->CreateSession(2, TEXT("Default"), TEXT("/Game/SpecMap"));
+			const FMultiplayerSessionOperationHandle QueuedHandle = Subsystem->CreateSession(4, TEXT("Default"), TEXT("/Game/SpecMap"));
+			Subsystem->MultiplayerOnSessionOperationCancelled.AddLambda([this, QueuedHandle, Done](FMultiplayerSessionOperationHandle OperationHandle) {
+				TestTrue(TEXT("Cancelled handle"), OperationHandle == QueuedHandle);
+				Done.Execute();
+			});
+			TestTrue(TEXT("Queued create was cancelled"), Subsystem->CancelSessionOperation(QueuedHandle));
+		});
+	});
+
+	Describe("Failures", [this]() {
+		BeforeEach([this]() {
+			FMultiplayerFakeOnlineSettings Settings;
+			Settings.FailureRate = 1.f;
+			SetUpSubsystem(Settings);
+		});
+
+		LatentIt("reports a failed friends read and keeps the cache empty", [this](const FDoneDelegate& Done) {
+			Subsystem->MultiplayerOnGetFriendsListComplete.AddLambda([this, Done](bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta) {
+				TestFalse(TEXT("Read succeeded"), bWasSuccessful);
+				TestTrue(TEXT("Cache is empty"), Subsystem->GetCachedFriendsList().IsEmpty());
+				Done.Execute();
+			});
+			Subsystem->GetFriendsList(PlayerController);
+		});
+
+		LatentIt("reports a failed search", [this](const FDoneDelegate& Done) {
+			Subsystem->MultiplayerOnFindSessionsComplete.AddLambda([this, Done](const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful) {
+				TestFalse(TEXT("Search succeeded"), bWasSuccessful);
+				TestTrue(TEXT("No results"), SessionResults.IsEmpty());
+				Done.Execute();
+			});
+			Subsystem->FindSessions(10);
+		});
+
+		LatentIt("fails every invite when the host session can't be created", [this](const FDoneDelegate& Done) {
+			Subsystem->SendSessionInvitesToFriends(PlayerController, MakeFriendIds(2), FMultiplayerOnSessionInvitesSent::CreateLambda(
+				[this, Done](FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results) {
+					TestEqual(TEXT("Results"), Results.Num(), 2);
+					TestFalse(TEXT("Any invite was sent"), Results.ContainsByPredicate([](const FMultiplayerInviteResult& Result) { return Result.bWasSuccessful; }));
+					TestTrue(TEXT("No session left"), Subsystem->GetSessionState() == EMultiplayerSessionState::Idle);
+					Done.Execute();
+				}));
+		});
+	});
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
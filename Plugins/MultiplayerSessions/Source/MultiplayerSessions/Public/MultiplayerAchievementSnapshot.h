@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/OnlineAchievementsInterface.h"
+
+/**
+ * Read-only copy of a player's achievements and their descriptions, taken once the queries landed and indexed by
+ * achievement id. Lookups return pointers into the snapshot, which stay valid for as long as it is held
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerAchievementSnapshot
+{
+public:
+
+	//Copies what the interface cached for PlayerId, both queries must have completed
+	static TSharedRef<const FMultiplayerAchievementSnapshot> Create(IOnlineAchievements& AchievementsInterface, const FUniqueNetId& PlayerId);
+
+	const FOnlineAchievement* FindAchievement(FName AchievementId) const;
+	const FOnlineAchievementDesc* FindDescription(FName AchievementId) const;
+
+	const TArray<FOnlineAchievement>& GetAchievements() const { return Achievements; }
+	int32 GetNumUnlocked() const { return NumUnlocked; }
+
+private:
+
+	TArray<FOnlineAchievement> Achievements;
+	TMap<FName, int32> AchievementIndices;
+	TMap<FName, FOnlineAchievementDesc> Descriptions;
+	int32 NumUnlocked{ 0 };
+};
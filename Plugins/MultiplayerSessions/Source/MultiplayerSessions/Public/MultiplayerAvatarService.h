@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "Containers/LruCache.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "OnlineSubsystemTypes.h"
+
+class UTexture2D;
+class IImageWrapperModule;
+
+enum class SteamAvatarSize : uint8
+{
+	SteamAvatar_INVALID = 0,
+	SteamAvatar_Small = 1,
+	SteamAvatar_Medium = 2,
+	SteamAvatar_Large = 3
+};
+
+//Avatar as delivered by a provider, before it is decoded and scaled to its size bucket
+struct FMultiplayerAvatarPixels
+{
+	//RGBA8 rows of Width x Height when bCompressed is false, otherwise an image file (PNG, JPEG, BMP) in memory
+	TArray<uint8> Data;
+	int32 Width{ 0 };
+	int32 Height{ 0 };
+	bool bCompressed{ false };
+};
+
+//Called exactly once per request, from any thread
+typedef TFunction<void(bool bWasSuccessful, FMultiplayerAvatarPixels&& Pixels)> FMultiplayerAvatarPixelsCallback;
+
+//Source of avatar pixels: the platform's friends service, or FMultiplayerFakeAvatarProvider in tests and benchmarks
+class IMultiplayerAvatarProvider
+{
+public:
+
+	virtual ~IMultiplayerAvatarProvider() = default;
+
+	//Called on the game thread
+	virtual void RequestAvatarPixels(const FUniqueNetId& UserId, SteamAvatarSize AvatarSize, FMultiplayerAvatarPixelsCallback&& Callback) = 0;
+};
+
+typedef TSharedPtr<IMultiplayerAvatarProvider, ESPMode::ThreadSafe> FMultiplayerAvatarProviderPtr;
+
+//Identifies one avatar request so a row that is rebound or destroyed can drop its callback
+struct FMultiplayerAvatarRequestHandle
+{
+	uint32 Id{ 0 };
+
+	bool IsValid() const { return Id != 0; }
+	void Reset() { Id = 0; }
+	bool operator==(const FMultiplayerAvatarRequestHandle& Other) const { return Id == Other.Id; }
+};
+
+//Null when the user has no avatar or the provider failed
+DECLARE_DELEGATE_OneParam(FMultiplayerOnAvatarReady, UTexture2D* Avatar);
+
+/**
+ * Hands out avatar textures without blocking the game thread. Pixels are requested from the provider once per user
+ * and size, decoded and scaled on worker threads, and turned into textures at most MaxUploadsPerTick per frame.
+ * Textures are kept in one LRU cache per size bucket, each sized to its share of the memory budget
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerAvatarService : public FGCObject
+{
+public:
+
+	FMultiplayerAvatarService(int32 MemoryBudgetKB, int32 InMaxUploadsPerTick);
+	virtual ~FMultiplayerAvatarService();
+
+	//Drops the cache, rows still waiting are told there is no avatar
+	void SetProvider(const FMultiplayerAvatarProviderPtr& InProvider);
+
+	//Returns the cached texture right away. Otherwise returns null, fills OutHandle and calls OnReady on the game thread later
+	UTexture2D* RequestAvatar(const FUniqueNetId& UserId, SteamAvatarSize AvatarSize, const FMultiplayerOnAvatarReady& OnReady, FMultiplayerAvatarRequestHandle& OutHandle);
+	//The avatar is still fetched and cached, only the callback is dropped
+	void CancelRequest(FMultiplayerAvatarRequestHandle RequestHandle);
+	void Flush();
+
+	int32 GetNumCachedAvatars() const;
+	int64 GetCachedBytes() const;
+
+	//Square edge, in pixels, every avatar of that size is scaled to. Matches Steam's 32/64/184
+	static int32 GetAvatarDimension(SteamAvatarSize AvatarSize);
+	//Steam when it is the active online subsystem, otherwise none
+	static FMultiplayerAvatarProviderPtr CreatePlatformProvider();
+
+	//FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FMultiplayerAvatarService"); }
+
+private:
+
+	static constexpr int32 NumBuckets = 3;
+
+	struct FDecodedAvatar
+	{
+		FString UserKey;
+		int32 BucketIndex{ INDEX_NONE };
+		//Generation of the service the request was made in
+		uint32 Generation{ 0 };
+		bool bWasSuccessful{ false };
+		//BGRA, GetAvatarDimension squared
+		TArray<FColor> Pixels;
+	};
+
+	//Decoded on workers, uploaded by the game thread ticker. Shared so late worker results outlive the service safely
+	typedef TQueue<TUniquePtr<FDecodedAvatar>, EQueueMode::Mpsc> FDecodedAvatarQueue;
+
+	struct FPendingAvatar
+	{
+		TMap<uint32, FMultiplayerOnAvatarReady> Callbacks;
+	};
+
+	static int32 GetBucketIndex(SteamAvatarSize AvatarSize);
+	static bool DecodeAvatar(IImageWrapperModule* ImageWrapperModule, const FMultiplayerAvatarPixels& Pixels, int32 Dimension, TArray<FColor>& OutPixels);
+	static UTexture2D* CreateAvatarTexture(const TArray<FColor>& Pixels, int32 Dimension);
+
+	bool TickUploads(float DeltaTime);
+	void FailPendingAvatars();
+
+	FMultiplayerAvatarProviderPtr Provider;
+	IImageWrapperModule* ImageWrapperModule{ nullptr };
+
+	TLruCache<FString, TObjectPtr<UTexture2D>> Caches[NumBuckets];
+	//Requests handed to the provider, keyed by user. Kept after their callbacks are cancelled so the result is still cached
+	TMap<FString, FPendingAvatar> PendingAvatars[NumBuckets];
+	TSharedRef<FDecodedAvatarQueue, ESPMode::ThreadSafe> DecodedAvatars;
+
+	FTSTicker::FDelegateHandle UploadTickerHandle;
+	int32 MaxUploadsPerTick{ 4 };
+	uint32 NextRequestId{ 1 };
+	//Bumped by Flush, results of requests made before it are dropped instead of filling the emptied cache
+	uint32 Generation{ 0 };
+};
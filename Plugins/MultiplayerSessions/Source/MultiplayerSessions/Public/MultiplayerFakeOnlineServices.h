@@ -0,0 +1,284 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "Interfaces/OnlineFriendsInterface.h"
+#include "Interfaces/OnlinePresenceInterface.h"
+#include "Containers/Ticker.h"
+#include "OnlineSessionSettings.h"
+#include "MultiplayerSessionMetrics.h"
+#include "MultiplayerAvatarService.h"
+
+//The fake backend only exists for automation tests and the benchmark command, shipping builds leave it out
+#if !UE_BUILD_SHIPPING
+
+struct FMultiplayerOnlineServices;
+
+//Knobs of the in-process fake backend. Same settings and seed give the same results every run
+struct MULTIPLAYERSESSIONS_API FMultiplayerFakeOnlineSettings
+{
+	//Every async call completes after a delay picked between these, 0 still waits for the next tick like a real backend
+	float MinLatencySeconds{ 0.f };
+	float MaxLatencySeconds{ 0.f };
+	//Chance, 0 to 1, that a call reports failure
+	float FailureRate{ 0.f };
+	//Sessions a search returns before MaxSearchResults is applied, and friends in the list
+	int32 NumSearchResults{ 100 };
+	int32 NumFriends{ 100 };
+	//Fraction of friends whose presence changes between two reads, so re-reads produce a delta
+	float FriendChurnRate{ 0.f };
+	//Presence events per second across all friends once the list was read, each one flips a random friend online or offline
+	float PresenceChangesPerSecond{ 0.f };
+	int32 RandomSeed{ 0 };
+};
+
+/**
+ * State shared by the fake session and friends interfaces: settings, the seeded random stream and the latency
+ * scheduler. Also times how long the subsystem spends handling each completion, which is the CPU cost a real
+ * backend's latency hides
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerFakeOnlineBackend : public TSharedFromThis<FMultiplayerFakeOnlineBackend, ESPMode::ThreadSafe>
+{
+public:
+
+	static TSharedRef<FMultiplayerFakeOnlineBackend, ESPMode::ThreadSafe> Create(const FMultiplayerFakeOnlineSettings& Settings);
+
+	//Fake interfaces to hand to UMultiplayerSessionsSubsystem::SetOnlineServicesOverride
+	FMultiplayerOnlineServices MakeServices();
+	//Avatar provider to hand to UMultiplayerSessionsSubsystem::SetAvatarProviderOverride
+	FMultiplayerAvatarProviderPtr MakeAvatarProvider();
+
+	const FMultiplayerFakeOnlineSettings& GetSettings() const { return Settings; }
+	FUniqueNetIdRef GetLocalUserId() const { return LocalUserId; }
+	bool RollFailure();
+	FRandomStream& GetRandom() { return Random; }
+
+	//Runs Completion after the simulated latency and records how long it took under CallName
+	void Complete(FName CallName, TFunction<void()>&& Completion);
+
+	void RecordHandlerTime(FName CallName, double HandlerMs) { HandlerTimes.FindOrAdd(CallName).Add(HandlerMs, true); }
+	const TMap<FName, FMultiplayerLatencyHistogram>& GetHandlerTimes() const { return HandlerTimes; }
+	void ResetHandlerTimes() { HandlerTimes.Reset(); }
+	void DumpHandlerTimesToLog() const;
+
+private:
+
+	explicit FMultiplayerFakeOnlineBackend(const FMultiplayerFakeOnlineSettings& InSettings);
+
+	FMultiplayerFakeOnlineSettings Settings;
+	FRandomStream Random;
+	FUniqueNetIdRef LocalUserId;
+	TMap<FName, FMultiplayerLatencyHistogram> HandlerTimes;
+};
+
+typedef TSharedRef<FMultiplayerFakeOnlineBackend, ESPMode::ThreadSafe> FMultiplayerFakeOnlineBackendRef;
+
+class FMultiplayerFakeSessionInfo : public FOnlineSessionInfo
+{
+public:
+
+	explicit FMultiplayerFakeSessionInfo(const FUniqueNetIdRef& InSessionId) : SessionId(InSessionId) {}
+
+	virtual const uint8* GetBytes() const override { return nullptr; }
+	virtual int32 GetSize() const override { return sizeof(FMultiplayerFakeSessionInfo); }
+	virtual bool IsValid() const override { return true; }
+	virtual const FUniqueNetId& GetSessionId() const override { return *SessionId; }
+	virtual FString ToString() const override { return SessionId->ToString(); }
+	virtual FString ToDebugString() const override { return FString::Printf(TEXT("FakeSession %s"), *SessionId->ToDebugString()); }
+
+private:
+
+	FUniqueNetIdRef SessionId;
+};
+
+class FMultiplayerFakeOnlineFriend : public FOnlineFriend
+{
+public:
+
+	FMultiplayerFakeOnlineFriend(const FUniqueNetIdRef& InUserId, const FString& InDisplayName) : UserId(InUserId), DisplayName(InDisplayName) {}
+
+	virtual FUniqueNetIdRef GetUserId() const override { return UserId; }
+	virtual FString GetRealName() const override { return DisplayName; }
+	virtual FString GetDisplayName(const FString& Platform = FString()) const override { return DisplayName; }
+	virtual bool GetUserAttribute(const FString& AttrName, FString& OutAttrValue) const override { return false; }
+	virtual EInviteStatus::Type GetInviteStatus() const override { return EInviteStatus::Accepted; }
+	virtual const FOnlineUserPresence& GetPresence() const override { return Presence; }
+
+	FOnlineUserPresence Presence;
+
+private:
+
+	FUniqueNetIdRef UserId;
+	FString DisplayName;
+};
+
+/**
+ * Session interface that keeps named sessions in memory and makes up search results. Matchmaking, friend
+ * session lookups and pinging aren't simulated and report failure
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerFakeOnlineSession : public IOnlineSession, public TSharedFromThis<FMultiplayerFakeOnlineSession, ESPMode::ThreadSafe>
+{
+public:
+
+	explicit FMultiplayerFakeOnlineSession(const FMultiplayerFakeOnlineBackendRef& InBackend) : Backend(InBackend) {}
+
+	//IOnlineSession
+	virtual FUniqueNetIdPtr CreateSessionIdFromString(const FString& SessionIdStr) override;
+	virtual FNamedOnlineSession* GetNamedSession(FName SessionName) override;
+	virtual void RemoveNamedSession(FName SessionName) override;
+	virtual EOnlineSessionState::Type GetSessionState(FName SessionName) const override;
+	virtual bool HasPresenceSession() override;
+	virtual bool CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings) override;
+	virtual bool CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings) override;
+	virtual bool StartSession(FName SessionName) override;
+	virtual bool UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData = true) override;
+	virtual bool EndSession(FName SessionName) override;
+	virtual bool DestroySession(FName SessionName, const FOnDestroySessionCompleteDelegate& CompletionDelegate = FOnDestroySessionCompleteDelegate()) override;
+	virtual bool IsPlayerInSession(FName SessionName, const FUniqueNetId& UniqueId) override;
+	virtual bool StartMatchmaking(const TArray<FUniqueNetIdRef>& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName) override;
+	virtual bool CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName) override;
+	virtual bool FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate) override;
+	virtual bool CancelFindSessions() override;
+	virtual bool PingSearchResults(const FOnlineSessionSearchResult& SearchResult) override;
+	virtual bool JoinSession(int32 LocalUserNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession) override;
+	virtual bool JoinSession(const FUniqueNetId& LocalUserId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession) override;
+	virtual bool FindFriendSession(int32 LocalUserNum, const FUniqueNetId& Friend) override;
+	virtual bool FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend) override;
+	virtual bool FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& FriendList) override;
+	virtual bool SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend) override;
+	virtual bool SendSessionInviteToFriend(const FUniqueNetId& LocalUserId, FName SessionName, const FUniqueNetId& Friend) override;
+	virtual bool SendSessionInviteToFriends(int32 LocalUserNum, FName SessionName, const TArray<FUniqueNetIdRef>& Friends) override;
+	virtual bool SendSessionInviteToFriends(const FUniqueNetId& LocalUserId, FName SessionName, const TArray<FUniqueNetIdRef>& Friends) override;
+	virtual bool GetResolvedConnectString(FName SessionName, FString& ConnectInfo, FName PortType = NAME_GamePort) override;
+	virtual bool GetResolvedConnectString(const FOnlineSessionSearchResult& SearchResult, FName PortType, FString& ConnectInfo) override;
+	virtual FOnlineSessionSettings* GetSessionSettings(FName SessionName) override;
+	virtual bool RegisterPlayer(FName SessionName, const FUniqueNetId& PlayerId, bool bWasInvited) override;
+	virtual bool RegisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players, bool bWasInvited = false) override;
+	virtual bool UnregisterPlayer(FName SessionName, const FUniqueNetId& PlayerId) override;
+	virtual bool UnregisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players) override;
+	virtual void RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate) override;
+	virtual void UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate) override;
+	virtual void RemovePlayerFromSession(int32 LocalUserNum, FName SessionName, const FUniqueNetId& TargetPlayerId) override;
+	virtual int32 GetNumSessions() override { return Sessions.Num(); }
+	virtual void DumpSessionState() override;
+
+protected:
+
+	virtual FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings) override;
+	virtual FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSession& Session) override;
+
+private:
+
+	void MakeSearchResults(FOnlineSessionSearch& Search);
+	FUniqueNetIdRef MakeSessionId();
+
+	FMultiplayerFakeOnlineBackendRef Backend;
+	//Shared refs so pointers handed out by GetNamedSession survive other sessions being added
+	TArray<TSharedRef<FNamedOnlineSession>> Sessions;
+	TSharedPtr<FOnlineSessionSearch> CurrentSearch;
+	//Bumped by CancelFindSessions so the completion of a cancelled search is dropped
+	uint32 SearchSerial{ 0 };
+	uint32 NextSessionId{ 1 };
+};
+
+/**
+ * Friends interface serving a generated list of Settings.NumFriends friends. Each read changes the presence of
+ * FriendChurnRate of them. Invites, aliases, blocking and recent players aren't simulated and report failure
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerFakeOnlineFriends : public IOnlineFriends, public TSharedFromThis<FMultiplayerFakeOnlineFriends, ESPMode::ThreadSafe>
+{
+public:
+
+	explicit FMultiplayerFakeOnlineFriends(const FMultiplayerFakeOnlineBackendRef& InBackend) : Backend(InBackend) {}
+
+	//IOnlineFriends
+	virtual bool ReadFriendsList(int32 LocalUserNum, const FString& ListName, const FOnReadFriendsListComplete& Delegate = FOnReadFriendsListComplete()) override;
+	virtual bool DeleteFriendsList(int32 LocalUserNum, const FString& ListName, const FOnDeleteFriendsListComplete& Delegate = FOnDeleteFriendsListComplete()) override;
+	virtual bool SendInvite(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName, const FOnSendInviteComplete& Delegate = FOnSendInviteComplete()) override;
+	virtual bool AcceptInvite(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName, const FOnAcceptInviteComplete& Delegate = FOnAcceptInviteComplete()) override;
+	virtual bool RejectInvite(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName) override;
+	virtual void SetFriendAlias(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName, const FString& Alias, const FOnSetFriendAliasComplete& Delegate = FOnSetFriendAliasComplete()) override;
+	virtual void DeleteFriendAlias(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName, const FOnDeleteFriendAliasComplete& Delegate = FOnDeleteFriendAliasComplete()) override;
+	virtual bool DeleteFriend(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName) override;
+	virtual bool GetFriendsList(int32 LocalUserNum, const FString& ListName, TArray<TSharedRef<FOnlineFriend>>& OutFriends) override;
+	virtual TSharedPtr<FOnlineFriend> GetFriend(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName) override;
+	virtual bool IsFriend(int32 LocalUserNum, const FUniqueNetId& FriendId, const FString& ListName) override;
+	virtual void AddRecentPlayers(const FUniqueNetId& UserId, const TArray<FReportPlayedWithUser>& InRecentPlayers, const FString& ListName, const FOnAddRecentPlayersComplete& InCompletionDelegate) override;
+	virtual bool QueryRecentPlayers(const FUniqueNetId& UserId, const FString& Namespace) override;
+	virtual bool GetRecentPlayers(const FUniqueNetId& UserId, const FString& Namespace, TArray<TSharedRef<FOnlineRecentPlayer>>& OutRecentPlayers) override;
+	virtual void DumpRecentPlayers() const override {}
+	virtual bool BlockPlayer(int32 LocalUserNum, const FUniqueNetId& PlayerId) override;
+	virtual bool UnblockPlayer(int32 LocalUserNum, const FUniqueNetId& PlayerId) override;
+	virtual bool QueryBlockedPlayers(const FUniqueNetId& UserId) override;
+	virtual bool GetBlockedPlayers(const FUniqueNetId& UserId, TArray<TSharedRef<FOnlineBlockedPlayer>>& OutBlockedPlayers) override;
+	virtual void DumpBlockedPlayers() const override {}
+
+	//Flips a random friend online or offline, null until the list was read
+	TSharedPtr<FMultiplayerFakeOnlineFriend> ChangeRandomFriendPresence();
+
+private:
+
+	void GenerateFriends();
+	void ChurnFriends();
+
+	FMultiplayerFakeOnlineBackendRef Backend;
+	TArray<TSharedRef<FOnlineFriend>> FriendsList;
+	TUniqueNetIdMap<TSharedRef<FMultiplayerFakeOnlineFriend>> FriendsById;
+};
+
+/**
+ * Presence interface pushing Settings.PresenceChangesPerSecond presence events for the fake friends list. Only the
+ * events are simulated, setting and querying presence report failure
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerFakeOnlinePresence : public IOnlinePresence, public TSharedFromThis<FMultiplayerFakeOnlinePresence, ESPMode::ThreadSafe>
+{
+public:
+
+	FMultiplayerFakeOnlinePresence(const FMultiplayerFakeOnlineBackendRef& InBackend, const TSharedRef<FMultiplayerFakeOnlineFriends, ESPMode::ThreadSafe>& InFriends) : Backend(InBackend), Friends(InFriends) {}
+	virtual ~FMultiplayerFakeOnlinePresence();
+
+	void StartPresenceEvents();
+
+	//IOnlinePresence
+	virtual void SetPresence(const FUniqueNetId& User, const FOnlineUserPresenceStatus& Status, const FOnPresenceTaskCompleteDelegate& Delegate = FOnPresenceTaskCompleteDelegate()) override;
+	virtual void QueryPresence(const FUniqueNetId& User, const FOnPresenceTaskCompleteDelegate& Delegate = FOnPresenceTaskCompleteDelegate()) override;
+	virtual void QueryPresence(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& UserIds, const FOnPresenceTaskCompleteDelegate& Delegate) override;
+	virtual EOnlineCachedResult::Type GetCachedPresence(const FUniqueNetId& User, TSharedPtr<FOnlineUserPresence>& OutPresence) override;
+	virtual EOnlineCachedResult::Type GetCachedPresenceForApp(const FUniqueNetId& LocalUserId, const FUniqueNetId& User, const FString& AppId, TSharedPtr<FOnlineUserPresence>& OutPresence) override;
+
+private:
+
+	bool TickPresenceEvents(float DeltaTime);
+
+	FMultiplayerFakeOnlineBackendRef Backend;
+	TWeakPtr<FMultiplayerFakeOnlineFriends, ESPMode::ThreadSafe> Friends;
+	FTSTicker::FDelegateHandle TickerHandle;
+	float PendingEvents{ 0.f };
+};
+
+/**
+ * Avatar provider drawing a 5x5 identicon per user after the backend's latency. Pixels are generated on a worker
+ * thread at a size no bucket uses, so every avatar goes through the service's scaling like a real download
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerFakeAvatarProvider : public IMultiplayerAvatarProvider
+{
+public:
+
+	explicit FMultiplayerFakeAvatarProvider(const FMultiplayerFakeOnlineBackendRef& InBackend) : Backend(InBackend) {}
+
+	//IMultiplayerAvatarProvider
+	virtual void RequestAvatarPixels(const FUniqueNetId& UserId, SteamAvatarSize AvatarSize, FMultiplayerAvatarPixelsCallback&& Callback) override;
+
+private:
+
+	static FMultiplayerAvatarPixels MakeIdenticon(uint32 Seed);
+
+	FMultiplayerFakeOnlineBackendRef Backend;
+};
+
+#endif //!UE_BUILD_SHIPPING
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//Async online operations and join pipeline stages timed by UMultiplayerSessionsSubsystem
+enum class EMultiplayerSessionMetric : uint8
+{
+	CreateSession,
+	FindSessions,
+	JoinSession,
+	DestroySession,
+	StartSession,
+	ReadFriendsList,
+	SendSessionInvite,
+	QueryAchievements,
+	QueryAchievementDescriptions,
+	WriteAchievements,
+	//Join pipeline: connect string resolution, background load of the host's map, ClientTravel until the map is loaded,
+	//and the whole way from the join or invite accept request to being in the game
+	ResolveConnectString,
+	PreloadMap,
+	ConnectToSession,
+	JoinToGame,
+	Num
+};
+
+//Latency distribution of one operation. Buckets grow by 25% from 1ms, so percentiles are exact to within a bucket
+struct MULTIPLAYERSESSIONS_API FMultiplayerLatencyHistogram
+{
+	static constexpr int32 NumBuckets = 64;
+
+	int32 Count{ 0 };
+	int32 Failures{ 0 };
+	double SumMs{ 0.0 };
+	double MinMs{ 0.0 };
+	double MaxMs{ 0.0 };
+	uint32 Buckets[NumBuckets]{};
+
+	void Add(double LatencyMs, bool bWasSuccessful);
+	//Upper bound of the bucket holding the given percentile (0-100), clamped to the observed min and max
+	double GetPercentile(double Percentile) const;
+	double GetAverage() const { return Count > 0 ? SumMs / Count : 0.0; }
+	void Reset();
+
+	static int32 GetBucketIndex(double LatencyMs);
+	static double GetBucketUpperBound(int32 BucketIndex);
+};
+
+//Running timer of one in-flight operation, measured on the monotonic cycle counter
+struct FMultiplayerLatencyTimer
+{
+	EMultiplayerSessionMetric Metric{ EMultiplayerSessionMetric::Num };
+	uint64 StartCycles{ 0 };
+	//Tells the Insights regions of overlapping operations of the same kind apart
+	uint32 RegionId{ 0 };
+
+	bool IsRunning() const { return StartCycles != 0; }
+};
+
+/**
+ * Times online operations from the moment they are issued to the backend until their completion arrives.
+ * Every sample goes to a per operation histogram, the stats system (stat MultiplayerSessions), the CSV profiler
+ * and an Insights timing region. MultiplayerSessions.DumpLatency prints the p50/p95/p99 table
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerSessionMetrics
+{
+public:
+
+	FMultiplayerLatencyTimer Start(EMultiplayerSessionMetric Metric);
+	//Records the sample and resets the timer, does nothing if it isn't running
+	void Stop(FMultiplayerLatencyTimer& Timer, bool bWasSuccessful);
+	//Ends the timer without a sample, for operations that were cancelled or cut off by shutdown rather than failed
+	void Discard(FMultiplayerLatencyTimer& Timer);
+
+	const FMultiplayerLatencyHistogram& GetHistogram(EMultiplayerSessionMetric Metric) const { return Histograms[static_cast<int32>(Metric)]; }
+	void Reset();
+
+	void DumpToLog() const;
+	bool WriteCsv(const FString& FilePath) const;
+
+	static const TCHAR* GetMetricName(EMultiplayerSessionMetric Metric);
+
+private:
+
+	static FString GetRegionName(const FMultiplayerLatencyTimer& Timer);
+
+	FMultiplayerLatencyHistogram Histograms[static_cast<int32>(EMultiplayerSessionMetric::Num)];
+	uint32 NextRegionId{ 1 };
+};
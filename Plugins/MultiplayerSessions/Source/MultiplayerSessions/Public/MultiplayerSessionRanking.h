@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+
+//What a player prefers in a session and how much each preference weighs. Higher scores rank first
+struct MULTIPLAYERSESSIONS_API FMultiplayerSessionRankingParams
+{
+	FString MatchType;
+	FString Region;
+
+	//Points lost per millisecond of ping, sessions above MaxPingInMs are dropped (0 keeps them all)
+	float PingWeight{ 1.f };
+	int32 MaxPingInMs{ 0 };
+	//Ping assumed for results whose backend doesn't measure it (Steam lobbies report MAX_QUERY_PING)
+	int32 UnknownPingInMs{ 150 };
+
+	//Points per open public slot, up to MaxCountedOpenSlots, so emptier sessions win ties without dominating ping
+	float OpenSlotWeight{ 5.f };
+	int32 MaxCountedOpenSlots{ 8 };
+
+	float MatchTypeBonus{ 200.f };
+	float RegionBonus{ 100.f };
+};
+
+struct FMultiplayerRankedSession
+{
+	int32 ResultIndex{ INDEX_NONE };
+	float Score{ 0.f };
+};
+
+/**
+ * Scores session search results by latency, fill, match type and region
+ */
+struct MULTIPLAYERSESSIONS_API FMultiplayerSessionRanking
+{
+	static float ScoreSession(const FOnlineSessionSearchResult& SessionResult, const FMultiplayerSessionRankingParams& Params);
+
+	//Joinable results sorted best first, indices point into SessionResults
+	static void RankSessions(TArrayView<const FOnlineSessionSearchResult> SessionResults, const FMultiplayerSessionRankingParams& Params, TArray<FMultiplayerRankedSession>& OutRankedSessions);
+};
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+
+//Keys of the settings hosted sessions advertise and searches filter on
+#define MULTIPLAYER_SETTING_MATCHTYPE FName(TEXT("MatchType"))
+#define MULTIPLAYER_SETTING_BUILDID FName(TEXT("BuildId"))
+#define MULTIPLAYER_SETTING_REGION FName(TEXT("Region"))
+
+//Which kind of host a search looks for. Listen servers are presence lobbies, dedicated servers are advertised as
+//game servers. GameServerList sets neither search key, Steam then searches every game server, dedicated or not,
+//but never the lobbies CreateSession hosts
+enum class EMultiplayerSessionHostType : uint8
+{
+	ListenServer,
+	DedicatedServer,
+	GameServerList
+};
+
+/**
+ * Typed session search filter. Compiled into FOnlineSessionSearch::QuerySettings so the backend does the
+ * filtering instead of sending every session of the app id back to the client
+ */
+struct MULTIPLAYERSESSIONS_API FMultiplayerSessionSearchFilter
+{
+	//Empty strings and zero values don't filter
+	FString MatchType;
+	FString MapName;
+	int32 MinOpenSlots{ 0 };
+	int32 BuildId{ 0 };
+
+	//Defaults to the lobbies players host through CreateSession
+	EMultiplayerSessionHostType HostType{ EMultiplayerSessionHostType::ListenServer };
+	bool bIsLanQuery{ false };
+
+	void ApplyTo(FOnlineSessionSearch& Search) const;
+
+	bool operator==(const FMultiplayerSessionSearchFilter& Other) const;
+	bool operator!=(const FMultiplayerSessionSearchFilter& Other) const { return !(*this == Other); }
+};
@@ -7,39 +7,126 @@
 #include "Interfaces/OnlineSessionInterface.h"
 #include "Interfaces/OnlineFriendsInterface.h"
 #include "Interfaces/OnlineAchievementsInterface.h"
+#include "Interfaces/OnlinePresenceInterface.h"
 #include "OnlineSubsystem.h"
 #include "OnlineSubsystemUtils.h"
+#include "TimerManager.h"
+#include "Engine/EngineBaseTypes.h"
+#include "MultiplayerSessionRanking.h"
+#include "MultiplayerSessionSearchFilter.h"
+#include "MultiplayerSessionMetrics.h"
+#include "MultiplayerAvatarService.h"
+#include "MultiplayerStatAggregator.h"
+#include "MultiplayerAchievementSnapshot.h"
 
 #include "MultiplayerSessionsSubsystem.generated.h"
 
+class UNetDriver;
+
+//Difference between two consecutive reads of the friends list. Only entries that were added, removed
+//or whose name/presence changed since the previous read are listed
+struct FMultiplayerFriendsListDelta
+{
+	TArray<TSharedRef<FOnlineFriend>> Added;
+	TArray<TSharedRef<FOnlineFriend>> Changed;
+	TArray<FUniqueNetIdRef> Removed;
+
+	bool IsEmpty() const { return Added.IsEmpty() && Changed.IsEmpty() && Removed.IsEmpty(); }
+};
+
+//Identifies a single invite request. Its completion is routed only to the delegate passed along with the request
+struct FMultiplayerInviteHandle
+{
+	uint32 Id{ 0 };
+
+	bool IsValid() const { return Id != 0; }
+	void Reset() { Id = 0; }
+	bool operator==(const FMultiplayerInviteHandle& Other) const { return Id == Other.Id; }
+};
+
+//Presence a friend reported through a presence event. Only friends of the cached friends list are tracked
+struct FMultiplayerFriendPresenceChange
+{
+	FUniqueNetIdRef FriendId;
+	TSharedRef<FOnlineUserPresence> Presence;
+};
+
+//Identifies a presence subscription so it can be ended
+struct FMultiplayerPresenceSubscriptionHandle
+{
+	uint32 Id{ 0 };
+
+	bool IsValid() const { return Id != 0; }
+	void Reset() { Id = 0; }
+	bool operator==(const FMultiplayerPresenceSubscriptionHandle& Other) const { return Id == Other.Id; }
+};
+
+//Outcome of the invite sent to one recipient of a SendSessionInvitesToFriends batch
+struct FMultiplayerInviteResult
+{
+	FUniqueNetIdRef FriendId;
+	bool bWasSuccessful{ false };
+};
+
+//Lifecycle of NAME_GameSession as seen by the subsystem. Every transition is driven by the operation queue
+UENUM(BlueprintType)
+enum class EMultiplayerSessionState : uint8
+{
+	Idle,
+	Creating,
+	Created,
+	Starting,
+	InProgress,
+	Joining,
+	Destroying
+};
+
+//Identifies a queued session operation so it can be cancelled before it runs
+struct FMultiplayerSessionOperationHandle
+{
+	uint32 Id{ 0 };
+
+	bool IsValid() const { return Id != 0; }
+	bool operator==(const FMultiplayerSessionOperationHandle& Other) const { return Id == Other.Id; }
+};
+
+//Online interfaces the subsystem talks to. Normally resolved from IOnlineSubsystem::Get(), tests and benchmarks
+//swap in FMultiplayerFakeOnlineBackend. Interfaces left empty are still resolved from the online subsystem
+struct FMultiplayerOnlineServices
+{
+	IOnlineSessionPtr Session;
+	IOnlineFriendsPtr Friends;
+	IOnlinePresencePtr Presence;
+	//Hosts, searches and joins as this user when the local player has no net id of the injected backend
+	FUniqueNetIdPtr LocalUserId;
+};
+
 //Dealing with default session controlling delegates
 DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnCreateSessionComplete, bool bWasSuccessful);
 DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnJoinSessionComplete, EOnJoinSessionCompleteResult::Type Result);
+DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnSessionOperationCancelled, FMultiplayerSessionOperationHandle OperationHandle);
+DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnJoinTravelComplete, bool bWasSuccessful);
 DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnDestroySessionComplete, bool bWasSuccessful);
 DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnStartSessionComplete, bool bWasSuccessful);
 DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnFindSessionsComplete, const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessul);
 DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnCancelFindSessionsComplete, bool bWasSuccessul);
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FMultiplayerOnFindSessionsPage, const TArray<FOnlineSessionSearchResult>& Page, int32 NextCursor, bool bIsLastPage);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnSessionStateChanged, EMultiplayerSessionState OldState, EMultiplayerSessionState NewState);
 DECLARE_MULTICAST_DELEGATE_ThreeParams(FMultiplayerOnSessionInviteReceived, const FUniqueNetId& UserId, const FUniqueNetId& FromId, const FOnlineSessionSearchResult& InviteResult);
 DECLARE_MULTICAST_DELEGATE_ThreeParams(FMultiplayerOnSessionInviteAccepted, const bool bWasSuccessful, FUniqueNetIdPtr UserId, const FOnlineSessionSearchResult& InviteResult);
-DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnSesionInviteSentComplete, bool bWasSuccessful);
-DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnGetFriendsListComplete, bool bWasSuccessful, TArray<TSharedRef<FOnlineFriend>> FriendsList);
+DECLARE_DELEGATE_TwoParams(FMultiplayerOnSessionInviteSent, FMultiplayerInviteHandle InviteHandle, bool bWasSuccessful);
+DECLARE_DELEGATE_TwoParams(FMultiplayerOnSessionInvitesSent, FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnGetFriendsListComplete, bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta);
+DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnAchievementsReady, bool bWasSuccessful);
+DECLARE_DELEGATE_OneParam(FMultiplayerOnFriendPresenceChanged, const TArray<FMultiplayerFriendPresenceChange>& Changes);
 
 DECLARE_LOG_CATEGORY_EXTERN(LogMultiplayerSession, Log, All);
 
-class FOnlineUserPresence;
-
-enum class SteamAvatarSize : uint8
-{
-	SteamAvatar_INVALID = 0,
-	SteamAvatar_Small = 1,
-	SteamAvatar_Medium = 2,
-	SteamAvatar_Large = 3
-};
 
 /**
  * 
  */
-UCLASS()
+UCLASS(Config = Game)
 class MULTIPLAYERSESSIONS_API UMultiplayerSessionsSubsystem : public UGameInstanceSubsystem
 {
 	GENERATED_BODY()
@@ -48,18 +135,69 @@ public:
 
 	UMultiplayerSessionsSubsystem();
 
-	//Session Inteface
-	void CreateSession(int32 NumPublicConnections = 0, FString MatchType = "Default");
-	void FindSessions(int32 MaxSearchResults);
-	void JoinSession(const FOnlineSessionSearchResult& SessionResult);
-	void DestroySession();
-	void StartSession();
+	//Online interfaces are resolved on first use, each one only when something needs it, and released here
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//Session Inteface. Calls are queued and run one at a time, repeated calls of the same kind collapse into one
+	//MatchType and MapName are advertised to searches, an empty MapName advertises the current map
+	//Dedicated servers host through CreateDedicatedSession automatically
+	FMultiplayerSessionOperationHandle CreateSession(int32 NumPublicConnections = 0, FString MatchType = "Default", FString MapName = FString());
+	//Registers a game server session with bIsDedicated, no local player needed. Presence and lobbies stay off,
+	//searches find it with the DedicatedServer or GameServerList host type
+	FMultiplayerSessionOperationHandle CreateDedicatedSession(int32 NumPublicConnections, FString MatchType = "Default", FString MapName = FString());
+	FMultiplayerSessionOperationHandle FindSessions(int32 MaxSearchResults, const FMultiplayerSessionSearchFilter& Filter = FMultiplayerSessionSearchFilter());
+	//Emits results through MultiplayerOnFindSessionsPage in pages of PageSize while the search runs, and ends the
+	//search early once StopAfterJoinable joinable sessions were found (0 searches until the backend is done).
+	//Streaming polls the backend's result list every SessionSearchPollInterval. Most backends, Steam and Null among
+	//them, only fill it once the search completes, so there the pages and the early stop all arrive at the end.
+	//Pages are copies, they stay valid after the next search
+	FMultiplayerSessionOperationHandle FindSessionsStreaming(int32 MaxSearchResults, int32 PageSize = 10, int32 StopAfterJoinable = 0, const FMultiplayerSessionSearchFilter& Filter = FMultiplayerSessionSearchFilter());
+	//Page of the results collected by the last search, starting at Cursor. Empty once the cursor is past the end.
+	//Points into the search, copy it to keep it past the next one
+	TArrayView<const FOnlineSessionSearchResult> GetSessionSearchPage(int32 Cursor, int32 PageSize) const;
+	static bool IsSessionJoinable(const FOnlineSessionSearchResult& SessionResult);
+	//Searches for sessions of MatchType with a free slot, ranks the results with FMultiplayerSessionRanking and joins
+	//the best one. The outcome arrives through MultiplayerOnJoinSessionComplete, SessionDoesNotExist if nothing joinable was found.
+	//HostType picks between player hosted lobbies and dedicated servers
+	FMultiplayerSessionOperationHandle QuickJoinBestSession(const FString& MatchType, int32 MaxSearchResults = 50, bool bTravelAfterJoin = false,
+		EMultiplayerSessionHostType HostType = EMultiplayerSessionHostType::ListenServer);
+	FMultiplayerSessionRankingParams MakeDefaultRankingParams(const FString& MatchType) const;
+	//With bTravelAfterJoin the subsystem takes the player into the game itself: the host's map loads in the background
+	//while the join and the connection run, then the player client travels. MultiplayerOnJoinTravelComplete reports
+	//once the map is loaded or the travel failed. Invites accepted from the platform always travel
+	FMultiplayerSessionOperationHandle JoinSession(const FOnlineSessionSearchResult& SessionResult, bool bTravelAfterJoin = false);
+	FMultiplayerSessionOperationHandle DestroySession();
+	FMultiplayerSessionOperationHandle StartSession();
+	//A queued operation is dropped and reported through MultiplayerOnSessionOperationCancelled with its handle, not as a
+	//failed completion. Of the running ones only a search can be aborted, it then completes as failed
+	bool CancelSessionOperation(FMultiplayerSessionOperationHandle OperationHandle);
+	void CancelAllSessionOperations();
+	EMultiplayerSessionState GetSessionState() const { return SessionState; }
 
 	//Friends Inteface
-	void SendSessionInviteToFriend(APlayerController* PlayerController, const FUniqueNetIdPtr FriendUniqueNetId);
-	void GetFriendsList(APlayerController* PlayerController);
+	FMultiplayerInviteHandle SendSessionInviteToFriend(APlayerController* PlayerController, const FUniqueNetIdPtr FriendUniqueNetId, const FMultiplayerOnSessionInviteSent& OnInviteSent);
+	FMultiplayerInviteHandle SendSessionInvitesToFriends(APlayerController* PlayerController, const TArray<FUniqueNetIdRef>& FriendUniqueNetIds, const FMultiplayerOnSessionInvitesSent& OnInvitesSent);
+	//Drops the completion delegate of a batch, for callers that go away before it reports. The batch itself keeps sending
+	void UnbindSessionInviteCallback(FMultiplayerInviteHandle InviteHandle);
+	//Reads the friends list, every listener of MultiplayerOnGetFriendsListComplete gets the delta. Returns true without
+	//reading or broadcasting while the cache is fresh, the caller then takes the list from GetCachedFriendsList
+	bool GetFriendsList(APlayerController* PlayerController, bool bForceRefresh = false);
+	const TArray<TSharedRef<FOnlineFriend>>& GetCachedFriendsList() const { return CachedFriendsList; }
+	void InvalidateFriendsListCache();
 	TSharedPtr<FOnlineFriend> GetFriend(APlayerController* PlayerController, const FUniqueNetIdPtr FriendUniqueNetId);
 	bool IsAFriend(APlayerController* PlayerController, const FUniqueNetIdPtr UniqueNetId);
+	//Presence Interface. Subscribers get the presence changes of cached friends, batched over PresenceCoalesceWindow.
+	//The online subsystem pushes them as events, nothing is polled and the friends list isn't re-read
+	FMultiplayerPresenceSubscriptionHandle SubscribeToFriendPresence(const FMultiplayerOnFriendPresenceChanged& OnPresenceChanged);
+	void UnsubscribeFromFriendPresence(FMultiplayerPresenceSubscriptionHandle SubscriptionHandle);
+	//Newest presence known for a cached friend, null if they aren't one. Valid until the next presence batch or friends read
+	const FOnlineUserPresence* GetFriendPresence(const FUniqueNetIdPtr FriendUniqueNetId) const;
+	//Returns the cached avatar, or null and calls OnReady later with the avatar (null if there is none). Never blocks
+	UTexture2D* GetFriendAvatar(const FUniqueNetIdPtr UniqueNetId, SteamAvatarSize AvatarSize, const FMultiplayerOnAvatarReady& OnReady, FMultiplayerAvatarRequestHandle& OutHandle);
+	void CancelFriendAvatarRequest(FMultiplayerAvatarRequestHandle RequestHandle);
+	//Tests and benchmarks swap in FMultiplayerFakeAvatarProvider, null goes back to the platform's avatars
+	void SetAvatarProviderOverride(const FMultiplayerAvatarProviderPtr& Provider);
 
 	//ExternalUI Interface
 	void ShowProfileUI(const FUniqueNetIdPtr PlayerViewingProfile, const FUniqueNetIdPtr PlayerToViewProfileOf);
@@ -70,20 +208,30 @@ public:
 	void ShowStoreUI(APlayerController* PlayerController, const FShowStoreParams& ShowParams);
 	void ShowSendMessageToUserUI(APlayerController* PlayerController, const FUniqueNetId& Recipient, const FShowSendMessageParams& ShowParams);
 
-	//Achievement Interaface
-	void ReadAchievements(const FUniqueNetIdPtr PlayerId);
-	void ReadAchievementDescriptions(const FUniqueNetIdPtr PlayerId);
-	FOnlineAchievement GetAchievement(const FUniqueNetIdPtr PlayerId, FString AchievementId);
-	FOnlineAchievementDesc GetAchievementDescription(FString AchievementId);
+	//Achievement Interaface. Queries the player's achievements and their descriptions once, MultiplayerOnAchievementsReady
+	//fires when both landed. Unlocks reported by the platform refresh the snapshot on their own
+	void PrefetchAchievements(const FUniqueNetIdPtr PlayerId, bool bForceRefresh = false);
+	bool AreAchievementsReady() const { return AchievementSnapshot.IsValid(); }
+	//Null until ready or for unknown ids. Points into the current snapshot, hold GetAchievementSnapshot() to keep it past a refresh
+	const FOnlineAchievement* FindAchievement(FName AchievementId) const;
+	const FOnlineAchievementDesc* FindAchievementDescription(FName AchievementId) const;
+	TSharedPtr<const FMultiplayerAchievementSnapshot> GetAchievementSnapshot() const { return AchievementSnapshot; }
+	//Stat writes are merged per player in memory and sent as one write per player every StatFlushInterval, when the
+	//session is destroyed, on FlushStats (match end) and on shutdown. WriteAchievement sets the value, AddStat adds to it
 	void WriteAchievement(const FUniqueNetIdPtr UniqueNetId, FName StatName, float Value);
+	void AddStat(const FUniqueNetIdPtr UniqueNetId, FName StatName, float Delta);
+	void FlushStats();
 
 	bool ServerTravel(UObject* WorldContextObject, const FString& InURL, bool bAbsolute, bool bShouldSkipGameNotify);
 
-	const FOnlineUserPresence GetPresence()
+	//Only swap backends while no session operation, friends read or invite batch is running
+	void SetOnlineServicesOverride(const FMultiplayerOnlineServices& Services);
+
+	//Issue to completion latency of every async online call, also printed by MultiplayerSessions.DumpLatency [csv] [reset]
+	const FMultiplayerSessionMetrics& GetSessionMetrics() const { return SessionMetrics; }
+	void ResetSessionMetrics() { SessionMetrics.Reset(); }
 
 	/*
-	UTexture2D* GetSteamFriendAvatar(const FUniqueNetIdPtr UniqueNetId, SteamAvatarSize AvatarSize = SteamAvatarSize::SteamAvatar_Medium);
-	bool RequestSteamFriendInfo(const FUniqueNetIdPtr UniqueNetId, bool bRequireNameOnly = false);
 	int32 GetSteamFriendGamePlayed(const FUniqueNetIdPtr UniqueNetId);
 
 	AdvancedSessionsLibrary.h
@@ -116,13 +264,17 @@ public:
 	FMultiplayerOnCreateSessionComplete MultiplayerOnCreateSessionComplete;
 	FMultiplayerOnDestroySessionComplete MultiplayerOnDestroySessionComplete;
 	FMultiplayerOnJoinSessionComplete MultiplayerOnJoinSessionComplete;
+	FMultiplayerOnJoinTravelComplete MultiplayerOnJoinTravelComplete;
 	FMultiplayerOnStartSessionComplete MultiplayerOnStartSessionComplete;
+	FMultiplayerOnSessionOperationCancelled MultiplayerOnSessionOperationCancelled;
 	FMultiplayerOnFindSessionsComplete MultiplayerOnFindSessionsComplete;
 	FMultiplayerOnCancelFindSessionsComplete MultiplayerOnCancelFindSessionsComplete;
+	FMultiplayerOnFindSessionsPage MultiplayerOnFindSessionsPage;
+	FMultiplayerOnSessionStateChanged MultiplayerOnSessionStateChanged;
 	FMultiplayerOnSessionInviteReceived MultiplayerOnSessionInviteReceived;
 	FMultiplayerOnSessionInviteAccepted MultiplayerOnSessionInviteAccepted;
-	FMultiplayerOnSesionInviteSentComplete MultiplayerOnSesionInviteSentComplete;
 	FMultiplayerOnGetFriendsListComplete MultiplayerOnGetFriendsListComplete;
+	FMultiplayerOnAchievementsReady MultiplayerOnAchievementsReady;
 
 protected:
 
@@ -139,7 +291,13 @@ protected:
 	//Friends interface callbacks
 	void OnReadFriendsListComplete(int32 LocalUserNum, bool bWasSuccessful, const FString& ListName, const FString& ErrorStr);
 
+	//Presence interface callbacks
+	void OnPresenceReceived(const FUniqueNetId& UserId, const TSharedRef<FOnlineUserPresence>& Presence);
+
 	//Achievements interface callbacks
+	void OnQueryAchievementsComplete(const FUniqueNetId& PlayerId, const bool bWasSuccessful);
+	void OnQueryAchievementDescriptionsComplete(const FUniqueNetId& PlayerId, const bool bWasSuccessful);
+	void OnAchievementUnlocked(const FUniqueNetId& PlayerId, const FString& AchievementId);
 
 private:
 	
@@ -147,6 +305,9 @@ private:
 	bool IsValidFriendsInterface();
 	bool IsValidExternalUIInterface();
 	bool IsValidAchievementsInterface();
+	bool IsValidPresenceInterface();
+	void ClearSessionInterfaceDelegates();
+	void ClearPresenceDelegates();
 
 	TSharedPtr<FOnlineSessionSettings> LastSessionSettings;
 	TSharedPtr<FOnlineSessionSearch> LastSessionSearch;
@@ -155,11 +316,134 @@ private:
 	IOnlineSessionPtr SessionInterface;
 	IOnlineExternalUIPtr ExternalUIInterface;
 	IOnlineAchievementsPtr AchievementsInterface;
+	IOnlinePresencePtr PresenceInterface;
 
-	bool bCreateSessionOnDestroy{ false };
-	int32 LastNumPublicConnections;
+	FMultiplayerOnlineServices OnlineServicesOverride;
+	FMultiplayerSessionMetrics SessionMetrics;
+
+	int32 LastNumPublicConnections{ 0 };
 	FString LastMatchType;
 
+	//Session operation queue. Only one operation talks to the session interface at a time, the rest wait here
+	enum class ESessionOperationType : uint8
+	{
+		Create,
+		Find,
+		Join,
+		Destroy,
+		Start
+	};
+
+	struct FSessionOperation
+	{
+		ESessionOperationType Type{ ESessionOperationType::Create };
+		uint32 Id{ 0 };
+		int32 NumPublicConnections{ 0 };
+		FString MatchType;
+		int32 MaxSearchResults{ 0 };
+		FMultiplayerSessionSearchFilter SearchFilter;
+		FString MapName;
+		bool bDedicated{ false };
+		bool bStreamSearchResults{ false };
+		int32 SearchPageSize{ 0 };
+		int32 StopAfterJoinable{ 0 };
+		bool bQuickJoin{ false };
+		bool bTravelAfterJoin{ false };
+		FMultiplayerSessionRankingParams RankingParams;
+		FOnlineSessionSearchResult SessionResult;
+	};
+
+	TArray<FSessionOperation> QueuedSessionOperations;
+	TOptional<FSessionOperation> ActiveSessionOperation;
+	uint32 NextSessionOperationId{ 1 };
+	EMultiplayerSessionState SessionState{ EMultiplayerSessionState::Idle };
+	//Times the active operation from the moment it is handed to the session interface
+	FMultiplayerLatencyTimer SessionOperationTimer;
+
+	FMultiplayerSessionOperationHandle EnqueueSessionOperation(FSessionOperation&& Operation);
+	static bool IsSameSessionRequest(const FSessionOperation& A, const FSessionOperation& B);
+	void ProcessNextSessionOperation();
+	void FinishActiveSessionOperation(ESessionOperationType Type, bool bWasSuccessful);
+	bool IsActiveSessionOperation(ESessionOperationType Type) const;
+	bool IsSessionOperationPending(ESessionOperationType Type) const;
+	static EMultiplayerSessionMetric GetSessionOperationMetric(ESessionOperationType Type);
+	void OnSessionOperationCancelled(const FSessionOperation& Operation);
+
+	void ExecuteCreateSession(const FSessionOperation& Operation);
+	FUniqueNetIdPtr GetLocalUserNetId() const;
+	//The Null subsystem (local testing, load tests) can only advertise and find sessions over LAN
+	static bool IsLanOnlySubsystem();
+	void ExecuteFindSessions(const FSessionOperation& Operation);
+
+	//Streaming search state. Results are polled from LastSessionSearch while the backend fills it in
+	void PollStreamingSessionSearch();
+	void EmitSessionSearchPages(bool bIsLastPage);
+	void FinishStreamingSessionSearch(bool bWasSuccessful);
+
+	FTimerHandle SessionSearchPollTimerHandle;
+	int32 SessionSearchCursor{ 0 };
+	int32 SessionSearchCountedResults{ 0 };
+	int32 SessionSearchJoinableCount{ 0 };
+
+	UPROPERTY(Config)
+	float SessionSearchPollInterval{ 0.1f };
+
+	void JoinBestSearchResult(const FMultiplayerSessionRankingParams& RankingParams, bool bTravelAfterJoin);
+
+	//Build id advertised by hosted sessions, searches pass it in their filter to only see compatible hosts (0 disables)
+	UPROPERTY(Config)
+	int32 SessionBuildId{ 0 };
+
+	//Region advertised by hosted sessions and preferred when ranking search results
+	UPROPERTY(Config)
+	FString SessionRegion;
+
+	//Quick join stops searching after this many joinable sessions, trading a complete list for a faster join
+	UPROPERTY(Config)
+	int32 QuickJoinStopAfterJoinable{ 10 };
+
+	UPROPERTY(Config)
+	int32 QuickJoinMaxPingInMs{ 0 };
+	void ExecuteJoinSession(const FSessionOperation& Operation);
+	//Client travels the first local player to the session joined under NAME_GameSession
+	bool TravelToJoinedSession();
+
+	//Join pipeline, from the join request until the host's map is loaded on the client. Each stage is timed in
+	//SessionMetrics, the whole way under JoinToGame
+	void BeginJoinTravel();
+	void PreloadSessionMap(const FOnlineSessionSearchResult& SessionResult);
+	void OnSessionMapPreloaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result);
+	void OnJoinTravelMapLoaded(UWorld* LoadedWorld);
+	void OnJoinTravelFailure(UWorld* World, ETravelFailure::Type FailureType, const FString& ErrorString);
+	void OnJoinNetworkFailure(UWorld* World, UNetDriver* NetDriver, ENetworkFailure::Type FailureType, const FString& ErrorString);
+	void FinishJoinTravel(bool bWasSuccessful);
+	//Whether the running or a queued session operation still leads to a join travel
+	bool IsJoinTravelRequested() const;
+	void ClearJoinTravelDelegates();
+
+	bool bJoinTravelInProgress{ false };
+	FMultiplayerLatencyTimer JoinToGameTimer;
+	FMultiplayerLatencyTimer PreloadMapTimer;
+	FMultiplayerLatencyTimer ConnectToSessionTimer;
+	FName PreloadingMapName;
+	FDelegateHandle PostLoadMapDelegateHandle;
+	FDelegateHandle TravelFailureDelegateHandle;
+	FDelegateHandle NetworkFailureDelegateHandle;
+
+	//World of the preloaded map, referenced so the garbage collection at the start of travel keeps it for LoadMap
+	UPROPERTY(Transient)
+	TObjectPtr<UWorld> PreloadedMapWorld;
+
+	//Loads the map advertised by the host while joining, so travel only waits for what is left of it
+	UPROPERTY(Config)
+	bool bPreloadJoinedSessionMap{ true };
+	void ExecuteDestroySession();
+	void ExecuteStartSession();
+
+	void SetSessionState(EMultiplayerSessionState NewState);
+	EMultiplayerSessionState GetStateFromNamedSession() const;
+	bool HasSessionAvailable() const;
+
 	//Delegate fired when a session create request has completed
 	FOnCreateSessionCompleteDelegate CreateSessionCompleteDelegate;
 	FDelegateHandle CreateSessionCompleteDelegateHandle;
@@ -195,6 +479,134 @@ private:
 	FOnSessionInviteReceivedDelegate SessionInviteReceivedDelegate;
 	FDelegateHandle SessionInviteReceivedDelegateHandle;
 
+	//Invites are sent in batches, one batch per SendSessionInvitesToFriends call. Batches wait for the host session
+	//to exist, then share a token bucket refilled at InvitesPerSecond so big batches don't hammer the backend
+	struct FPendingInviteBatch
+	{
+		FMultiplayerInviteHandle InviteHandle;
+		int32 ControllerId{ 0 };
+		TArray<FUniqueNetIdRef> FriendIds;
+		TArray<FMultiplayerInviteResult> Results;
+	};
+
+	TArray<FPendingInviteBatch> InviteBatches;
+	FTimerHandle InviteBatchTimerHandle;
+	double InviteTokens{ 0.0 };
+	double LastInviteTokenTime{ 0.0 };
+	bool bInviteBatchesWaitingForSession{ false };
+
+	//Completion delegates of the batches that have not reported yet, keyed by FMultiplayerInviteHandle::Id
+	TMap<uint32, FMultiplayerOnSessionInvitesSent> PendingInviteCallbacks;
+	TMap<uint32, FMultiplayerLatencyTimer> InviteTimers;
+	uint32 NextInviteHandleId{ 1 };
+
+	void ProcessInviteBatches();
+	void FailInviteBatches();
+	void CompleteInviteBatch(FMultiplayerInviteHandle InviteHandle, const TArray<FMultiplayerInviteResult>& Results);
+	void DispatchInviteBatchComplete(FMultiplayerInviteHandle InviteHandle, TArray<FMultiplayerInviteResult> Results);
+
+	//Invites sent per second across all batches, and how many may go out at once after an idle period
+	UPROPERTY(Config)
+	float InvitesPerSecond{ 5.f };
+
+	UPROPERTY(Config)
+	int32 MaxInviteBurst{ 5 };
+
 	//Delegate used when the friends read request has completed
 	FOnReadFriendsListComplete ReadFriendsListCompleteDelegate;
+
+	//Friends list cache. Entries are keyed by unique net id and carry a hash of the fields shown in the UI,
+	//so a re-read only reports the friends that actually changed
+	struct FCachedFriend
+	{
+		TSharedRef<FOnlineFriend> Friend;
+		uint32 StateHash;
+		//Last presence event, newer than Friend->GetPresence() until the next read
+		TSharedPtr<FOnlineUserPresence> Presence;
+	};
+
+	static uint32 GetFriendInfoHash(const FOnlineFriend& Friend);
+	static uint32 GetPresenceHash(const FOnlineUserPresence& Presence);
+	static uint32 GetFriendStateHash(const FOnlineFriend& Friend);
+	void UpdateFriendsListCache(const TArray<TSharedRef<FOnlineFriend>>& FriendsList, FMultiplayerFriendsListDelta& OutDelta);
+	void StartReadFriendsList(int32 LocalUserNum);
+
+	TUniqueNetIdMap<FCachedFriend> CachedFriends;
+	TArray<TSharedRef<FOnlineFriend>> CachedFriendsList;
+	int32 CachedFriendsLocalUserNum{ INDEX_NONE };
+	double CachedFriendsReadTime{ 0.0 };
+	bool bReadFriendsListInFlight{ false };
+	//Local user the running read was issued for, its result is dropped if the cache moved on to another user
+	int32 ReadFriendsListLocalUserNum{ INDEX_NONE };
+	//The cache's user asked while a read for the previous one was running, read again once it lands
+	bool bReadFriendsListQueued{ false };
+	FMultiplayerLatencyTimer ReadFriendsListTimer;
+
+	//How long, in seconds, a successful friends read is served from the cache before GetFriendsList hits the backend again
+	UPROPERTY(Config)
+	float FriendsListCacheTTL{ 30.f };
+
+	//Delegate fired when the online subsystem reports a user's new presence, bound while there are subscribers
+	FOnPresenceReceivedDelegate PresenceReceivedDelegate;
+	FDelegateHandle PresenceReceivedDelegateHandle;
+
+	TMap<uint32, FMultiplayerOnFriendPresenceChanged> PresenceSubscribers;
+	uint32 NextPresenceSubscriptionId{ 1 };
+
+	//Newest presence of each friend that changed since the last batch, so a friend flapping in the window is sent once
+	TUniqueNetIdMap<TSharedRef<FOnlineUserPresence>> PendingPresenceChanges;
+	FTimerHandle PresenceCoalesceTimerHandle;
+
+	void FlushPresenceChanges();
+
+	//Seconds presence events are collected before subscribers get them as one batch
+	UPROPERTY(Config)
+	float PresenceCoalesceWindow{ 0.25f };
+
+	//Achievement store. The snapshot is replaced as a whole once both queries of a prefetch completed
+	TSharedPtr<const FMultiplayerAchievementSnapshot> AchievementSnapshot;
+	FUniqueNetIdPtr AchievementsPlayerId;
+	bool bAchievementsQueryInFlight{ false };
+	bool bAchievementDescriptionsQueryInFlight{ false };
+	//Descriptions belong to the game, not the player, so they are queried once
+	bool bAchievementDescriptionsLoaded{ false };
+	bool bAchievementQueriesFailed{ false };
+	FDelegateHandle AchievementUnlockedDelegateHandle;
+
+	void QueryPlayerAchievements();
+	void FinishAchievementPrefetch();
+	void ClearAchievementDelegates();
+
+	FMultiplayerStatAggregator StatAggregator;
+	FTimerHandle StatFlushTimerHandle;
+
+	bool QueueStat(const FUniqueNetIdPtr& UniqueNetId, FName StatName, float Value, bool bIsSet);
+	void ScheduleStatFlush();
+	void OnStatsWritten(const FUniqueNetIdRef& PlayerId, bool bWasSuccessful);
+
+	UPROPERTY(Config)
+	float StatFlushInterval{ 30.f };
+
+	UPROPERTY(Config)
+	int32 MaxPendingStats{ 256 };
+
+	UPROPERTY(Config)
+	int32 MaxStatWriteRetries{ 3 };
+
+	UPROPERTY(Config)
+	float StatWriteRetryDelay{ 5.f };
+
+	//Created by the first avatar request
+	TUniquePtr<FMultiplayerAvatarService> AvatarService;
+	FMultiplayerAvatarProviderPtr AvatarProviderOverride;
+
+	FMultiplayerAvatarService& GetAvatarService();
+
+	//Texture memory the avatar caches may hold, split evenly between small, medium and large avatars
+	UPROPERTY(Config)
+	int32 AvatarCacheBudgetKB{ 16384 };
+
+	//Avatar textures created per frame, the rest wait for the next frames so a scrolling list never hitches
+	UPROPERTY(Config)
+	int32 MaxAvatarUploadsPerFrame{ 4 };
 };
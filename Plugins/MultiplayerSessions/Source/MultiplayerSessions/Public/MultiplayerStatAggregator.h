@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSubsystemTypes.h"
+#include "OnlineStats.h"
+
+//Change of one stat waiting to be written. Increments add up, a set value replaces everything queued before it
+struct FMultiplayerPendingStat
+{
+	float Value{ 0.f };
+	bool bIsSet{ false };
+
+	//Applies Newer on top of this change
+	void Merge(const FMultiplayerPendingStat& Newer);
+};
+
+//Limits of FMultiplayerStatAggregator
+struct FMultiplayerStatAggregatorLimits
+{
+	//Distinct player and stat pairs held in memory, changes to stats that aren't queued yet are dropped past it
+	int32 MaxPendingStats{ 256 };
+	//Times a failed write is retried before its changes are dropped
+	int32 MaxRetries{ 3 };
+	//Wait before the first retry, doubled on each following one
+	float RetryDelaySeconds{ 5.f };
+};
+
+/**
+ * Collects stat changes per player and merges them, so any number of changes becomes one write object per player.
+ * A player has at most one write in flight. Changes made meanwhile wait for the next flush, and a failed write is
+ * merged back under them and retried with backoff
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerStatAggregator
+{
+public:
+
+	void SetLimits(const FMultiplayerStatAggregatorLimits& InLimits) { Limits = InLimits; }
+
+	//Both return false when the queue is full and the change was dropped
+	bool AddStat(const FUniqueNetIdRef& PlayerId, FName StatName, float Delta);
+	bool SetStat(const FUniqueNetIdRef& PlayerId, FName StatName, float Value);
+
+	//Moves the changes of every player that can be written now into one write object per player
+	void TakeWrites(double Now, TArray<TPair<FUniqueNetIdRef, FOnlineAchievementsWriteRef>>& OutWrites);
+	void CompleteWrite(const FUniqueNetIdRef& PlayerId, bool bWasSuccessful, double Now);
+
+	bool IsFull() const { return NumPendingStats >= Limits.MaxPendingStats; }
+	bool HasPendingStats() const { return NumPendingStats > 0; }
+	int32 GetNumPendingStats() const { return NumPendingStats; }
+	//Earliest time a player waiting to retry can be written again, 0 when none is waiting
+	double GetNextRetryTime() const;
+	void Reset();
+
+private:
+
+	struct FPlayerStats
+	{
+		TMap<FName, FMultiplayerPendingStat> PendingStats;
+		//Changes of the write in flight, merged back under PendingStats if it fails
+		TMap<FName, FMultiplayerPendingStat> InFlightStats;
+		bool bWriteInFlight{ false };
+		int32 Retries{ 0 };
+		double RetryTime{ 0.0 };
+	};
+
+	bool QueueStat(const FUniqueNetIdRef& PlayerId, FName StatName, const FMultiplayerPendingStat& Change);
+
+	FMultiplayerStatAggregatorLimits Limits;
+	TUniqueNetIdMap<FPlayerStats> Players;
+	int32 NumPendingStats{ 0 };
+};
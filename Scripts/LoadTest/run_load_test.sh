@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+# Headless load test: one dedicated server plus N clients on this machine, using the Null online
+# subsystem so no Steam client is needed. Every instance runs with -LoadTest (see ULoadTestSubsystem)
+# and writes its CSV files into the output directory; the client rows are merged into clients.csv.
+#
+# Usage: UE_EDITOR=/path/to/UnrealEditor ./run_load_test.sh [clients=8] [duration_s=120] [out_dir=Saved/LoadTest/<timestamp>]
+
+set -euo pipefail
+
+: "${UE_EDITOR:?Set UE_EDITOR to the UnrealEditor (or UnrealEditor-Cmd) binary}"
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
+PROJECT="$PROJECT_DIR/MultiplayerCourse.uproject"
+
+CLIENTS="${1:-8}"
+DURATION="${2:-120}"
+OUT_DIR="${3:-$PROJECT_DIR/Saved/LoadTest/$(date +%Y%m%d-%H%M%S)}"
+mkdir -p "$OUT_DIR"
+OUT_DIR="$(cd "$OUT_DIR" && pwd)"
+
+# Swap Steam for the Null subsystem, the game falls back to the IpNetDriver and LAN sessions
+ENGINE_INI="-ini:Engine:[OnlineSubsystem]:DefaultPlatformService=Null,[OnlineSubsystemSteam]:bEnabled=false"
+# Keep everyone in the lobby until the whole batch has joined
+GAME_INI="-ini:Game:[/Script/MultiplayerCourse.LobbyGameMode]:MinPlayersToTravel=$CLIENTS,[/Script/MultiplayerCourse.LobbyGameMode]:TravelWhenPlayerCountReached=$CLIENTS"
+COMMON=(-nullrhi -nosound -unattended -nosplash -LoadTest "-LoadTestCsv=$OUT_DIR" "$ENGINE_INI" "$GAME_INI")
+
+PIDS=()
+cleanup() {
+	for PID in "${PIDS[@]}"; do
+		kill "$PID" 2>/dev/null || true
+	done
+}
+trap cleanup INT TERM
+
+echo "Starting server, $CLIENTS clients, ${DURATION}s, output in $OUT_DIR"
+# ALobbyGameMode registers the dedicated session the clients quick join and reads the GAME_INI overrides. The
+# Lobby map prefix picks it too, ?game keeps the script working if the map gets an override of its own
+"$UE_EDITOR" "$PROJECT" "/Game/Maps/Lobby?game=/Script/MultiplayerCourse.LobbyGameMode" -server -log "${COMMON[@]}" \
+	"-LoadTestDuration=$((DURATION + 30))" "-abslog=$OUT_DIR/server.log" >/dev/null 2>&1 &
+PIDS+=($!)
+
+# Give the server time to load the map and advertise its session
+sleep 15
+
+for ((i = 0; i < CLIENTS; i++)); do
+	"$UE_EDITOR" "$PROJECT" -game "${COMMON[@]}" \
+		"-LoadTestDuration=$DURATION" "-LoadTestClientId=$i" "-abslog=$OUT_DIR/client_$i.log" >/dev/null 2>&1 &
+	PIDS+=($!)
+	sleep 0.5
+done
+
+STATUS=0
+for PID in "${PIDS[@]}"; do
+	wait "$PID" || STATUS=1
+done
+
+MERGED="$OUT_DIR/clients.csv"
+FIRST=1
+: > "$MERGED"
+for FILE in "$OUT_DIR"/client_*.csv; do
+	[ -e "$FILE" ] || continue
+	if [ "$FIRST" -eq 1 ]; then
+		cat "$FILE" >> "$MERGED"
+		FIRST=0
+	else
+		tail -n +2 "$FILE" >> "$MERGED"
+	fi
+done
+
+JOINED=$(awk -F, 'NR > 1 && $2 == "ok"' "$MERGED" | wc -l)
+echo "$JOINED/$CLIENTS clients connected, results in $OUT_DIR"
+exit $STATUS
@@ -11,5 +11,11 @@ public class MultiplayerCourseTarget : TargetRules
 		DefaultBuildSettings = BuildSettingsVersion.V5;
 		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_4;
 		ExtraModuleNames.Add("MultiplayerCourse");
+
+		// Compiles Iris in next to the legacy replication path, which one runs is picked by net.Iris.UseIrisReplication
+		bUseIris = true;
+
+		// Lets replicated properties be marked dirty on write instead of compared every net update
+		bWithPushModel = true;
 	}
 }
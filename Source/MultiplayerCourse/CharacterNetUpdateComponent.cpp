@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterNetUpdateComponent.h"
+#include "LobbyGameMode.h"
+#include "MultiplayerCoursePlayerController.h"
+#include "MultiplayerCourseReplicationGraph.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "TimerManager.h"
+
+UCharacterNetUpdateComponent::UCharacterNetUpdateComponent()
+{
+	// Driven by a timer instead, the policy doesn't need per frame precision
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UCharacterNetUpdateComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!GetOwner()->HasAuthority() || GetNetMode() == NM_Standalone) {
+		return;
+	}
+
+	LastActiveTime = GetWorld()->GetTimeSeconds();
+	GetWorld()->GetTimerManager().SetTimer(EvaluateTimerHandle, this, &UCharacterNetUpdateComponent::EvaluateNetUpdatePolicy, EvaluateInterval, true);
+}
+
+void UCharacterNetUpdateComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->GetTimerManager().ClearTimer(EvaluateTimerHandle);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+float UCharacterNetUpdateComponent::GetFrequencyForMovementState(float Speed, bool bFalling) const
+{
+	if (bFalling || Speed >= FastSpeedThreshold) {
+		return FastNetUpdateFrequency;
+	}
+	return Speed > IdleSpeedThreshold ? MovingNetUpdateFrequency : IdleNetUpdateFrequency;
+}
+
+void UCharacterNetUpdateComponent::EvaluateNetUpdatePolicy()
+{
+	ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (!Character) {
+		return;
+	}
+
+	const UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	const float Speed = Movement ? Movement->Velocity.Size() : 0.f;
+	const bool bFalling = Movement && Movement->IsFalling();
+
+	// Turning the camera counts as activity too, otherwise a player looking around would be put to sleep
+	const FRotator ControlRotation = Character->GetControlRotation();
+	const bool bRotated = !ControlRotation.Equals(LastControlRotation, 1.f);
+	LastControlRotation = ControlRotation;
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (Speed > IdleSpeedThreshold || bFalling || bRotated) {
+		LastActiveTime = Now;
+		if (bDormant) {
+			WakeUp();
+		}
+	}
+
+	if (bDormant) {
+		return;
+	}
+
+	const float DormancyDelay = GetDormancyDelay();
+	if (DormancyDelay > 0.f && Now - LastActiveTime >= DormancyDelay) {
+		GoDormant();
+		return;
+	}
+
+	// Also re-applied when the frequency didn't change, the graph's per viewer scaling depends on where viewers are now
+	UMultiplayerCourseReplicationGraph::SetActorNetUpdateFrequency(Character, GetFrequencyForMovementState(Speed, bFalling));
+}
+
+void UCharacterNetUpdateComponent::GoDormant()
+{
+	// The owner has to know before the channel closes, its moves stop reaching the server after that
+	NotifyOwnerDormancy(true);
+
+	bDormant = true;
+	GetOwner()->SetNetDormancy(DORM_DormantAll);
+}
+
+void UCharacterNetUpdateComponent::WakeUp()
+{
+	if (!bDormant) {
+		return;
+	}
+	bDormant = false;
+	LastActiveTime = GetWorld()->GetTimeSeconds();
+
+	AActor* Owner = GetOwner();
+	Owner->SetNetDormancy(DORM_Awake);
+	Owner->ForceNetUpdate();
+	NotifyOwnerDormancy(false);
+}
+
+void UCharacterNetUpdateComponent::NotifyOwnerDormancy(bool bNewDormant) const
+{
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	if (AMultiplayerCoursePlayerController* PlayerController = Pawn ? Pawn->GetController<AMultiplayerCoursePlayerController>() : nullptr) {
+		PlayerController->ClientSetPawnDormant(bNewDormant);
+	}
+}
+
+bool UCharacterNetUpdateComponent::IsInLobby() const
+{
+	// The Lobby map gets ALobbyGameMode through GameModeMapPrefixes in DefaultEngine.ini
+	return GetWorld()->GetAuthGameMode<ALobbyGameMode>() != nullptr;
+}
+
+float UCharacterNetUpdateComponent::GetDormancyDelay() const
+{
+	return IsInLobby() ? LobbyDormancyDelay : IdleDormancyDelay;
+}
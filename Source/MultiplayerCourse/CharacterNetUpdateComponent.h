@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CharacterNetUpdateComponent.generated.h"
+
+/**
+ * Server side replication policy for a character. Picks the net update frequency from what the character
+ * is doing, lets the replication graph scale it per viewer, and puts characters that sit still
+ * (straight away in the lobby, after a while elsewhere) into net dormancy until they move again
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent), Config = Game)
+class MULTIPLAYERCOURSE_API UCharacterNetUpdateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+	friend class FCharacterNetUpdateComponentSpec;
+
+public:
+
+	UCharacterNetUpdateComponent();
+
+	// Brings a dormant character back to normal replication
+	void WakeUp();
+
+	bool IsDormant() const { return bDormant; }
+
+protected:
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+
+	void EvaluateNetUpdatePolicy();
+	float GetFrequencyForMovementState(float Speed, bool bFalling) const;
+	void GoDormant();
+	void NotifyOwnerDormancy(bool bNewDormant) const;
+	bool IsInLobby() const;
+	float GetDormancyDelay() const;
+
+	FTimerHandle EvaluateTimerHandle;
+	float LastActiveTime{ 0.f };
+	FRotator LastControlRotation{ ForceInit };
+	bool bDormant{ false };
+
+	// How often the policy is re-evaluated on the server
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Net Update")
+	float EvaluateInterval{ 0.25f };
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Net Update")
+	float IdleNetUpdateFrequency{ 5.f };
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Net Update")
+	float MovingNetUpdateFrequency{ 30.f };
+
+	// Used above FastSpeedThreshold and while falling, where corrections are most visible
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Net Update")
+	float FastNetUpdateFrequency{ 60.f };
+
+	// Below this speed (cm/s) the character counts as standing still
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Net Update")
+	float IdleSpeedThreshold{ 10.f };
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Net Update")
+	float FastSpeedThreshold{ 550.f };
+
+	// Seconds without activity before going dormant in the lobby map, 0 disables it
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Net Update")
+	float LobbyDormancyDelay{ 2.f };
+
+	// Seconds without activity before going dormant anywhere else, 0 disables it
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Net Update")
+	float IdleDormancyDelay{ 30.f };
+};
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Interfaces/OnlineFriendsInterface.h"
+
+#include "FriendListItem.generated.h"
+
+/**
+ * Data item behind a row of the friends list view. The list view only creates entry widgets for the visible
+ * rows and binds them to these items lazily, so one item exists per friend while widgets stay pooled.
+ */
+UCLASS()
+class MULTIPLAYERCOURSE_API UFriendListItem : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	TSharedPtr<FOnlineFriend> FriendInfo;
+};
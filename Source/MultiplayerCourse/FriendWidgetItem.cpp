@@ -2,26 +2,41 @@
 
 
 #include "FriendWidgetItem.h"
+#include "FriendListItem.h"
 #include "MultiplayerSessionsSubsystem.h"
 #include "Components/TextBlock.h"
 #include "Components/Button.h"
+#include "Components/Image.h"
+#include "Components/HorizontalBox.h"
+#include "Components/HorizontalBoxSlot.h"
+#include "Blueprint/WidgetTree.h"
+#include "Engine/Texture2D.h"
 
 void UFriendWidgetItem::WidgetSetup()
 {
-	AddToViewport();
 	SetVisibility(ESlateVisibility::Visible);
 	SetIsFocusable(true);
 
-	UGameInstance* GameInstance = GetGameInstance();
-	if (GameInstance) {
-		MultiplayerSessionsSubsystem = GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>();
-	}
+	UpdateFriendInfo();
+	RequestAvatar();
+}
 
-	if (MultiplayerSessionsSubsystem) {
-		MultiplayerSessionsSubsystem->MultiplayerOnSesionInviteSentComplete.AddUObject(this, &UFriendWidgetItem::OnInviteSent);
+void UFriendWidgetItem::UpdateFriendInfo()
+{
+	if (!FriendInfo.IsValid()) {
+		return;
+	}
+	if (FriendName) {
+		FriendName->SetText(FText::FromString(FriendInfo->GetDisplayName()));
+	}
+	if (FriendStatus) {
+		//Presence events are newer than what the friends list reported
+		const FOnlineUserPresence* Presence = MultiplayerSessionsSubsystem ? MultiplayerSessionsSubsystem->GetFriendPresence(FriendInfo->GetUserId()) : nullptr;
+		if (!Presence) {
+			Presence = &FriendInfo->GetPresence();
+		}
+		FriendStatus->SetText(!Presence->bIsOnline ? FText::FromString(TEXT("Offline")) : Presence->bIsPlayingThisGame ? FText::FromString(TEXT("In game")) : FText::FromString(TEXT("Online")));
 	}
-
-	FriendName->SetText(FText::FromString(FriendInfo->GetDisplayName()));
 }
 
 bool UFriendWidgetItem::Initialize()
@@ -36,6 +51,48 @@ bool UFriendWidgetItem::Initialize()
 	return true;
 }
 
+void UFriendWidgetItem::NativeOnInitialized()
+{
+	Super::NativeOnInitialized();
+
+	//Runs once per pooled widget, not every time the row is bound to another friend
+	UGameInstance* GameInstance = GetGameInstance();
+	if (GameInstance) {
+		MultiplayerSessionsSubsystem = GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>();
+	}
+	AddMissingWidgets();
+}
+
+void UFriendWidgetItem::AddMissingWidgets()
+{
+	UHorizontalBox* Row = WidgetTree ? Cast<UHorizontalBox>(GetRootWidget()) : nullptr;
+	if (!Row) {
+		return;
+	}
+
+	//Avatar in front of the name, at the size of the medium Steam avatar it shows
+	if (!FriendAvatar) {
+		FriendAvatar = WidgetTree->ConstructWidget<UImage>(UImage::StaticClass(), TEXT("FriendAvatar"));
+		FriendAvatar->SetDesiredSizeOverride(FVector2D(64.f, 64.f));
+		FriendAvatar->SetVisibility(ESlateVisibility::Hidden);
+		if (UHorizontalBoxSlot* AvatarSlot = Cast<UHorizontalBoxSlot>(Row->InsertChildAt(0, FriendAvatar))) {
+			AvatarSlot->SetVerticalAlignment(VAlign_Center);
+			AvatarSlot->SetPadding(FMargin(0.f, 0.f, 8.f, 0.f));
+		}
+	}
+
+	//Presence badge right after the name
+	if (!FriendStatus) {
+		FriendStatus = WidgetTree->ConstructWidget<UTextBlock>(UTextBlock::StaticClass(), TEXT("FriendStatus"));
+		const int32 NameIndex = FriendName ? Row->GetChildIndex(FriendName) : INDEX_NONE;
+		UPanelSlot* StatusSlot = NameIndex != INDEX_NONE ? Row->InsertChildAt(NameIndex + 1, FriendStatus) : Row->AddChild(FriendStatus);
+		if (UHorizontalBoxSlot* StatusBoxSlot = Cast<UHorizontalBoxSlot>(StatusSlot)) {
+			StatusBoxSlot->SetVerticalAlignment(VAlign_Center);
+			StatusBoxSlot->SetPadding(FMargin(8.f, 0.f, 0.f, 0.f));
+		}
+	}
+}
+
 void UFriendWidgetItem::NativeConstruct()
 {
 	Super::NativeConstruct();
@@ -43,23 +100,89 @@ void UFriendWidgetItem::NativeConstruct()
 
 void UFriendWidgetItem::NativeDestruct()
 {
+	UnbindPendingInvite();
+	CancelPendingAvatar();
+
 	Super::NativeDestruct();
 }
 
+void UFriendWidgetItem::NativeOnListItemObjectSet(UObject* ListItemObject)
+{
+	IUserObjectListEntry::NativeOnListItemObjectSet(ListItemObject);
+
+	//The result of an invite sent to the previous friend bound to this row is no longer relevant
+	UnbindPendingInvite();
+
+	UFriendListItem* FriendItem = Cast<UFriendListItem>(ListItemObject);
+	FriendInfo = FriendItem ? FriendItem->FriendInfo : nullptr;
+	UpdateFriendInfo();
+	RequestAvatar();
+}
+
+void UFriendWidgetItem::RequestAvatar()
+{
+	CancelPendingAvatar();
+	if (!FriendAvatar) {
+		return;
+	}
+
+	UTexture2D* Avatar = nullptr;
+	if (FriendInfo.IsValid() && MultiplayerSessionsSubsystem) {
+		Avatar = MultiplayerSessionsSubsystem->GetFriendAvatar(FriendInfo->GetUserId(), SteamAvatarSize::SteamAvatar_Medium,
+			FMultiplayerOnAvatarReady::CreateUObject(this, &UFriendWidgetItem::OnAvatarReady), PendingAvatar);
+	}
+	SetAvatar(Avatar);
+}
+
+void UFriendWidgetItem::CancelPendingAvatar()
+{
+	if (PendingAvatar.IsValid() && MultiplayerSessionsSubsystem) {
+		MultiplayerSessionsSubsystem->CancelFriendAvatarRequest(PendingAvatar);
+	}
+	PendingAvatar.Reset();
+}
+
+void UFriendWidgetItem::SetAvatar(UTexture2D* Avatar)
+{
+	if (!FriendAvatar) {
+		return;
+	}
+	FriendAvatar->SetBrushFromTexture(Avatar);
+	FriendAvatar->SetVisibility(Avatar ? ESlateVisibility::HitTestInvisible : ESlateVisibility::Hidden);
+}
+
+void UFriendWidgetItem::OnAvatarReady(UTexture2D* Avatar)
+{
+	PendingAvatar.Reset();
+	SetAvatar(Avatar);
+}
+
 void UFriendWidgetItem::SendInvite()
 {
 	UWorld* World = GetWorld();
 	if (World) {
 		APlayerController* PlayerController = World->GetFirstPlayerController();
-		if (PlayerController) { 
+		if (PlayerController && MultiplayerSessionsSubsystem && FriendInfo.IsValid()) { 
 			GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("UFriendWidgetItem::SendInvite")));
-			MultiplayerSessionsSubsystem->SendSessionInviteToFriend(PlayerController, FriendInfo->GetUserId());
+			UnbindPendingInvite();
+			PendingInvite = MultiplayerSessionsSubsystem->SendSessionInviteToFriend(PlayerController, FriendInfo->GetUserId(),
+				FMultiplayerOnSessionInviteSent::CreateUObject(this, &UFriendWidgetItem::OnInviteSent));
 		}
 	}
 }
 
-void UFriendWidgetItem::OnInviteSent(bool bWasSuccessful)
+void UFriendWidgetItem::UnbindPendingInvite()
 {
+	if (PendingInvite.IsValid() && MultiplayerSessionsSubsystem) {
+		MultiplayerSessionsSubsystem->UnbindSessionInviteCallback(PendingInvite);
+	}
+	PendingInvite.Reset();
+}
+
+void UFriendWidgetItem::OnInviteSent(FMultiplayerInviteHandle InviteHandle, bool bWasSuccessful)
+{
+	PendingInvite.Reset();
+
 	if (!bWasSuccessful) {
 		UE_LOG(LogTemp, Warning, TEXT("Invite failed to send"));
 		return;
@@ -4,36 +4,48 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
+#include "Blueprint/IUserObjectListEntry.h"
 #include "Interfaces/OnlineFriendsInterface.h"
 #include "OnlineSubsystem.h"
+#include "MultiplayerSessionsSubsystem.h"
 
 #include "FriendWidgetItem.generated.h"
 
 class UButton;
 class UTextBlock;
+class UImage;
+class UTexture2D;
 class UMultiplayerSessionsSubsystem;
 
 /**
  * 
  */
 UCLASS()
-class MULTIPLAYERCOURSE_API UFriendWidgetItem : public UUserWidget
+class MULTIPLAYERCOURSE_API UFriendWidgetItem : public UUserWidget, public IUserObjectListEntry
 {
 	GENERATED_BODY()
 	
 public:
 
+	// Binds a row created outside a list view (UMenu::FriendsListBox) to FriendInfo
 	UFUNCTION(BlueprintCallable)
 	void WidgetSetup();
 
+	// Refreshes the row from FriendInfo, used when the friend's name or presence changed
+	void UpdateFriendInfo();
+
 	TSharedPtr<FOnlineFriend> FriendInfo;
 
 protected:
 
 	virtual bool Initialize() override;
+	virtual void NativeOnInitialized() override;
 	virtual void NativeConstruct() override;
 	virtual void NativeDestruct() override;
 
+	// IUserObjectListEntry interface, called when the list view binds a pooled row to a friend
+	virtual void NativeOnListItemObjectSet(UObject* ListItemObject) override;
+
 private:
 
 	UPROPERTY(meta=(BindWidget))
@@ -42,10 +54,33 @@ private:
 	UPROPERTY(meta = (BindWidget))
 	UTextBlock* FriendName;
 
+	UPROPERTY(meta = (BindWidgetOptional))
+	UImage* FriendAvatar;
+
+	// Online / In game / Offline badge, kept current by the menu's presence subscription
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* FriendStatus;
+
+	// WBP_FriendItem only lays out the button and the name, the optional parts it lacks are added to its row here
+	void AddMissingWidgets();
+
 	UFUNCTION()
 	void SendInvite();
 
-	void OnInviteSent(bool bWasSuccessful);
+	void OnInviteSent(FMultiplayerInviteHandle InviteHandle, bool bWasSuccessful);
+
+	// Invite sent from this row that has not reported back yet, dropped when the row is rebound or destroyed
+	FMultiplayerInviteHandle PendingInvite;
+
+	void UnbindPendingInvite();
+
+	// Avatars arrive asynchronously, the row stays blank until then and drops the request when it is rebound
+	void RequestAvatar();
+	void CancelPendingAvatar();
+	void SetAvatar(UTexture2D* Avatar);
+	void OnAvatarReady(UTexture2D* Avatar);
+
+	FMultiplayerAvatarRequestHandle PendingAvatar;
 
 	// The subsystem designed to handle all online session functionality
 	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem;
@@ -0,0 +1,347 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+#include "MultiplayerCourseCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+
+DEFINE_LOG_CATEGORY(LogLagCompensation);
+
+bool ULagCompensationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer)) {
+		return false;
+	}
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void ULagCompensationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ULagCompensationSubsystem::OnWorldPostActorTick);
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	RestoreRewind();
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Super::Deinitialize();
+}
+
+void ULagCompensationSubsystem::AllocateHistory()
+{
+	// One extra frame so a full HistorySeconds window always has a frame on each side of it
+	HistoryFrames = FMath::Max(FMath::CeilToInt32(HistorySeconds * RecordRate), 1) + 1;
+	NumHitboxes = Hitboxes.Num();
+	MaxCharacters = FMath::Max(MaxCharacters, 1);
+
+	FrameTimestamps.SetNumZeroed(HistoryFrames);
+	FrameSerials.SetNumZeroed(HistoryFrames);
+
+	const int32 NumEntries = HistoryFrames * MaxCharacters;
+	CapsuleLocations.SetNumZeroed(NumEntries);
+	CapsuleRotations.SetNumZeroed(NumEntries);
+	CapsuleHalfHeights.SetNumZeroed(NumEntries);
+	HitboxLocations.SetNumZeroed(NumEntries * NumHitboxes);
+	HitboxRotations.SetNumZeroed(NumEntries * NumHitboxes);
+
+	SlotCharacters.SetNum(MaxCharacters);
+	SlotFirstSerials.SetNumZeroed(MaxCharacters);
+	SlotCapsuleRadii.SetNumZeroed(MaxCharacters);
+	RewoundCapsules.SetNum(MaxCharacters);
+	RewoundCapsuleHalfHeights.SetNumZeroed(MaxCharacters);
+	RewoundHitboxLocations.SetNumZeroed(MaxCharacters * NumHitboxes);
+	RewoundSlots.Reserve(MaxCharacters);
+
+	// Popped from the back, so slot 0 is handed out first
+	FreeSlots.Reserve(MaxCharacters);
+	for (int32 Slot = MaxCharacters - 1; Slot >= 0; --Slot) {
+		FreeSlots.Add(Slot);
+	}
+	ActiveSlots.Reserve(MaxCharacters);
+	CharacterSlots.Reserve(MaxCharacters);
+}
+
+void ULagCompensationSubsystem::RegisterCharacter(AMultiplayerCourseCharacter* Character)
+{
+	if (!Character || CharacterSlots.Contains(Character)) {
+		return;
+	}
+	if (HistoryFrames == 0) {
+		AllocateHistory();
+	}
+	if (FreeSlots.IsEmpty()) {
+		UE_LOG(LogLagCompensation, Warning, TEXT("No free slot for %s in ULagCompensationSubsystem::RegisterCharacter, raise MaxCharacters"), *GetNameSafe(Character));
+		return;
+	}
+
+	const int32 Slot = FreeSlots.Pop(EAllowShrinking::No);
+	SlotCharacters[Slot] = Character;
+	SlotFirstSerials[Slot] = NextFrameSerial;
+	SlotCapsuleRadii[Slot] = Character->GetCapsuleComponent()->GetScaledCapsuleRadius();
+	ActiveSlots.Add(Slot);
+	CharacterSlots.Add(Character, Slot);
+
+	// Nobody watches the mesh on a dedicated server, without this its bones keep the pose it was last rendered with
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	if (Mesh && NumHitboxes > 0) {
+		Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	}
+}
+
+void ULagCompensationSubsystem::UnregisterCharacter(AMultiplayerCourseCharacter* Character)
+{
+	int32 Slot = INDEX_NONE;
+	if (!CharacterSlots.RemoveAndCopyValue(Character, Slot)) {
+		return;
+	}
+
+	SlotCharacters[Slot] = nullptr;
+	RewoundSlots.RemoveSingleSwap(Slot, EAllowShrinking::No);
+	ActiveSlots.RemoveSingleSwap(Slot, EAllowShrinking::No);
+	FreeSlots.Add(Slot);
+}
+
+void ULagCompensationSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld() || ActiveSlots.IsEmpty() || World->GetNetMode() == NM_Client) {
+		return;
+	}
+
+	// A little slack so a server ticking at exactly RecordRate doesn't skip every other frame to jitter
+	const double Timestamp = World->GetTimeSeconds();
+	if (LastRecordTime >= 0.0 && Timestamp - LastRecordTime < 0.9 / RecordRate) {
+		return;
+	}
+	RecordFrame(Timestamp);
+}
+
+void ULagCompensationSubsystem::RecordFrame(double Timestamp)
+{
+	const int32 Frame = NextFrame;
+	FrameTimestamps[Frame] = Timestamp;
+	FrameSerials[Frame] = NextFrameSerial++;
+
+	for (const int32 Slot : ActiveSlots) {
+		const AMultiplayerCourseCharacter* Character = SlotCharacters[Slot].Get();
+		if (!Character) {
+			continue;
+		}
+
+		const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		const FTransform& CapsuleTransform = Capsule->GetComponentTransform();
+		const int32 Index = GetFrameIndex(Frame, Slot);
+		CapsuleLocations[Index] = FVector3f(CapsuleTransform.GetLocation());
+		CapsuleRotations[Index] = FQuat4f(CapsuleTransform.GetRotation());
+		CapsuleHalfHeights[Index] = Capsule->GetScaledCapsuleHalfHeight();
+
+		// Bones are as fresh as this tick's animation update, RegisterCharacter keeps the mesh ticking on the server
+		const USkeletalMeshComponent* Mesh = Character->GetMesh();
+		for (int32 Hitbox = 0; Hitbox < NumHitboxes; ++Hitbox) {
+			const FTransform HitboxTransform = Mesh ? Mesh->GetSocketTransform(Hitboxes[Hitbox].Bone) : CapsuleTransform;
+			const int32 HitboxIndex = GetHitboxIndex(Frame, Slot, Hitbox);
+			HitboxLocations[HitboxIndex] = FVector3f(HitboxTransform.GetLocation());
+			HitboxRotations[HitboxIndex] = FQuat4f(HitboxTransform.GetRotation());
+		}
+	}
+
+	NextFrame = (NextFrame + 1) % HistoryFrames;
+	NumRecordedFrames = FMath::Min(NumRecordedFrames + 1, HistoryFrames);
+	LastRecordTime = Timestamp;
+}
+
+bool ULagCompensationSubsystem::FindFrames(int32 Slot, double Timestamp, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const
+{
+	// Serials grow with time, so the frames recorded since the slot was taken are a suffix of the ring
+	int32 Low = 0;
+	int32 High = NumRecordedFrames;
+	while (Low < High) {
+		const int32 Mid = (Low + High) / 2;
+		if (FrameSerials[GetRingFrame(Mid)] < SlotFirstSerials[Slot]) {
+			Low = Mid + 1;
+		}
+		else {
+			High = Mid;
+		}
+	}
+	if (Low == NumRecordedFrames) {
+		return false;
+	}
+	const int32 FirstValid = Low;
+
+	// First frame at or after Timestamp
+	High = NumRecordedFrames;
+	while (Low < High) {
+		const int32 Mid = (Low + High) / 2;
+		if (FrameTimestamps[GetRingFrame(Mid)] < Timestamp) {
+			Low = Mid + 1;
+		}
+		else {
+			High = Mid;
+		}
+	}
+
+	if (Low == FirstValid || Low == NumRecordedFrames) {
+		OutOlderFrame = OutNewerFrame = GetRingFrame(FMath::Min(Low, NumRecordedFrames - 1));
+		OutAlpha = 0.f;
+		return true;
+	}
+
+	OutOlderFrame = GetRingFrame(Low - 1);
+	OutNewerFrame = GetRingFrame(Low);
+	const double Span = FrameTimestamps[OutNewerFrame] - FrameTimestamps[OutOlderFrame];
+	OutAlpha = Span > 0.0 ? float((Timestamp - FrameTimestamps[OutOlderFrame]) / Span) : 1.f;
+	return true;
+}
+
+FTransform ULagCompensationSubsystem::InterpolateTransform(int32 OlderIndex, int32 NewerIndex, float Alpha, const TArray<FVector3f>& Locations, const TArray<FQuat4f>& Rotations) const
+{
+	const FVector3f Location = FMath::Lerp(Locations[OlderIndex], Locations[NewerIndex], Alpha);
+	const FQuat4f Rotation = FQuat4f::Slerp(Rotations[OlderIndex], Rotations[NewerIndex], Alpha);
+	return FTransform(FQuat(Rotation), FVector(Location));
+}
+
+bool ULagCompensationSubsystem::GetCapsuleTransformAt(const AMultiplayerCourseCharacter* Character, double Timestamp, FTransform& OutTransform) const
+{
+	const int32* Slot = CharacterSlots.Find(Character);
+	int32 OlderFrame, NewerFrame;
+	float Alpha;
+	if (!Slot || !FindFrames(*Slot, Timestamp, OlderFrame, NewerFrame, Alpha)) {
+		return false;
+	}
+
+	OutTransform = InterpolateTransform(GetFrameIndex(OlderFrame, *Slot), GetFrameIndex(NewerFrame, *Slot), Alpha, CapsuleLocations, CapsuleRotations);
+	return true;
+}
+
+bool ULagCompensationSubsystem::GetHitboxTransformAt(const AMultiplayerCourseCharacter* Character, int32 HitboxIndex, double Timestamp, FTransform& OutTransform) const
+{
+	const int32* Slot = CharacterSlots.Find(Character);
+	int32 OlderFrame, NewerFrame;
+	float Alpha;
+	if (!Slot || !Hitboxes.IsValidIndex(HitboxIndex) || HitboxIndex >= NumHitboxes || !FindFrames(*Slot, Timestamp, OlderFrame, NewerFrame, Alpha)) {
+		return false;
+	}
+
+	OutTransform = InterpolateTransform(GetHitboxIndex(OlderFrame, *Slot, HitboxIndex), GetHitboxIndex(NewerFrame, *Slot, HitboxIndex), Alpha, HitboxLocations, HitboxRotations);
+	return true;
+}
+
+double ULagCompensationSubsystem::GetOldestTimestamp() const
+{
+	return NumRecordedFrames > 0 ? FrameTimestamps[GetRingFrame(0)] : 0.0;
+}
+
+bool ULagCompensationSubsystem::RewindTo(double Timestamp, const AActor* IgnoreActor)
+{
+	if (bRewound) {
+		UE_LOG(LogLagCompensation, Warning, TEXT("Already rewound in ULagCompensationSubsystem::RewindTo, restore first"));
+		return false;
+	}
+	bRewound = true;
+
+	for (const int32 Slot : ActiveSlots) {
+		const AMultiplayerCourseCharacter* Character = SlotCharacters[Slot].Get();
+		int32 OlderFrame, NewerFrame;
+		float Alpha;
+		if (!Character || Character == IgnoreActor || !FindFrames(Slot, Timestamp, OlderFrame, NewerFrame, Alpha)) {
+			continue;
+		}
+
+		const int32 OlderIndex = GetFrameIndex(OlderFrame, Slot);
+		const int32 NewerIndex = GetFrameIndex(NewerFrame, Slot);
+		RewoundCapsules[Slot] = InterpolateTransform(OlderIndex, NewerIndex, Alpha, CapsuleLocations, CapsuleRotations);
+		RewoundCapsuleHalfHeights[Slot] = FMath::Lerp(CapsuleHalfHeights[OlderIndex], CapsuleHalfHeights[NewerIndex], Alpha);
+		for (int32 Hitbox = 0; Hitbox < NumHitboxes; ++Hitbox) {
+			const FVector3f Location = FMath::Lerp(HitboxLocations[GetHitboxIndex(OlderFrame, Slot, Hitbox)], HitboxLocations[GetHitboxIndex(NewerFrame, Slot, Hitbox)], Alpha);
+			RewoundHitboxLocations[Slot * NumHitboxes + Hitbox] = FVector(Location);
+		}
+		RewoundSlots.Add(Slot);
+	}
+	return true;
+}
+
+void ULagCompensationSubsystem::RestoreRewind()
+{
+	bRewound = false;
+	RewoundSlots.Reset();
+}
+
+bool ULagCompensationSubsystem::IntersectSegmentSphere(const FVector& Start, const FVector& Direction, double Length, const FVector& Center, double Radius, double& OutDistance)
+{
+	const FVector CenterToStart = Start - Center;
+	const double Projection = CenterToStart | Direction;
+	const double StartDistanceSquared = CenterToStart.SizeSquared() - Radius * Radius;
+
+	// Starts outside and points away
+	if (StartDistanceSquared > 0.0 && Projection > 0.0) {
+		return false;
+	}
+	const double Discriminant = Projection * Projection - StartDistanceSquared;
+	if (Discriminant < 0.0) {
+		return false;
+	}
+	OutDistance = FMath::Max(-Projection - FMath::Sqrt(Discriminant), 0.0);
+	return OutDistance <= Length;
+}
+
+bool ULagCompensationSubsystem::LineTraceRewound(const FVector& Start, const FVector& End, FLagCompensationHit& OutHit) const
+{
+	if (!bRewound) {
+		UE_LOG(LogLagCompensation, Warning, TEXT("Not rewound in ULagCompensationSubsystem::LineTraceRewound, call RewindTo first"));
+		return false;
+	}
+
+	double Length;
+	FVector Direction;
+	(End - Start).ToDirectionAndLength(Direction, Length);
+
+	double ClosestDistance = TNumericLimits<double>::Max();
+	for (const int32 Slot : RewoundSlots) {
+		// Capsule first, it rules out everybody the line doesn't come near
+		const FTransform& Capsule = RewoundCapsules[Slot];
+		const float Radius = SlotCapsuleRadii[Slot];
+		const FVector HalfSegment = Capsule.GetRotation().GetUpVector() * FMath::Max(RewoundCapsuleHalfHeights[Slot] - Radius, 0.f);
+		FVector OnLine, OnCapsule;
+		FMath::SegmentDistToSegmentSafe(Start, End, Capsule.GetLocation() - HalfSegment, Capsule.GetLocation() + HalfSegment, OnLine, OnCapsule);
+		if (FVector::DistSquared(OnLine, OnCapsule) > FMath::Square(Radius)) {
+			continue;
+		}
+
+		if (NumHitboxes == 0) {
+			const double Distance = FVector::Dist(Start, OnLine);
+			if (Distance < ClosestDistance) {
+				ClosestDistance = Distance;
+				OutHit = FLagCompensationHit{ SlotCharacters[Slot], INDEX_NONE, OnLine, Distance };
+			}
+			continue;
+		}
+
+		for (int32 Hitbox = 0; Hitbox < NumHitboxes; ++Hitbox) {
+			double Distance;
+			if (IntersectSegmentSphere(Start, Direction, Length, RewoundHitboxLocations[Slot * NumHitboxes + Hitbox], Hitboxes[Hitbox].Radius, Distance) && Distance < ClosestDistance) {
+				ClosestDistance = Distance;
+				OutHit = FLagCompensationHit{ SlotCharacters[Slot], Hitbox, Start + Direction * Distance, Distance };
+			}
+		}
+	}
+	return ClosestDistance < TNumericLimits<double>::Max();
+}
+
+FLagCompensationRewindScope::FLagCompensationRewindScope(ULagCompensationSubsystem* InSubsystem, double Timestamp, const AActor* IgnoreActor)
+	: Subsystem(InSubsystem)
+{
+	bRewound = Subsystem && Subsystem->RewindTo(Timestamp, IgnoreActor);
+}
+
+FLagCompensationRewindScope::~FLagCompensationRewindScope()
+{
+	if (bRewound && Subsystem) {
+		Subsystem->RestoreRewind();
+	}
+}
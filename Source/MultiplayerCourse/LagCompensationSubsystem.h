@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LagCompensationSubsystem.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogLagCompensation, Log, All);
+
+class AMultiplayerCourseCharacter;
+
+// Sphere around a skeletal mesh bone that rewound traces test against
+USTRUCT()
+struct FLagCompensationHitbox
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FName Bone;
+
+	UPROPERTY()
+	float Radius{ 15.f };
+};
+
+// Closest hit of a trace against the rewound poses
+struct FLagCompensationHit
+{
+	TWeakObjectPtr<AMultiplayerCourseCharacter> Character;
+	// Index into GetHitboxes(), INDEX_NONE when there are no hitboxes and the capsule was hit
+	int32 HitboxIndex{ INDEX_NONE };
+	FVector Location{ ForceInit };
+	double Distance{ 0.0 };
+};
+
+/**
+ * Server side history of character poses for hit validation. Every registered character's capsule and
+ * hitbox transforms are recorded into fixed size ring buffers at RecordRate, so a hit can be checked
+ * against where targets were when the shooter fired instead of where they are now.
+ *
+ * Storage is structure of arrays, one contiguous array per field laid out frame by frame, allocated on the
+ * first registration. Recording, rewinding and tracing never allocate, and never move the characters.
+ */
+UCLASS(Config = Game)
+class MULTIPLAYERCOURSE_API ULagCompensationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void RegisterCharacter(AMultiplayerCourseCharacter* Character);
+	void UnregisterCharacter(AMultiplayerCourseCharacter* Character);
+
+	// Capsule transform of the character at Timestamp (server world time), interpolated between recorded frames.
+	// Timestamps outside the history are clamped to the oldest/newest frame
+	bool GetCapsuleTransformAt(const AMultiplayerCourseCharacter* Character, double Timestamp, FTransform& OutTransform) const;
+
+	// Same for one of the Hitboxes, HitboxIndex indexes into Hitboxes
+	bool GetHitboxTransformAt(const AMultiplayerCourseCharacter* Character, int32 HitboxIndex, double Timestamp, FTransform& OutTransform) const;
+
+	const TArray<FLagCompensationHitbox>& GetHitboxes() const { return Hitboxes; }
+
+	// Interpolates the pose of every registered character except IgnoreActor (usually the shooter) at Timestamp
+	// for LineTraceRewound. Nothing in the world moves. Must be paired with RestoreRewind(),
+	// FLagCompensationRewindScope does that for you
+	bool RewindTo(double Timestamp, const AActor* IgnoreActor = nullptr);
+	void RestoreRewind();
+
+	// Traces Start to End against the rewound capsules, and the hitboxes of every capsule it passes through.
+	// Returns the closest hit, only valid while rewound
+	bool LineTraceRewound(const FVector& Start, const FVector& End, FLagCompensationHit& OutHit) const;
+
+	bool IsRewound() const { return bRewound; }
+	double GetOldestTimestamp() const;
+
+private:
+
+	// History is only needed where characters register (the server), so it is allocated on the first registration
+	void AllocateHistory();
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void RecordFrame(double Timestamp);
+
+	// Finds the recorded frames around Timestamp that are valid for Slot. Returns false if the slot has no history yet
+	bool FindFrames(int32 Slot, double Timestamp, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const;
+	FTransform InterpolateTransform(int32 OlderIndex, int32 NewerIndex, float Alpha, const TArray<FVector3f>& Locations, const TArray<FQuat4f>& Rotations) const;
+	// Distance along the segment where it enters the sphere, 0 when Start is already inside
+	static bool IntersectSegmentSphere(const FVector& Start, const FVector& Direction, double Length, const FVector& Center, double Radius, double& OutDistance);
+
+	int32 GetRingFrame(int32 ChronologicalIndex) const { return (NextFrame - NumRecordedFrames + ChronologicalIndex + HistoryFrames) % HistoryFrames; }
+	int32 GetFrameIndex(int32 Frame, int32 Slot) const { return Frame * MaxCharacters + Slot; }
+	int32 GetHitboxIndex(int32 Frame, int32 Slot, int32 Hitbox) const { return GetFrameIndex(Frame, Slot) * NumHitboxes + Hitbox; }
+
+	FDelegateHandle PostActorTickHandle;
+
+	// Ring of recorded frames, HistoryFrames long. FrameSerials lets a reused slot ignore frames of its previous owner
+	TArray<double> FrameTimestamps;
+	TArray<uint64> FrameSerials;
+	int32 NextFrame{ 0 };
+	int32 NumRecordedFrames{ 0 };
+	uint64 NextFrameSerial{ 1 };
+	double LastRecordTime{ -1.0 };
+
+	// Per frame and slot, indexed by GetFrameIndex / GetHitboxIndex
+	TArray<FVector3f> CapsuleLocations;
+	TArray<FQuat4f> CapsuleRotations;
+	// Crouching shrinks the capsule, so its size is part of the pose
+	TArray<float> CapsuleHalfHeights;
+	TArray<FVector3f> HitboxLocations;
+	TArray<FQuat4f> HitboxRotations;
+
+	// Per slot
+	TArray<TWeakObjectPtr<AMultiplayerCourseCharacter>> SlotCharacters;
+	TArray<uint64> SlotFirstSerials;
+	TArray<float> SlotCapsuleRadii;
+	TArray<FTransform> RewoundCapsules;
+	TArray<float> RewoundCapsuleHalfHeights;
+	// Per slot and hitbox, spheres don't need the rotation
+	TArray<FVector> RewoundHitboxLocations;
+	TArray<int32> RewoundSlots;
+	TArray<int32> FreeSlots;
+	TArray<int32> ActiveSlots;
+	TMap<TObjectKey<AMultiplayerCourseCharacter>, int32> CharacterSlots;
+
+	int32 HistoryFrames{ 0 };
+	int32 NumHitboxes{ 0 };
+	bool bRewound{ false };
+
+	// Characters that can be tracked at once, history memory is allocated for all of them up front
+	UPROPERTY(Config)
+	int32 MaxCharacters{ 128 };
+
+	UPROPERTY(Config)
+	float HistorySeconds{ 1.f };
+
+	// Frames recorded per second, the server tick is sampled no faster than this
+	UPROPERTY(Config)
+	float RecordRate{ 60.f };
+
+	// Skeletal mesh bones recorded as hitboxes, in the order GetHitboxTransformAt indexes them
+	UPROPERTY(Config)
+	TArray<FLagCompensationHitbox> Hitboxes;
+};
+
+/** Keeps the rewound poses for the lifetime of the scope and drops them when it ends */
+class MULTIPLAYERCOURSE_API FLagCompensationRewindScope
+{
+public:
+
+	FLagCompensationRewindScope(ULagCompensationSubsystem* InSubsystem, double Timestamp, const AActor* IgnoreActor = nullptr);
+	~FLagCompensationRewindScope();
+
+	FLagCompensationRewindScope(const FLagCompensationRewindScope&) = delete;
+	FLagCompensationRewindScope& operator=(const FLagCompensationRewindScope&) = delete;
+
+	bool IsRewound() const { return bRewound; }
+
+private:
+
+	ULagCompensationSubsystem* Subsystem{ nullptr };
+	bool bRewound{ false };
+};
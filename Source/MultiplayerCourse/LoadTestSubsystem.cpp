@@ -0,0 +1,257 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LoadTestSubsystem.h"
+#include "MultiplayerCourseCharacter.h"
+#include "MultiplayerCourseCharacterMovementComponent.h"
+#include "MultiplayerCoursePlayerController.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "Engine/GameInstance.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/FileManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+
+DEFINE_LOG_CATEGORY(LogLoadTest);
+
+bool ULoadTestSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return Super::ShouldCreateSubsystem(Outer) && FParse::Param(FCommandLine::Get(), TEXT("LoadTest"));
+}
+
+void ULoadTestSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Sessions are driven through the plugin, make sure it exists before the first tick
+	Collection.InitializeDependency<UMultiplayerSessionsSubsystem>();
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	if (!FParse::Value(CommandLine, TEXT("LoadTestCsv="), CsvDirectory)) {
+		CsvDirectory = FPaths::ProjectSavedDir() / TEXT("LoadTest");
+	}
+	FParse::Value(CommandLine, TEXT("LoadTestDuration="), Duration);
+	FParse::Value(CommandLine, TEXT("LoadTestSampleInterval="), SampleInterval);
+	FParse::Value(CommandLine, TEXT("LoadTestClientId="), ClientId);
+	SampleInterval = FMath::Max(SampleInterval, 0.1);
+	IFileManager::Get().MakeDirectory(*CsvDirectory, true);
+
+	StartTime = FPlatformTime::Seconds();
+	NextSampleTime = SampleInterval;
+	MovementStream.Initialize(ClientId + 1);
+
+	TickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ULoadTestSubsystem::Tick));
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &ULoadTestSubsystem::OnPostLoadMap);
+
+	UE_LOG(LogLoadTest, Display, TEXT("Load test running as %s for %.0fs, writing CSV to %s"), IsRunningDedicatedServer() ? TEXT("server") : *FString::Printf(TEXT("client %d"), ClientId), Duration, *CsvDirectory);
+}
+
+void ULoadTestSubsystem::Deinitialize()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+
+	if (UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetGameInstance()->GetSubsystem<UMultiplayerSessionsSubsystem>()) {
+		MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.RemoveAll(this);
+		MultiplayerSessionsSubsystem->MultiplayerOnJoinTravelComplete.RemoveAll(this);
+	}
+
+	Super::Deinitialize();
+}
+
+bool ULoadTestSubsystem::Tick(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds() - StartTime;
+	if (Now >= Duration) {
+		FinishLoadTest();
+		return false;
+	}
+
+	if (IsRunningDedicatedServer()) {
+		TickServer(DeltaTime);
+	}
+	else {
+		TickClient(DeltaTime);
+	}
+	return true;
+}
+
+void ULoadTestSubsystem::TickServer(float DeltaTime)
+{
+	// DeltaTime includes the wait for the tick rate, GGameThreadTime is the previous frame's game thread work alone
+	const double FrameTimeMs = DeltaTime * 1000.0;
+	const double GameThreadTimeMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	FrameTimeSum += FrameTimeMs;
+	FrameTimeMax = FMath::Max(FrameTimeMax, FrameTimeMs);
+	GameThreadTimeSum += GameThreadTimeMs;
+	GameThreadTimeMax = FMath::Max(GameThreadTimeMax, GameThreadTimeMs);
+	++FrameCount;
+
+	const double Now = FPlatformTime::Seconds() - StartTime;
+	if (Now >= NextSampleTime) {
+		WriteServerSample(Now);
+		NextSampleTime += SampleInterval;
+	}
+}
+
+void ULoadTestSubsystem::WriteServerSample(double Now)
+{
+	const UWorld* World = GetGameInstance()->GetWorld();
+	const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	const int32 NumClients = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+
+	ServerFrameRows += FString::Printf(TEXT("%.2f,%.3f,%.3f,%.3f,%.3f,%d,%d\n"), Now, FrameCount > 0 ? FrameTimeSum / FrameCount : 0.0, FrameTimeMax,
+		FrameCount > 0 ? GameThreadTimeSum / FrameCount : 0.0, GameThreadTimeMax, FrameCount, NumClients);
+
+	if (NetDriver) {
+		for (int32 Index = 0; Index < NetDriver->ClientConnections.Num(); ++Index) {
+			const UNetConnection* Connection = NetDriver->ClientConnections[Index];
+			if (!Connection) {
+				continue;
+			}
+			const APlayerState* PlayerState = Connection->PlayerController ? Connection->PlayerController->PlayerState.Get() : nullptr;
+			ServerClientRows += FString::Printf(TEXT("%.2f,%d,%s,%d,%d,%.1f\n"), Now, Index, *Connection->LowLevelGetRemoteAddress(true),
+				Connection->InBytesPerSecond, Connection->OutBytesPerSecond, PlayerState ? PlayerState->GetPingInMilliseconds() : -1.f);
+		}
+	}
+
+	FrameTimeSum = 0.0;
+	FrameTimeMax = 0.0;
+	GameThreadTimeSum = 0.0;
+	GameThreadTimeMax = 0.0;
+	FrameCount = 0;
+
+	// Flushed every sample so a crash under load still leaves the numbers leading up to it
+	AppendCsv(TEXT("server_frames.csv"), TEXT("time_s,frame_ms_avg,frame_ms_max,game_thread_ms_avg,game_thread_ms_max,frames,clients"), ServerFrameRows);
+	AppendCsv(TEXT("server_clients.csv"), TEXT("time_s,connection,address,in_bytes_per_s,out_bytes_per_s,ping_ms"), ServerClientRows);
+	ServerFrameRows.Reset();
+	ServerClientRows.Reset();
+}
+
+void ULoadTestSubsystem::TickClient(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds() - StartTime;
+	if (!bJoinStarted && JoinCompleteTime < 0.0 && Now >= NextJoinAttemptTime) {
+		StartJoin();
+	}
+	if (ConnectedTime >= 0.0) {
+		DriveCharacter(DeltaTime);
+	}
+}
+
+void ULoadTestSubsystem::StartJoin()
+{
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetGameInstance()->GetSubsystem<UMultiplayerSessionsSubsystem>();
+	if (!MultiplayerSessionsSubsystem) {
+		return;
+	}
+
+	if (!MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.IsBoundToObject(this)) {
+		MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.AddUObject(this, &ULoadTestSubsystem::OnJoinSessionComplete);
+		MultiplayerSessionsSubsystem->MultiplayerOnJoinTravelComplete.AddUObject(this, &ULoadTestSubsystem::OnJoinTravelComplete);
+	}
+
+	bJoinStarted = true;
+	++JoinAttempts;
+	JoinStartTime = FPlatformTime::Seconds() - StartTime;
+	// The plugin resolves the connect string, preloads the map and travels, same path as a player joining from the menu.
+	// The load test server is dedicated, it isn't in the lobby list quick join searches by default
+	MultiplayerSessionsSubsystem->QuickJoinBestSession(TEXT("Default"), 50, true, EMultiplayerSessionHostType::DedicatedServer);
+}
+
+void ULoadTestSubsystem::OnJoinSessionComplete(EOnJoinSessionCompleteResult::Type Result)
+{
+	const double Now = FPlatformTime::Seconds() - StartTime;
+	bJoinStarted = false;
+
+	// Usually the server isn't advertising yet, try again shortly
+	if (Result != EOnJoinSessionCompleteResult::Success) {
+		NextJoinAttemptTime = Now + 2.0;
+		return;
+	}
+	JoinCompleteTime = Now;
+}
+
+void ULoadTestSubsystem::OnJoinTravelComplete(bool bWasSuccessful)
+{
+	// A failed join is retried from OnJoinSessionComplete, only a failure after joining ends the client
+	if (!bWasSuccessful && JoinCompleteTime >= 0.0) {
+		WriteClientResult(TEXT("travel_failed"));
+	}
+}
+
+void ULoadTestSubsystem::OnPostLoadMap(UWorld* LoadedWorld)
+{
+	if (!LoadedWorld || LoadedWorld->GetNetMode() != NM_Client || JoinCompleteTime < 0.0 || ConnectedTime >= 0.0) {
+		return;
+	}
+	ConnectedTime = FPlatformTime::Seconds() - StartTime;
+	WriteClientResult(TEXT("ok"));
+}
+
+void ULoadTestSubsystem::DriveCharacter(float DeltaTime)
+{
+	AMultiplayerCoursePlayerController* PlayerController = Cast<AMultiplayerCoursePlayerController>(GetGameInstance()->GetFirstLocalPlayerController());
+	AMultiplayerCourseCharacter* Character = PlayerController ? PlayerController->GetPawn<AMultiplayerCourseCharacter>() : nullptr;
+	if (!Character) {
+		return;
+	}
+
+	// Random walk: new heading every few seconds, sometimes sprinting, sometimes jumping
+	NextMovementChange -= DeltaTime;
+	if (NextMovementChange <= 0.f) {
+		MoveHeading = MovementStream.FRandRange(0.f, 360.f);
+		bSprinting = MovementStream.FRand() < 0.3f;
+		NextMovementChange = MovementStream.FRandRange(1.f, 4.f);
+		if (MovementStream.FRand() < 0.2f) {
+			Character->Jump();
+		}
+	}
+
+	PlayerController->NotifyPawnInput();
+	Character->AddMovementInput(FRotator(0.f, MoveHeading, 0.f).Vector(), 1.f);
+	if (UMultiplayerCourseCharacterMovementComponent* Movement = Character->GetMultiplayerCourseMovement()) {
+		Movement->SetWantsToSprint(bSprinting);
+	}
+}
+
+void ULoadTestSubsystem::WriteClientResult(const TCHAR* Result)
+{
+	if (bResultWritten) {
+		return;
+	}
+	bResultWritten = true;
+
+	auto ToMs = [](double From, double To) { return From >= 0.0 && To >= 0.0 ? (To - From) * 1000.0 : -1.0; };
+	const FString Row = FString::Printf(TEXT("%d,%s,%d,%.1f,%.1f,%.1f\n"), ClientId, Result, JoinAttempts,
+		ToMs(JoinStartTime, JoinCompleteTime), ToMs(JoinCompleteTime, ConnectedTime), ToMs(JoinStartTime, ConnectedTime));
+	AppendCsv(FString::Printf(TEXT("client_%d.csv"), ClientId), TEXT("client_id,result,join_attempts,join_ms,connect_ms,total_ms"), Row);
+}
+
+void ULoadTestSubsystem::AppendCsv(const FString& FileName, const FString& Header, const FString& Rows) const
+{
+	const FString FilePath = CsvDirectory / FileName;
+	if (!IFileManager::Get().FileExists(*FilePath)) {
+		FFileHelper::SaveStringToFile(Header + TEXT("\n"), *FilePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+	}
+	if (!Rows.IsEmpty()) {
+		FFileHelper::SaveStringToFile(Rows, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+	}
+}
+
+void ULoadTestSubsystem::FinishLoadTest()
+{
+	if (IsRunningDedicatedServer()) {
+		WriteServerSample(FPlatformTime::Seconds() - StartTime);
+	}
+	else {
+		WriteClientResult(JoinCompleteTime < 0.0 ? TEXT("join_failed") : TEXT("connect_failed"));
+	}
+
+	UE_LOG(LogLoadTest, Display, TEXT("Load test finished, exiting"));
+	FPlatformMisc::RequestExit(false);
+}
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "LoadTestSubsystem.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogLoadTest, Log, All);
+
+/**
+ * Drives a headless instance during a load test, only created when the process runs with -LoadTest.
+ * Scripts/LoadTest/run_load_test.sh starts one dedicated server and N clients against the Null online subsystem.
+ *
+ * Server: samples frame time (tick interval) and game thread time (work done on the game thread) and per connection
+ * traffic into server_frames.csv and server_clients.csv. A server that idles between ticks has a long frame time but
+ * a short game thread time, the game thread time is the one that shows its load.
+ * Client: quick joins the first session it finds, travels to it, then walks the character around on a script,
+ * writing find/join/connect latency to client_<id>.csv.
+ *
+ * Command line: -LoadTestCsv=<dir> (default Saved/LoadTest), -LoadTestDuration=<s> (default 120, exits after),
+ * -LoadTestClientId=<n>, -LoadTestSampleInterval=<s> (default 1)
+ */
+UCLASS()
+class MULTIPLAYERCOURSE_API ULoadTestSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+private:
+
+	bool Tick(float DeltaTime);
+	void TickServer(float DeltaTime);
+	void TickClient(float DeltaTime);
+
+	void StartJoin();
+	void OnJoinSessionComplete(EOnJoinSessionCompleteResult::Type Result);
+	void OnJoinTravelComplete(bool bWasSuccessful);
+	void OnPostLoadMap(UWorld* LoadedWorld);
+	void DriveCharacter(float DeltaTime);
+
+	void WriteServerSample(double Now);
+	void WriteClientResult(const TCHAR* Result);
+	void AppendCsv(const FString& FileName, const FString& Header, const FString& Rows) const;
+	void FinishLoadTest();
+
+	FTSTicker::FDelegateHandle TickHandle;
+	FDelegateHandle PostLoadMapHandle;
+
+	FString CsvDirectory;
+	double Duration{ 120.0 };
+	double SampleInterval{ 1.0 };
+	int32 ClientId{ 0 };
+	double StartTime{ 0.0 };
+
+	// Server sampling, accumulated between rows
+	double NextSampleTime{ 0.0 };
+	double FrameTimeSum{ 0.0 };
+	double FrameTimeMax{ 0.0 };
+	double GameThreadTimeSum{ 0.0 };
+	double GameThreadTimeMax{ 0.0 };
+	int32 FrameCount{ 0 };
+	FString ServerFrameRows;
+	FString ServerClientRows;
+
+	// Client timings, seconds since start, negative until reached
+	double JoinStartTime{ -1.0 };
+	double JoinCompleteTime{ -1.0 };
+	double ConnectedTime{ -1.0 };
+	double NextJoinAttemptTime{ 2.0 };
+	int32 JoinAttempts{ 0 };
+	bool bJoinStarted{ false };
+	bool bResultWritten{ false };
+
+	// Scripted movement
+	FRandomStream MovementStream;
+	float MoveHeading{ 0.f };
+	float NextMovementChange{ 0.f };
+	bool bSprinting{ false };
+};
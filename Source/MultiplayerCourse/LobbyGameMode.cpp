@@ -2,4 +2,145 @@
 
 
 #include "LobbyGameMode.h"
+#include "LobbyPlayerState.h"
+#include "MultiplayerCoursePlayerController.h"
+#include "Engine/GameInstance.h"
+#include "GameFramework/GameSession.h"
+#include "GameFramework/PlayerController.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "TimerManager.h"
+#include "UObject/ConstructorHelpers.h"
 
+DEFINE_LOG_CATEGORY(LogLobby);
+
+ALobbyGameMode::ALobbyGameMode()
+{
+	// set default pawn class to our Blueprinted character
+	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPerson/Blueprints/BP_ThirdPersonCharacter"));
+	if (PlayerPawnBPClass.Class != NULL)
+	{
+		DefaultPawnClass = PlayerPawnBPClass.Class;
+	}
+
+	PlayerStateClass = ALobbyPlayerState::StaticClass();
+	PlayerControllerClass = AMultiplayerCoursePlayerController::StaticClass();
+
+	// Keeps every client connected through the move to the match map, the transition map is set in DefaultEngine.ini
+	bUseSeamlessTravel = true;
+}
+
+void ALobbyGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	//Listen hosts create their session from the menu, headless servers have nobody to do it for them
+	if (GetNetMode() == NM_DedicatedServer) {
+		UGameInstance* GameInstance = GetGameInstance();
+		UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+		if (MultiplayerSessionsSubsystem && MultiplayerSessionsSubsystem->GetSessionState() == EMultiplayerSessionState::Idle) {
+			const int32 MaxPlayers = GameSession ? GameSession->MaxPlayers : 0;
+			MultiplayerSessionsSubsystem->CreateDedicatedSession(MaxPlayers, DedicatedMatchType);
+		}
+	}
+}
+
+void ALobbyGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	Super::PostLogin(NewPlayer);
+
+	if (NewPlayer) {
+		LobbyPlayers.AddUnique(NewPlayer);
+	}
+	EvaluateTravelConditions();
+}
+
+void ALobbyGameMode::Logout(AController* Exiting)
+{
+	LobbyPlayers.Remove(Cast<APlayerController>(Exiting));
+
+	Super::Logout(Exiting);
+
+	EvaluateTravelConditions();
+}
+
+void ALobbyGameMode::OnPlayerReadyChanged(ALobbyPlayerState* PlayerState)
+{
+	EvaluateTravelConditions();
+}
+
+bool ALobbyGameMode::CanTravelToMatch() const
+{
+	const int32 NumPlayers = LobbyPlayers.Num();
+	if (NumPlayers == 0 || NumPlayers < MinPlayersToTravel) {
+		return false;
+	}
+	if (TravelWhenPlayerCountReached > 0 && NumPlayers >= TravelWhenPlayerCountReached) {
+		return true;
+	}
+	// Without a ready-check the player count is the only gate, the minimum unless a fill target is set
+	if (!bRequireAllPlayersReady) {
+		return TravelWhenPlayerCountReached <= 0;
+	}
+
+	for (const APlayerController* PlayerController : LobbyPlayers) {
+		const ALobbyPlayerState* LobbyPlayerState = PlayerController ? PlayerController->GetPlayerState<ALobbyPlayerState>() : nullptr;
+		if (!LobbyPlayerState || !LobbyPlayerState->IsReady()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ALobbyGameMode::EvaluateTravelConditions()
+{
+	if (bTravelInProgress) {
+		return;
+	}
+
+	FTimerManager& TimerManager = GetWorldTimerManager();
+	if (!CanTravelToMatch()) {
+		if (TimerManager.IsTimerActive(TravelCountdownTimerHandle)) {
+			UE_LOG(LogLobby, Log, TEXT("Lobby travel countdown cancelled"));
+			TimerManager.ClearTimer(TravelCountdownTimerHandle);
+		}
+		return;
+	}
+
+	// Already counting down, players that join now travel along with the rest
+	if (TimerManager.IsTimerActive(TravelCountdownTimerHandle)) {
+		return;
+	}
+
+	if (TravelCountdown > 0.f) {
+		TimerManager.SetTimer(TravelCountdownTimerHandle, this, &ALobbyGameMode::TravelToMatch, TravelCountdown, false);
+	}
+	else {
+		TravelToMatch();
+	}
+}
+
+void ALobbyGameMode::TravelToMatch()
+{
+	// Somebody may have left or unreadied since the countdown started
+	if (bTravelInProgress || !CanTravelToMatch()) {
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	if (!World) {
+		return;
+	}
+
+	UGameInstance* GameInstance = GetGameInstance();
+	if (UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr) {
+		MultiplayerSessionsSubsystem->StartSession();
+	}
+
+	// One seamless travel for the whole lobby, clients follow the server without reconnecting. Only a listen host
+	// has to keep listening, a dedicated server does on its own
+	const FString TravelURL = GetNetMode() == NM_ListenServer ? MatchMapPath + TEXT("?listen") : MatchMapPath;
+	bTravelInProgress = World->ServerTravel(TravelURL);
+	if (!bTravelInProgress) {
+		UE_LOG(LogLobby, Warning, TEXT("ServerTravel to %s failed in ALobbyGameMode::TravelToMatch"), *MatchMapPath);
+	}
+}
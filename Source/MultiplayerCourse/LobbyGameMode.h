@@ -6,12 +6,69 @@
 #include "GameFramework/GameModeBase.h"
 #include "LobbyGameMode.generated.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogLobby, Log, All);
+
+class ALobbyPlayerState;
+
 /**
- * 
+ * Collects players in the lobby and moves all of them to the match map with one seamless travel
+ * once the ready-check passes or the lobby fills up. The Lobby map gets it through GameModeMapPrefixes
+ * in DefaultEngine.ini, ?game=Lobby picks it for any other map
  */
-UCLASS()
+UCLASS(Config = Game)
 class MULTIPLAYERCOURSE_API ALobbyGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
-	
+
+public:
+
+	ALobbyGameMode();
+
+	virtual void PostLogin(APlayerController* NewPlayer) override;
+	virtual void Logout(AController* Exiting) override;
+
+	void OnPlayerReadyChanged(ALobbyPlayerState* PlayerState);
+
+	int32 GetNumLobbyPlayers() const { return LobbyPlayers.Num(); }
+
+protected:
+
+	virtual void BeginPlay() override;
+
+private:
+
+	// Starts or cancels the travel countdown depending on the current lobby state
+	void EvaluateTravelConditions();
+	bool CanTravelToMatch() const;
+	void TravelToMatch();
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<APlayerController>> LobbyPlayers;
+
+	FTimerHandle TravelCountdownTimerHandle;
+	bool bTravelInProgress{ false };
+
+	// Match type advertised when a dedicated server registers its session
+	UPROPERTY(EditDefaultsOnly, Category = "Session")
+	FString DedicatedMatchType{ TEXT("Default") };
+
+	// Map the whole lobby travels to, without the ?listen option
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	FString MatchMapPath{ TEXT("/Game/Maps/BasicLevel") };
+
+	// Players needed before the lobby can leave, 0 lets a single player go
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	int32 MinPlayersToTravel{ 2 };
+
+	// Lobby leaves as soon as this many players are in, ready or not. 0 disables it
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	int32 TravelWhenPlayerCountReached{ 0 };
+
+	// Every player has to be ready before the lobby leaves
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	bool bRequireAllPlayersReady{ true };
+
+	// Grace period between passing the check and travelling, lets late joiners make the same travel
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	float TravelCountdown{ 3.f };
 };
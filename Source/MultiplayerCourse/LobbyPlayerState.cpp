@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LobbyPlayerState.h"
+#include "LobbyGameMode.h"
+#include "MultiplayerCoursePushModel.h"
+
+void ALobbyPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_PUSH(ALobbyPlayerState, bReady);
+}
+
+void ALobbyPlayerState::ServerSetReady_Implementation(bool bNewReady)
+{
+	if (!SET_REPLICATED_PROPERTY(ALobbyPlayerState, bReady, bNewReady)) {
+		return;
+	}
+
+	// OnRep doesn't run on the server, a listen host's UI hears about it here
+	OnReadyChanged.Broadcast(this);
+
+	// Game mode only exists on the server, which is where this runs
+	if (ALobbyGameMode* LobbyGameMode = GetWorld() ? GetWorld()->GetAuthGameMode<ALobbyGameMode>() : nullptr) {
+		LobbyGameMode->OnPlayerReadyChanged(this);
+	}
+}
+
+void ALobbyPlayerState::OnRep_Ready()
+{
+	OnReadyChanged.Broadcast(this);
+}
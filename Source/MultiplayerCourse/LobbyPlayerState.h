@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerState.h"
+#include "LobbyPlayerState.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLobbyReadyChanged, ALobbyPlayerState*, PlayerState);
+
+/**
+ * Player state used in the lobby, carries the ready flag for the lobby ready-check
+ */
+UCLASS()
+class MULTIPLAYERCOURSE_API ALobbyPlayerState : public APlayerState
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Called by the owning client, AMultiplayerCoursePlayerController::ToggleReady or the lobby UI
+	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Lobby")
+	void ServerSetReady(bool bNewReady);
+
+	UFUNCTION(BlueprintPure, Category = "Lobby")
+	bool IsReady() const { return bReady; }
+
+	// Fires on every machine that sees the flag change, for the lobby UI to show who is ready
+	UPROPERTY(BlueprintAssignable, Category = "Lobby")
+	FOnLobbyReadyChanged OnReadyChanged;
+
+private:
+
+	UPROPERTY(ReplicatedUsing = OnRep_Ready)
+	bool bReady{ false };
+
+	UFUNCTION()
+	void OnRep_Ready();
+};
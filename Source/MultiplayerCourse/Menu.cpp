@@ -3,11 +3,13 @@
 #include "Menu.h"
 
 #include "Components/Button.h"
+#include "Components/ListView.h"
 #include "Components/VerticalBox.h"
 #include "Interfaces/OnlineSessionInterface.h"
 #include "MultiplayerSessionsSubsystem.h"
 #include "OnlineSessionSettings.h"
 #include "FriendWidgetItem.h"
+#include "FriendListItem.h"
 
 void UMenu::MenuSetup()
 {
@@ -35,6 +37,13 @@ void UMenu::MenuSetup()
 	if (MultiplayerSessionsSubsystem) {
 		MultiplayerSessionsSubsystem->MultiplayerOnCreateSessionComplete.AddUObject(this, &UMenu::OnCreateSession);
 		MultiplayerSessionsSubsystem->MultiplayerOnGetFriendsListComplete.AddUObject(this, &UMenu::OnGetFriendsList);
+		if (!PresenceSubscription.IsValid()) {
+			PresenceSubscription = MultiplayerSessionsSubsystem->SubscribeToFriendPresence(FMultiplayerOnFriendPresenceChanged::CreateUObject(this, &UMenu::OnFriendPresenceChanged));
+		}
+
+		for (const TSharedRef<FOnlineFriend>& Friend : MultiplayerSessionsSubsystem->GetCachedFriendsList()) {
+			AddFriendItem(Friend);
+		}
 	}
 }
 
@@ -62,6 +71,11 @@ void UMenu::NativeConstruct()
 
 void UMenu::NativeDestruct()
 {
+	if (PresenceSubscription.IsValid() && MultiplayerSessionsSubsystem) {
+		MultiplayerSessionsSubsystem->UnsubscribeFromFriendPresence(PresenceSubscription);
+	}
+	PresenceSubscription.Reset();
+
 	Super::NativeDestruct();
 }
 
@@ -83,21 +97,89 @@ void UMenu::OnCreateSession(bool bWasSuccessful)
 	}
 }
 
-void UMenu::OnGetFriendsList(bool bWasSuccessful, TArray<TSharedRef<FOnlineFriend>> FriendsList)
+void UMenu::OnGetFriendsList(bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta)
 {
 	if (!bWasSuccessful) {
 		UE_LOG(LogTemp, Warning, TEXT("bWasSuccessuful in OnGetFriendsList is false"));
 		return;
 	}
-	GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, FString(TEXT("Successfuly got friends")));
 
-	for (auto Friend : FriendsList) {
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Blue, FString(Friend->GetDisplayName()));
-		UFriendWidgetItem* FriendWidget = CreateWidget<UFriendWidgetItem>(this, FriendWidgetClass);
-		FriendWidget->FriendInfo = Friend;
-		FriendsListBox->AddChildToVerticalBox(FriendWidget);
-		FriendWidget->WidgetSetup();
+	for (const FUniqueNetIdRef& RemovedId : FriendsListDelta.Removed) {
+		UFriendListItem* FriendItem = nullptr;
+		if (FriendItems.RemoveAndCopyValue(RemovedId, FriendItem) && FriendItem) {
+			FriendsListView->RemoveItem(FriendItem);
+			FriendItem->FriendInfo.Reset();
+			FreeFriendItems.Add(FriendItem);
+		}
+		UFriendWidgetItem* FriendWidget = nullptr;
+		if (FriendWidgets.RemoveAndCopyValue(RemovedId, FriendWidget) && FriendWidget) {
+			FriendWidget->RemoveFromParent();
+		}
+	}
+
+	for (const TSharedRef<FOnlineFriend>& Friend : FriendsListDelta.Changed) {
+		if (UFriendListItem** FriendItem = FriendItems.Find(Friend->GetUserId())) {
+			(*FriendItem)->FriendInfo = Friend;
+		}
+
+		//Rows that are not materialized pick the new data up when they scroll into view
+		if (UFriendWidgetItem* FriendWidget = FindFriendWidget(Friend->GetUserId())) {
+			FriendWidget->FriendInfo = Friend;
+			FriendWidget->UpdateFriendInfo();
+		}
+	}
+
+	for (const TSharedRef<FOnlineFriend>& Friend : FriendsListDelta.Added) {
+		AddFriendItem(Friend);
+	}
+}
+
+void UMenu::OnFriendPresenceChanged(const TArray<FMultiplayerFriendPresenceChange>& Changes)
+{
+	//Rows that are not materialized read the new presence when they scroll into view
+	for (const FMultiplayerFriendPresenceChange& Change : Changes) {
+		if (UFriendWidgetItem* FriendWidget = FindFriendWidget(Change.FriendId)) {
+			FriendWidget->UpdateFriendInfo();
+		}
+	}
+}
+
+void UMenu::AddFriendItem(const TSharedRef<FOnlineFriend>& Friend)
+{
+	if (!FriendsListView) {
+		AddFriendWidget(Friend);
+		return;
+	}
+	if (FriendItems.Contains(Friend->GetUserId())) {
+		return;
+	}
+
+	UFriendListItem* FriendItem = FreeFriendItems.Num() > 0 ? FreeFriendItems.Pop(EAllowShrinking::No) : NewObject<UFriendListItem>(this);
+	FriendItem->FriendInfo = Friend;
+	FriendsListView->AddItem(FriendItem);
+	FriendItems.Add(Friend->GetUserId(), FriendItem);
+}
+
+void UMenu::AddFriendWidget(const TSharedRef<FOnlineFriend>& Friend)
+{
+	if (!FriendsListBox || !FriendWidgetClass || FriendWidgets.Contains(Friend->GetUserId())) {
+		return;
+	}
+
+	UFriendWidgetItem* FriendWidget = CreateWidget<UFriendWidgetItem>(this, FriendWidgetClass);
+	FriendWidget->FriendInfo = Friend;
+	FriendsListBox->AddChildToVerticalBox(FriendWidget);
+	FriendWidget->WidgetSetup();
+	FriendWidgets.Add(Friend->GetUserId(), FriendWidget);
+}
+
+UFriendWidgetItem* UMenu::FindFriendWidget(const FUniqueNetIdRef& FriendId) const
+{
+	if (UFriendWidgetItem* const* FriendWidget = FriendWidgets.Find(FriendId)) {
+		return *FriendWidget;
 	}
+	UFriendListItem* const* FriendItem = FriendItems.Find(FriendId);
+	return FriendItem && FriendsListView ? FriendsListView->GetEntryWidgetFromItem<UFriendWidgetItem>(*FriendItem) : nullptr;
 }
 
 void UMenu::HostButtonClicked()
@@ -9,12 +9,17 @@
 #include "OnlineSubsystem.h"
 #include "OnlineSubsystemUtils.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "MultiplayerSessionsSubsystem.h"
 
 #include "Menu.generated.h"
 
 class UButton;
+class UListView;
 class UVerticalBox;
+class UFriendWidgetItem;
 class UMultiplayerSessionsSubsystem;
+class UFriendListItem;
+struct FMultiplayerFriendsListDelta;
 /**
  * 
  */
@@ -36,7 +41,10 @@ protected:
 
 	void OnCreateSession(bool bWasSuccessful);
 
-	void OnGetFriendsList(bool bWasSuccessful, TArray<TSharedRef<FOnlineFriend>> FriendsList);
+	void OnGetFriendsList(bool bWasSuccessful, const FMultiplayerFriendsListDelta& FriendsListDelta);
+
+	// Refreshes the badges of the friends whose presence changed, only rows on screen are touched
+	void OnFriendPresenceChanged(const TArray<FMultiplayerFriendPresenceChange>& Changes);
 
 private:
 
@@ -46,17 +54,39 @@ private:
 	UPROPERTY(meta = (BindWidget))
 	UButton* ReloadFriendsListButton;
 
-	UPROPERTY(meta = (BindWidget))
+	// Virtualized list, its entry widget class (UFriendWidgetItem) is pooled and only created for visible rows.
+	// Menus without one fall back to FriendsListBox, which gets a FriendWidgetClass row per friend
+	UPROPERTY(meta = (BindWidgetOptional))
+	UListView* FriendsListView;
+
+	UPROPERTY(meta = (BindWidgetOptional))
 	UVerticalBox* FriendsListBox;
 
+	UPROPERTY(EditDefaultsOnly)
+	TSubclassOf<class UFriendWidgetItem> FriendWidgetClass;
+
 	UFUNCTION()
 	void HostButtonClicked();
 
 	UFUNCTION()
 	void ReloadFriendsListButtonClicked();
 
-	UPROPERTY(EditDefaultsOnly)
-	TSubclassOf<class UFriendWidgetItem> FriendWidgetClass;
+	void AddFriendItem(const TSharedRef<FOnlineFriend>& Friend);
+	void AddFriendWidget(const TSharedRef<FOnlineFriend>& Friend);
+	// Row currently showing the friend, null if it isn't materialized
+	UFriendWidgetItem* FindFriendWidget(const FUniqueNetIdRef& FriendId) const;
+
+	// Items currently in FriendsListView, so list updates only touch the friends that changed
+	TUniqueNetIdMap<UFriendListItem*> FriendItems;
+
+	// Rows currently shown in FriendsListBox, only used without FriendsListView
+	TUniqueNetIdMap<UFriendWidgetItem*> FriendWidgets;
+
+	FMultiplayerPresenceSubscriptionHandle PresenceSubscription;
+
+	// Items of removed friends, reused before allocating new ones
+	UPROPERTY(Transient)
+	TArray<UFriendListItem*> FreeFriendItems;
 
 	// The subsystem designed to handle all online session functionality
 	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem;
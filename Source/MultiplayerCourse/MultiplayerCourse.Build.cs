@@ -8,6 +8,12 @@ public class MultiplayerCourse : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "OnlineSubsystemSteam", "OnlineSubsystem", "MultiplayerSessions" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "OnlineSubsystemSteam", "OnlineSubsystem", "MultiplayerSessions", "ReplicationGraph", "NetCore" });
+
+		// GGameThreadTime for the load test's server samples
+		PrivateDependencyModuleNames.AddRange(new string[] { "RenderCore" });
+
+		// Adds IrisCore and sets UE_WITH_IRIS when the target has bUseIris
+		SetupIrisSupport(Target);
 	}
 }
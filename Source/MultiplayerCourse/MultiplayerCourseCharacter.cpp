@@ -10,13 +10,19 @@
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "InputActionValue.h"
+#include "CharacterNetUpdateComponent.h"
+#include "MultiplayerCourseCharacterMovementComponent.h"
+#include "MultiplayerCoursePlayerController.h"
+#include "LagCompensationSubsystem.h"
+#include "MultiplayerCoursePushModel.h"
 
 DEFINE_LOG_CATEGORY(LogTemplateCharacter);
 
 //////////////////////////////////////////////////////////////////////////
 // AMultiplayerCourseCharacter
 
-AMultiplayerCourseCharacter::AMultiplayerCourseCharacter()
+AMultiplayerCourseCharacter::AMultiplayerCourseCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UMultiplayerCourseCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -50,6 +56,16 @@ AMultiplayerCourseCharacter::AMultiplayerCourseCharacter()
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
 	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
 
+	// Quantization used by both the legacy FRepMovement serialization and its Iris serializer.
+	// Whole centimetres are plenty for proxies that get smoothed anyway
+	FRepMovement& RepMovement = GetReplicatedMovement_Mutable();
+	RepMovement.LocationQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	RepMovement.VelocityQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	RepMovement.RotationQuantizationLevel = ERotatorQuantization::ByteComponents;
+
+	// Server side replication policy (update frequency and idle dormancy)
+	NetUpdateComponent = CreateDefaultSubobject<UCharacterNetUpdateComponent>(TEXT("NetUpdateComponent"));
+
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
 }
@@ -58,6 +74,47 @@ void AMultiplayerCourseCharacter::BeginPlay()
 {
 	// Call the base class  
 	Super::BeginPlay();
+
+	// Record pose history on the server for lag compensated hit validation
+	if (HasAuthority())
+	{
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+	}
+}
+
+void AMultiplayerCourseCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// The owner predicts this state itself
+	DOREPLIFETIME_PUSH_CONDITION(AMultiplayerCourseCharacter, NetState, COND_SimulatedOnly);
+}
+
+void AMultiplayerCourseCharacter::SetNetState(const FMultiplayerCourseCharacterNetState& NewNetState)
+{
+	SET_REPLICATED_PROPERTY(AMultiplayerCourseCharacter, NetState, NewNetState);
+}
+
+void AMultiplayerCourseCharacter::OnRep_NetState()
+{
+	// Keeps proxy max speed in line with the server so smoothing doesn't fight the sprint
+	if (UMultiplayerCourseCharacterMovementComponent* Movement = GetMultiplayerCourseMovement())
+	{
+		Movement->SetWantsToSprint(NetState.bIsSprinting);
+	}
+}
+
+void AMultiplayerCourseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -86,6 +143,14 @@ void AMultiplayerCourseCharacter::SetupPlayerInputComponent(UInputComponent* Pla
 
 		// Looking
 		EnhancedInputComponent->BindAction(LookAction, ETriggerEvent::Triggered, this, &AMultiplayerCourseCharacter::Look);
+
+		// Sprinting
+		EnhancedInputComponent->BindAction(SprintAction, ETriggerEvent::Started, this, &AMultiplayerCourseCharacter::StartSprinting);
+		EnhancedInputComponent->BindAction(SprintAction, ETriggerEvent::Completed, this, &AMultiplayerCourseCharacter::StopSprinting);
+
+		// Crouching and sliding
+		EnhancedInputComponent->BindAction(CrouchAction, ETriggerEvent::Started, this, &AMultiplayerCourseCharacter::StartCrouching);
+		EnhancedInputComponent->BindAction(CrouchAction, ETriggerEvent::Completed, this, &AMultiplayerCourseCharacter::StopCrouching);
 	}
 	else
 	{
@@ -93,8 +158,61 @@ void AMultiplayerCourseCharacter::SetupPlayerInputComponent(UInputComponent* Pla
 	}
 }
 
+void AMultiplayerCourseCharacter::Jump()
+{
+	NotifyInput();
+
+	Super::Jump();
+}
+
+UMultiplayerCourseCharacterMovementComponent* AMultiplayerCourseCharacter::GetMultiplayerCourseMovement() const
+{
+	return Cast<UMultiplayerCourseCharacterMovementComponent>(GetCharacterMovement());
+}
+
+void AMultiplayerCourseCharacter::StartSprinting()
+{
+	NotifyInput();
+
+	// Only the input state is set here, the movement component predicts the sprint and sends it up with each move
+	if (UMultiplayerCourseCharacterMovementComponent* Movement = GetMultiplayerCourseMovement())
+	{
+		Movement->SetWantsToSprint(true);
+	}
+}
+
+void AMultiplayerCourseCharacter::StopSprinting()
+{
+	if (UMultiplayerCourseCharacterMovementComponent* Movement = GetMultiplayerCourseMovement())
+	{
+		Movement->SetWantsToSprint(false);
+	}
+}
+
+void AMultiplayerCourseCharacter::StartCrouching()
+{
+	NotifyInput();
+
+	Crouch();
+}
+
+void AMultiplayerCourseCharacter::StopCrouching()
+{
+	UnCrouch();
+}
+
+void AMultiplayerCourseCharacter::NotifyInput()
+{
+	if (AMultiplayerCoursePlayerController* PlayerController = GetController<AMultiplayerCoursePlayerController>())
+	{
+		PlayerController->NotifyPawnInput();
+	}
+}
+
 void AMultiplayerCourseCharacter::Move(const FInputActionValue& Value)
 {
+	NotifyInput();
+
 	// input is a Vector2D
 	FVector2D MovementVector = Value.Get<FVector2D>();
 
@@ -118,6 +236,8 @@ void AMultiplayerCourseCharacter::Move(const FInputActionValue& Value)
 
 void AMultiplayerCourseCharacter::Look(const FInputActionValue& Value)
 {
+	NotifyInput();
+
 	// input is a Vector2D
 	FVector2D LookAxisVector = Value.Get<FVector2D>();
 
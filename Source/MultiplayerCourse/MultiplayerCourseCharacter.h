@@ -5,12 +5,15 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Logging/LogMacros.h"
+#include "MultiplayerCourseCharacterNetState.h"
 #include "MultiplayerCourseCharacter.generated.h"
 
 class USpringArmComponent;
 class UCameraComponent;
 class UInputMappingContext;
 class UInputAction;
+class UCharacterNetUpdateComponent;
+class UMultiplayerCourseCharacterMovementComponent;
 struct FInputActionValue;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogTemplateCharacter, Log, All);
@@ -44,8 +47,33 @@ class AMultiplayerCourseCharacter : public ACharacter
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	UInputAction* LookAction;
 
+	/** Sprint Input Action */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
+	UInputAction* SprintAction;
+
+	/** Crouch Input Action, crouching while sprinting starts a slide */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
+	UInputAction* CrouchAction;
+
+	/** Scales replication by movement state and puts idle characters to sleep */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Network, meta = (AllowPrivateAccess = "true"))
+	UCharacterNetUpdateComponent* NetUpdateComponent;
+
+	/** Sprint and slide state for simulated proxies, written by the server's movement component */
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FMultiplayerCourseCharacterNetState NetState;
+
 public:
-	AMultiplayerCourseCharacter();
+	AMultiplayerCourseCharacter(const FObjectInitializer& ObjectInitializer);
+
+	virtual void Jump() override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Server only, called after each move */
+	void SetNetState(const FMultiplayerCourseCharacterNetState& NewNetState);
+
+	const FMultiplayerCourseCharacterNetState& GetNetState() const { return NetState; }
 	
 
 protected:
@@ -55,6 +83,20 @@ protected:
 
 	/** Called for looking input */
 	void Look(const FInputActionValue& Value);
+
+	/** Called for sprint input */
+	void StartSprinting();
+	void StopSprinting();
+
+	/** Called for crouch input */
+	void StartCrouching();
+	void StopCrouching();
+
+	UFUNCTION()
+	void OnRep_NetState();
+
+	/** Wakes the character on the server if it went net dormant while idle */
+	void NotifyInput();
 			
 
 protected:
@@ -64,10 +106,16 @@ protected:
 	// To add mapping context
 	virtual void BeginPlay();
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+	/** Returns the project movement component **/
+	UMultiplayerCourseCharacterMovementComponent* GetMultiplayerCourseMovement() const;
+	/** Returns NetUpdateComponent subobject **/
+	FORCEINLINE UCharacterNetUpdateComponent* GetNetUpdateComponent() const { return NetUpdateComponent; }
 };
 
@@ -0,0 +1,352 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerCourseCharacterMovementComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+#include "MultiplayerCourseCharacter.h"
+
+namespace MultiplayerCourseMovement
+{
+	// Acceleration steps either side of zero that fit the compact encoding, +-4096 cm/s^2 at the default quantum
+	constexpr uint32 MaxAccelerationSteps = 512;
+
+	template<typename ValueType>
+	void SerializeOptionalValue(const bool bIsSaving, FArchive& Ar, ValueType& Value, const ValueType& DefaultValue)
+	{
+		uint8 bIsDefault = bIsSaving ? (Value == DefaultValue) : 0;
+		Ar.SerializeBits(&bIsDefault, 1);
+		if (bIsDefault) {
+			Value = DefaultValue;
+		}
+		else {
+			Ar << Value;
+		}
+	}
+
+	void SerializeAccelerationStep(FArchive& Ar, double& Component)
+	{
+		uint32 Step = Ar.IsSaving() ? uint32(FMath::RoundToInt(Component / UMultiplayerCourseCharacterMovementComponent::AccelerationQuantum) + MaxAccelerationSteps) : 0;
+		Ar.SerializeInt(Step, MaxAccelerationSteps * 2);
+		if (Ar.IsLoading()) {
+			Component = (int32(Step) - int32(MaxAccelerationSteps)) * UMultiplayerCourseCharacterMovementComponent::AccelerationQuantum;
+		}
+	}
+
+	bool IsCompactComponent(double Component)
+	{
+		const double Steps = Component / UMultiplayerCourseCharacterMovementComponent::AccelerationQuantum;
+		return Steps == FMath::RoundToDouble(Steps) && FMath::Abs(Steps) < MaxAccelerationSteps;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FSavedMove_MultiplayerCourse
+
+void FSavedMove_MultiplayerCourse::Clear()
+{
+	Super::Clear();
+
+	bSavedWantsToSprint = false;
+}
+
+uint8 FSavedMove_MultiplayerCourse::GetCompressedFlags() const
+{
+	uint8 Result = Super::GetCompressedFlags();
+	if (bSavedWantsToSprint) {
+		Result |= FLAG_Custom_0;
+	}
+	return Result;
+}
+
+bool FSavedMove_MultiplayerCourse::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_MultiplayerCourse* NewMultiplayerCourseMove = static_cast<const FSavedMove_MultiplayerCourse*>(NewMove.Get());
+	if (bSavedWantsToSprint != NewMultiplayerCourseMove->bSavedWantsToSprint) {
+		return false;
+	}
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_MultiplayerCourse::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	// ReplicateMoveToServer copies this back onto the component, so the client simulates exactly what the server will decode.
+	// AccelMag and AccelNormal keep the unquantized input, the same way the engine's own rounding does
+	Acceleration = UMultiplayerCourseCharacterMovementComponent::QuantizeAcceleration(Acceleration);
+
+	if (const UMultiplayerCourseCharacterMovementComponent* Movement = Cast<UMultiplayerCourseCharacterMovementComponent>(C->GetCharacterMovement())) {
+		bSavedWantsToSprint = Movement->bWantsToSprint;
+	}
+}
+
+void FSavedMove_MultiplayerCourse::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+
+	if (UMultiplayerCourseCharacterMovementComponent* Movement = Cast<UMultiplayerCourseCharacterMovementComponent>(C->GetCharacterMovement())) {
+		Movement->bWantsToSprint = bSavedWantsToSprint;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FNetworkPredictionData_Client_MultiplayerCourse
+
+FNetworkPredictionData_Client_MultiplayerCourse::FNetworkPredictionData_Client_MultiplayerCourse(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_MultiplayerCourse::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_MultiplayerCourse());
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FMultiplayerCourseNetworkMoveData
+
+bool FMultiplayerCourseNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	using namespace MultiplayerCourseMovement;
+
+	// Same layout as the engine's move data apart from the acceleration
+	NetworkMoveType = MoveType;
+
+	bool bLocalSuccess = true;
+	const bool bIsSaving = Ar.IsSaving();
+
+	Ar << TimeStamp;
+	SerializeAcceleration(Ar, PackageMap, bLocalSuccess);
+	Location.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	ControlRotation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	SerializeOptionalValue<uint8>(bIsSaving, Ar, CompressedMoveFlags, 0);
+
+	// Base and ending movement mode are only used for error checking, so only the newest move carries them
+	if (MoveType == ENetworkMoveType::NewMove) {
+		SerializeOptionalValue<UPrimitiveComponent*>(bIsSaving, Ar, MovementBase, nullptr);
+		SerializeOptionalValue<FName>(bIsSaving, Ar, MovementBaseBoneName, NAME_None);
+		SerializeOptionalValue<uint8>(bIsSaving, Ar, MovementMode, MOVE_Walking);
+	}
+
+	return !Ar.IsError() && bLocalSuccess;
+}
+
+void FMultiplayerCourseNetworkMoveData::SerializeAcceleration(FArchive& Ar, UPackageMap* PackageMap, bool& bOutSuccess)
+{
+	using namespace MultiplayerCourseMovement;
+
+	// Client moves are quantized to whole steps, so X and Y fit 10 bits each and Z is nearly always zero.
+	// Anything else (e.g. a designer raised MaxAcceleration past the step range) falls back to the full vector
+	uint8 bIsZero = Ar.IsSaving() ? Acceleration.IsZero() : 0;
+	Ar.SerializeBits(&bIsZero, 1);
+	if (bIsZero) {
+		Acceleration = FVector::ZeroVector;
+		return;
+	}
+
+	uint8 bIsCompact = Ar.IsSaving() ? (IsCompactComponent(Acceleration.X) && IsCompactComponent(Acceleration.Y) && IsCompactComponent(Acceleration.Z)) : 0;
+	Ar.SerializeBits(&bIsCompact, 1);
+	if (!bIsCompact) {
+		Acceleration.NetSerialize(Ar, PackageMap, bOutSuccess);
+		return;
+	}
+
+	SerializeAccelerationStep(Ar, Acceleration.X);
+	SerializeAccelerationStep(Ar, Acceleration.Y);
+
+	uint8 bHasZ = Ar.IsSaving() ? (Acceleration.Z != 0.0) : 0;
+	Ar.SerializeBits(&bHasZ, 1);
+	if (bHasZ) {
+		SerializeAccelerationStep(Ar, Acceleration.Z);
+	}
+	else {
+		Acceleration.Z = 0.0;
+	}
+}
+
+FMultiplayerCourseNetworkMoveDataContainer::FMultiplayerCourseNetworkMoveDataContainer()
+{
+	NewMoveData = &MoveData[0];
+	PendingMoveData = &MoveData[1];
+	OldMoveData = &MoveData[2];
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UMultiplayerCourseCharacterMovementComponent
+
+UMultiplayerCourseCharacterMovementComponent::UMultiplayerCourseCharacterMovementComponent()
+{
+	NavAgentProps.bCanCrouch = true;
+
+	SetNetworkMoveDataContainer(MultiplayerCourseNetworkMoveDataContainer);
+}
+
+FVector UMultiplayerCourseCharacterMovementComponent::QuantizeAcceleration(const FVector& InAcceleration)
+{
+	// Truncate towards zero so quantizing never pushes the acceleration past the max acceleration clamp
+	return FVector(
+		FMath::TruncToDouble(InAcceleration.X / AccelerationQuantum) * AccelerationQuantum,
+		FMath::TruncToDouble(InAcceleration.Y / AccelerationQuantum) * AccelerationQuantum,
+		FMath::TruncToDouble(InAcceleration.Z / AccelerationQuantum) * AccelerationQuantum);
+}
+
+bool UMultiplayerCourseCharacterMovementComponent::IsSprinting() const
+{
+	return bWantsToSprint && MovementMode == MOVE_Walking && !IsCrouching();
+}
+
+FNetworkPredictionData_Client* UMultiplayerCourseCharacterMovementComponent::GetPredictionData_Client() const
+{
+	check(PawnOwner != nullptr);
+
+	if (ClientPredictionData == nullptr) {
+		UMultiplayerCourseCharacterMovementComponent* MutableThis = const_cast<UMultiplayerCourseCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_MultiplayerCourse(*this);
+	}
+	return ClientPredictionData;
+}
+
+void UMultiplayerCourseCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsToSprint = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+}
+
+float UMultiplayerCourseCharacterMovementComponent::GetMaxSpeed() const
+{
+	if (IsSliding()) {
+		return MaxSlideSpeed;
+	}
+	if (IsSprinting()) {
+		return MaxSprintSpeed;
+	}
+	return Super::GetMaxSpeed();
+}
+
+float UMultiplayerCourseCharacterMovementComponent::GetMaxBrakingDeceleration() const
+{
+	return IsSliding() ? BrakingDecelerationSliding : Super::GetMaxBrakingDeceleration();
+}
+
+bool UMultiplayerCourseCharacterMovementComponent::IsMovingOnGround() const
+{
+	return Super::IsMovingOnGround() || IsSliding();
+}
+
+bool UMultiplayerCourseCharacterMovementComponent::CanCrouchInCurrentState() const
+{
+	// Sliding counts as being on the ground, so the capsule stays crouched for the whole slide
+	return Super::CanCrouchInCurrentState() || (IsSliding() && UpdatedComponent && !UpdatedComponent->IsSimulatingPhysics());
+}
+
+void UMultiplayerCourseCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	// Runs on the client and the server from the same saved move inputs, so the slide is predicted like crouching is
+	if (MovementMode == MOVE_Walking && bWantsToSprint && bWantsToCrouch && !IsCrouching() && Velocity.SizeSquared() >= FMath::Square(MinSlideEntrySpeed)) {
+		EnterSlide();
+	}
+	else if (IsSliding() && !bWantsToCrouch) {
+		ExitSlide();
+	}
+
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+}
+
+void UMultiplayerCourseCharacterMovementComponent::PhysCustom(float DeltaTime, int32 Iterations)
+{
+	Super::PhysCustom(DeltaTime, Iterations);
+
+	switch (CustomMovementMode) {
+	case CMOVE_Slide:
+		PhysSlide(DeltaTime, Iterations);
+		break;
+	default:
+		UE_LOG(LogTemp, Warning, TEXT("Unknown custom movement mode %d in UMultiplayerCourseCharacterMovementComponent::PhysCustom"), CustomMovementMode);
+		break;
+	}
+}
+
+void UMultiplayerCourseCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+{
+	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+
+	// Publish the result of the move for simulated proxies
+	if (CharacterOwner && CharacterOwner->HasAuthority()) {
+		if (AMultiplayerCourseCharacter* Character = Cast<AMultiplayerCourseCharacter>(CharacterOwner)) {
+			FMultiplayerCourseCharacterNetState NewNetState;
+			NewNetState.bIsSprinting = IsSprinting();
+			NewNetState.bIsSliding = IsSliding();
+			Character->SetNetState(NewNetState);
+		}
+	}
+}
+
+void UMultiplayerCourseCharacterMovementComponent::EnterSlide()
+{
+	Velocity += Velocity.GetSafeNormal2D() * SlideEntryImpulse;
+	SetMovementMode(MOVE_Custom, CMOVE_Slide);
+}
+
+void UMultiplayerCourseCharacterMovementComponent::ExitSlide()
+{
+	SetMovementMode(MOVE_Walking);
+}
+
+bool UMultiplayerCourseCharacterMovementComponent::GetSlideSurface(FHitResult& OutHit) const
+{
+	const FVector Start = UpdatedComponent->GetComponentLocation();
+	const FVector End = Start + FVector::DownVector * CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() * 2.f;
+	return GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, UpdatedComponent->GetCollisionObjectType(), CharacterOwner->GetIgnoreCharacterParams());
+}
+
+void UMultiplayerCourseCharacterMovementComponent::PhysSlide(float DeltaTime, int32 Iterations)
+{
+	if (DeltaTime < MIN_TICK_TIME) {
+		return;
+	}
+
+	FHitResult SurfaceHit;
+	if (!GetSlideSurface(SurfaceHit) || Velocity.SizeSquared() < FMath::Square(MinSlideSpeed)) {
+		ExitSlide();
+		StartNewPhysics(DeltaTime, Iterations);
+		return;
+	}
+
+	// Gravity pulls along the slope, then the velocity is kept on the surface
+	Velocity += FVector::DownVector * SlideGravityForce * DeltaTime;
+	Velocity = FVector::VectorPlaneProject(Velocity, SurfaceHit.Normal);
+
+	// Only sideways input steers a slide
+	const FVector RightVector = UpdatedComponent->GetRightVector();
+	Acceleration = FMath::Abs(FVector::DotProduct(Acceleration.GetSafeNormal(), RightVector)) > 0.5f ? Acceleration.ProjectOnTo(RightVector) : FVector::ZeroVector;
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity()) {
+		CalcVelocity(DeltaTime, SlideFriction, false, GetMaxBrakingDeceleration());
+	}
+	ApplyRootMotionToVelocity(DeltaTime);
+
+	Iterations++;
+	bJustTeleported = false;
+
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FVector Delta = Velocity * DeltaTime;
+	const FQuat NewRotation = Velocity.IsNearlyZero() ? UpdatedComponent->GetComponentQuat() : FRotator(0.f, Velocity.Rotation().Yaw, 0.f).Quaternion();
+
+	FHitResult Hit(1.f);
+	SafeMoveUpdatedComponent(Delta, NewRotation, true, Hit);
+	if (Hit.Time < 1.f) {
+		HandleImpact(Hit, DeltaTime, Delta);
+		SlideAlongSurface(Delta, 1.f - Hit.Time, Hit.Normal, Hit, true);
+	}
+
+	if (!bJustTeleported && !HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity()) {
+		Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / DeltaTime;
+	}
+
+	FHitResult NewSurfaceHit;
+	if (!GetSlideSurface(NewSurfaceHit) || Velocity.SizeSquared() < FMath::Square(MinSlideSpeed)) {
+		ExitSlide();
+	}
+}
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "MultiplayerCourseCharacterMovementComponent.generated.h"
+
+UENUM(BlueprintType)
+enum ECustomMovementMode : uint8
+{
+	CMOVE_None	UMETA(Hidden),
+	CMOVE_Slide	UMETA(DisplayName = "Slide"),
+	CMOVE_MAX	UMETA(Hidden),
+};
+
+/** Saved move carrying the sprint input, which goes up to the server in the compressed flags */
+class FSavedMove_MultiplayerCourse : public FSavedMove_Character
+{
+public:
+
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter* C) override;
+
+	uint8 bSavedWantsToSprint : 1;
+};
+
+class FNetworkPredictionData_Client_MultiplayerCourse : public FNetworkPredictionData_Client_Character
+{
+public:
+
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_MultiplayerCourse(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/** Move data sent in ServerMove, packs the (already quantized) acceleration into a few bits instead of a full vector */
+struct FMultiplayerCourseNetworkMoveData : public FCharacterNetworkMoveData
+{
+	typedef FCharacterNetworkMoveData Super;
+
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+
+private:
+
+	void SerializeAcceleration(FArchive& Ar, UPackageMap* PackageMap, bool& bOutSuccess);
+};
+
+struct FMultiplayerCourseNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	FMultiplayerCourseNetworkMoveDataContainer();
+
+	FMultiplayerCourseNetworkMoveData MoveData[3];
+};
+
+/**
+ * Character movement with client predicted sprint and crouch-slide. Both abilities are driven by
+ * the compressed flags of the saved moves, so they need no RPCs of their own
+ */
+UCLASS()
+class MULTIPLAYERCOURSE_API UMultiplayerCourseCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+	friend class FSavedMove_MultiplayerCourse;
+
+public:
+
+	UMultiplayerCourseCharacterMovementComponent();
+
+	/** Acceleration is truncated to multiples of this (cm/s^2) so client and server simulate the same value and similar moves combine */
+	static constexpr float AccelerationQuantum = 8.f;
+	static FVector QuantizeAcceleration(const FVector& InAcceleration);
+
+	UFUNCTION(BlueprintCallable, Category = "Character Movement: Sprint")
+	void SetWantsToSprint(bool bNewWantsToSprint) { bWantsToSprint = bNewWantsToSprint; }
+
+	UFUNCTION(BlueprintPure, Category = "Character Movement: Sprint")
+	bool IsSprinting() const;
+
+	UFUNCTION(BlueprintPure, Category = "Character Movement: Slide")
+	bool IsSliding() const { return IsCustomMovementMode(CMOVE_Slide); }
+
+	bool IsCustomMovementMode(ECustomMovementMode InCustomMovementMode) const { return MovementMode == MOVE_Custom && CustomMovementMode == InCustomMovementMode; }
+
+	//~ Begin UCharacterMovementComponent Interface
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual float GetMaxSpeed() const override;
+	virtual float GetMaxBrakingDeceleration() const override;
+	virtual bool IsMovingOnGround() const override;
+	virtual bool CanCrouchInCurrentState() const override;
+	//~ End UCharacterMovementComponent Interface
+
+	/** Max speed while sprinting on the ground */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Sprint", meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm/s"))
+	float MaxSprintSpeed{ 750.f };
+
+	/** Ground speed needed to turn a crouch into a slide */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm/s"))
+	float MinSlideEntrySpeed{ 600.f };
+
+	/** Slide ends once the character slows below this */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm/s"))
+	float MinSlideSpeed{ 250.f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm/s"))
+	float MaxSlideSpeed{ 1200.f };
+
+	/** Speed added along the direction of travel when the slide starts */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm/s"))
+	float SlideEntryImpulse{ 300.f };
+
+	/** Pulls the character down slopes while sliding */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = "0", UIMin = "0"))
+	float SlideGravityForce{ 4000.f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = "0", UIMin = "0"))
+	float SlideFriction{ 1.3f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = "0", UIMin = "0"))
+	float BrakingDecelerationSliding{ 1000.f };
+
+protected:
+
+	//~ Begin UCharacterMovementComponent Interface
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual void PhysCustom(float DeltaTime, int32 Iterations) override;
+	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+	//~ End UCharacterMovementComponent Interface
+
+private:
+
+	void EnterSlide();
+	void ExitSlide();
+	void PhysSlide(float DeltaTime, int32 Iterations);
+	bool GetSlideSurface(FHitResult& OutHit) const;
+
+	/** Set from input on the owning client, from the compressed flags on the server */
+	bool bWantsToSprint{ false };
+
+	FMultiplayerCourseNetworkMoveDataContainer MultiplayerCourseNetworkMoveDataContainer;
+};
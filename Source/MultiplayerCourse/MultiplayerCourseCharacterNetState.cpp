@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerCourseCharacterNetState.h"
+
+bool FMultiplayerCourseCharacterNetState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Packed = Ar.IsSaving() ? uint8(Pack()) : 0;
+	Ar.SerializeBits(&Packed, NumPackedBits);
+	if (Ar.IsLoading()) {
+		Unpack(Packed);
+	}
+
+	bOutSuccess = true;
+	return true;
+}
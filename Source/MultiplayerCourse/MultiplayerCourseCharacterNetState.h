@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MultiplayerCourseCharacterNetState.generated.h"
+
+/**
+ * Movement state simulated proxies can't derive from the replicated movement, e.g. for animation.
+ * Packed into single bits by NetSerialize on the legacy path and by FMultiplayerCourseCharacterNetStateNetSerializer under Iris
+ */
+USTRUCT(BlueprintType)
+struct MULTIPLAYERCOURSE_API FMultiplayerCourseCharacterNetState
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bIsSprinting{ false };
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bIsSliding{ false };
+
+	static constexpr uint32 NumPackedBits = 2;
+
+	uint32 Pack() const { return (bIsSprinting ? 1U : 0U) | (bIsSliding ? 2U : 0U); }
+	void Unpack(uint32 Packed) { bIsSprinting = (Packed & 1U) != 0; bIsSliding = (Packed & 2U) != 0; }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FMultiplayerCourseCharacterNetState& Other) const { return Pack() == Other.Pack(); }
+	bool operator!=(const FMultiplayerCourseCharacterNetState& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FMultiplayerCourseCharacterNetState> : public TStructOpsTypeTraitsBase2<FMultiplayerCourseCharacterNetState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
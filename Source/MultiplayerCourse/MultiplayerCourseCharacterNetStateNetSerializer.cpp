@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerCourseCharacterNetStateNetSerializer.h"
+#include "MultiplayerCourseCharacterNetState.h"
+#include "Iris/Serialization/NetBitStreamReader.h"
+#include "Iris/Serialization/NetBitStreamWriter.h"
+#include "Iris/Serialization/NetSerializerDelegates.h"
+#include "Iris/ReplicationState/PropertyNetSerializerInfoRegistry.h"
+
+namespace UE::Net
+{
+
+struct FMultiplayerCourseCharacterNetStateNetSerializer
+{
+	static const uint32 Version = 0;
+
+	// Quantized state is the packed bits, so comparing and serializing never touch the source struct
+	typedef FMultiplayerCourseCharacterNetState SourceType;
+	typedef uint8 QuantizedType;
+	typedef FMultiplayerCourseCharacterNetStateNetSerializerConfig ConfigType;
+
+	static const ConfigType DefaultConfig;
+
+	static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+	static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+	static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+	static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+	static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+	static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+
+private:
+
+	class FNetSerializerRegistryDelegates final : private UE::Net::FNetSerializerRegistryDelegates
+	{
+	public:
+		virtual ~FNetSerializerRegistryDelegates();
+
+	private:
+		virtual void OnPreFreezeNetSerializerRegistry() override;
+	};
+
+	static FMultiplayerCourseCharacterNetStateNetSerializer::FNetSerializerRegistryDelegates NetSerializerRegistryDelegates;
+};
+
+UE_NET_IMPLEMENT_SERIALIZER(FMultiplayerCourseCharacterNetStateNetSerializer);
+
+const FMultiplayerCourseCharacterNetStateNetSerializer::ConfigType FMultiplayerCourseCharacterNetStateNetSerializer::DefaultConfig;
+FMultiplayerCourseCharacterNetStateNetSerializer::FNetSerializerRegistryDelegates FMultiplayerCourseCharacterNetStateNetSerializer::NetSerializerRegistryDelegates;
+
+void FMultiplayerCourseCharacterNetStateNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+{
+	const QuantizedType Value = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	Context.GetBitStreamWriter()->WriteBits(Value, SourceType::NumPackedBits);
+}
+
+void FMultiplayerCourseCharacterNetStateNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+{
+	QuantizedType& Value = *reinterpret_cast<QuantizedType*>(Args.Target);
+	Value = QuantizedType(Context.GetBitStreamReader()->ReadBits(SourceType::NumPackedBits));
+}
+
+void FMultiplayerCourseCharacterNetStateNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	*reinterpret_cast<QuantizedType*>(Args.Target) = QuantizedType(Source.Pack());
+}
+
+void FMultiplayerCourseCharacterNetStateNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+{
+	SourceType& Target = *reinterpret_cast<SourceType*>(Args.Target);
+	Target.Unpack(*reinterpret_cast<const QuantizedType*>(Args.Source));
+}
+
+bool FMultiplayerCourseCharacterNetStateNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+{
+	if (Args.bStateIsQuantized) {
+		return *reinterpret_cast<const QuantizedType*>(Args.Source0) == *reinterpret_cast<const QuantizedType*>(Args.Source1);
+	}
+	return *reinterpret_cast<const SourceType*>(Args.Source0) == *reinterpret_cast<const SourceType*>(Args.Source1);
+}
+
+bool FMultiplayerCourseCharacterNetStateNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+{
+	// Every combination of the flags is a valid state
+	return true;
+}
+
+// Replaces the default struct serializer Iris would otherwise generate for the struct
+static const FName PropertyNetSerializerRegistry_NAME_MultiplayerCourseCharacterNetState("MultiplayerCourseCharacterNetState");
+UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_MultiplayerCourseCharacterNetState, FMultiplayerCourseCharacterNetStateNetSerializer);
+
+FMultiplayerCourseCharacterNetStateNetSerializer::FNetSerializerRegistryDelegates::~FNetSerializerRegistryDelegates()
+{
+	UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_MultiplayerCourseCharacterNetState);
+}
+
+void FMultiplayerCourseCharacterNetStateNetSerializer::FNetSerializerRegistryDelegates::OnPreFreezeNetSerializerRegistry()
+{
+	UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_MultiplayerCourseCharacterNetState);
+}
+
+}
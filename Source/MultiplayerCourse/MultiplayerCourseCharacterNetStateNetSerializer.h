@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Iris/Serialization/NetSerializer.h"
+#include "MultiplayerCourseCharacterNetStateNetSerializer.generated.h"
+
+/** Iris serializer for FMultiplayerCourseCharacterNetState, quantizes the state to its packed bits */
+USTRUCT()
+struct FMultiplayerCourseCharacterNetStateNetSerializerConfig : public FNetSerializerConfig
+{
+	GENERATED_BODY()
+};
+
+namespace UE::Net
+{
+	UE_NET_DECLARE_SERIALIZER(FMultiplayerCourseCharacterNetStateNetSerializer, MULTIPLAYERCOURSE_API);
+}
@@ -2,6 +2,7 @@
 
 #include "MultiplayerCourseGameMode.h"
 #include "MultiplayerCourseCharacter.h"
+#include "MultiplayerCoursePlayerController.h"
 #include "UObject/ConstructorHelpers.h"
 
 AMultiplayerCourseGameMode::AMultiplayerCourseGameMode()
@@ -12,4 +13,6 @@ AMultiplayerCourseGameMode::AMultiplayerCourseGameMode()
 	{
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
+
+	PlayerControllerClass = AMultiplayerCoursePlayerController::StaticClass();
 }
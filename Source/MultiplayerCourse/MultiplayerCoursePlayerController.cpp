@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerCoursePlayerController.h"
+#include "CharacterNetUpdateComponent.h"
+#include "LobbyPlayerState.h"
+#include "Components/InputComponent.h"
+#include "GameFramework/Pawn.h"
+
+void AMultiplayerCoursePlayerController::SetupInputComponent()
+{
+	Super::SetupInputComponent();
+
+	// Bound on the controller rather than the pawn, the lobby ready-check shouldn't depend on which pawn is possessed
+	if (InputComponent) {
+		InputComponent->BindKey(ToggleReadyKey, IE_Pressed, this, &AMultiplayerCoursePlayerController::ToggleReady);
+	}
+}
+
+void AMultiplayerCoursePlayerController::ToggleReady()
+{
+	// Only the lobby's player state carries a ready flag
+	if (ALobbyPlayerState* LobbyPlayerState = GetPlayerState<ALobbyPlayerState>()) {
+		LobbyPlayerState->ServerSetReady(!LobbyPlayerState->IsReady());
+	}
+}
+
+void AMultiplayerCoursePlayerController::NotifyPawnInput()
+{
+	if (!bPawnDormant) {
+		return;
+	}
+	bPawnDormant = false;
+	ServerWakePawn();
+}
+
+void AMultiplayerCoursePlayerController::ClientSetPawnDormant_Implementation(bool bDormant)
+{
+	bPawnDormant = bDormant;
+}
+
+void AMultiplayerCoursePlayerController::ServerWakePawn_Implementation()
+{
+	APawn* ControlledPawn = GetPawn();
+	if (UCharacterNetUpdateComponent* NetUpdateComponent = ControlledPawn ? ControlledPawn->FindComponentByClass<UCharacterNetUpdateComponent>() : nullptr) {
+		NetUpdateComponent->WakeUp();
+	}
+}
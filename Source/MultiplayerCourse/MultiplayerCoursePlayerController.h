@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "InputCoreTypes.h"
+#include "MultiplayerCoursePlayerController.generated.h"
+
+/**
+ * Player controller shared by the lobby and the match. Its channel stays open while the possessed pawn
+ * is net dormant, so it carries the messages that put the pawn to sleep and wake it up again
+ */
+UCLASS()
+class MULTIPLAYERCOURSE_API AMultiplayerCoursePlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+
+	// Called by the local pawn on any gameplay input, wakes the pawn on the server if it went dormant
+	void NotifyPawnInput();
+
+	UFUNCTION(Client, Reliable)
+	void ClientSetPawnDormant(bool bDormant);
+
+	// Flips the lobby ready flag, does nothing outside the lobby. Bound to ToggleReadyKey and usable from the console
+	UFUNCTION(Exec, BlueprintCallable, Category = "Lobby")
+	void ToggleReady();
+
+protected:
+
+	virtual void SetupInputComponent() override;
+
+	UFUNCTION(Server, Reliable)
+	void ServerWakePawn();
+
+private:
+
+	// Client side copy of the pawn's dormancy, moves sent while it is set never reach the server
+	bool bPawnDormant{ false };
+
+	UPROPERTY(EditDefaultsOnly, Category = "Lobby")
+	FKey ToggleReadyKey{ EKeys::R };
+};
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+/**
+ * Push model helpers. Every replicated property in this module is registered as push based, so the server only
+ * compares it after it was marked dirty. Register with DOREPLIFETIME_PUSH* and write through SET_REPLICATED_PROPERTY,
+ * or call MARK_REPLICATED_DIRTY after changing a property in place (arrays, struct members).
+ * A write that skips both is never sent.
+ */
+
+#define DOREPLIFETIME_PUSH(ClassName, PropertyName) \
+	{ \
+		FDoRepLifetimeParams PushParams; \
+		PushParams.bIsPushBased = true; \
+		DOREPLIFETIME_WITH_PARAMS_FAST(ClassName, PropertyName, PushParams); \
+	}
+
+#define DOREPLIFETIME_PUSH_CONDITION(ClassName, PropertyName, InCondition) \
+	{ \
+		FDoRepLifetimeParams PushParams; \
+		PushParams.bIsPushBased = true; \
+		PushParams.Condition = InCondition; \
+		DOREPLIFETIME_WITH_PARAMS_FAST(ClassName, PropertyName, PushParams); \
+	}
+
+#define MARK_REPLICATED_DIRTY(ClassName, PropertyName) MARK_PROPERTY_DIRTY_FROM_NAME(ClassName, PropertyName, this)
+
+// Assigns NewValue and marks the property dirty, only if the value actually changed. Returns whether it changed
+#define SET_REPLICATED_PROPERTY(ClassName, PropertyName, NewValue) \
+	MultiplayerCourseNet::SetReplicatedValue(PropertyName, NewValue, [this]() { MARK_PROPERTY_DIRTY_FROM_NAME(ClassName, PropertyName, this); })
+
+namespace MultiplayerCourseNet
+{
+	template<typename ValueType, typename MarkDirtyType>
+	bool SetReplicatedValue(ValueType& Property, const ValueType& NewValue, MarkDirtyType&& MarkDirty)
+	{
+		if (Property == NewValue) {
+			return false;
+		}
+		Property = NewValue;
+		MarkDirty();
+		return true;
+	}
+}
@@ -0,0 +1,244 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerCourseReplicationGraph.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "UObject/UObjectIterator.h"
+
+void UMultiplayerCourseReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Explicit mappings, anything not covered here is worked out from the class defaults in GetMappingPolicy
+	ClassRepNodePolicies.Set(AReplicationGraphDebugActor::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(AInfo::StaticClass(), EClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(APawn::StaticClass(), EClassRepNodeMapping::Spatialize_Dynamic);
+
+	// Blueprint subclasses pick up the class info of their closest native parent
+	for (TObjectIterator<UClass> It; It; ++It) {
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject(false));
+		if (!ActorCDO || !ActorCDO->GetIsReplicated()) {
+			continue;
+		}
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_"))) {
+			continue;
+		}
+
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(ClassInfo, Class, IsSpatialized(GetMappingPolicy(Class)));
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+void UMultiplayerCourseReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = GridSpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UMultiplayerCourseReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// Gathers the connection's controller, pawn and view target, plus owner-only actors routed here
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ConnectionNode, RepGraphConnection);
+	ConnectionNodes.Add(RepGraphConnection->NetConnection, ConnectionNode);
+}
+
+void UMultiplayerCourseReplicationGraph::RemoveClientConnection(UNetConnection* NetConnection)
+{
+	ConnectionNodes.Remove(NetConnection);
+
+	Super::RemoveClientConnection(NetConnection);
+}
+
+EClassRepNodeMapping UMultiplayerCourseReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	if (const EClassRepNodeMapping* Mapping = ClassRepNodePolicies.Get(Class)) {
+		return *Mapping;
+	}
+
+	// Cache it so the class hierarchy isn't walked again for the next actor of this class
+	const EClassRepNodeMapping Mapping = GetDefaultMappingPolicy(Class);
+	ClassRepNodePolicies.Set(Class, Mapping);
+	return Mapping;
+}
+
+EClassRepNodeMapping UMultiplayerCourseReplicationGraph::GetDefaultMappingPolicy(const UClass* Class)
+{
+	const AActor* ActorCDO = Class ? Cast<AActor>(Class->GetDefaultObject()) : nullptr;
+	if (!ActorCDO || !ActorCDO->GetIsReplicated()) {
+		return EClassRepNodeMapping::NotRouted;
+	}
+	if (ActorCDO->bAlwaysRelevant) {
+		return EClassRepNodeMapping::RelevantAllConnections;
+	}
+	if (ActorCDO->bOnlyRelevantToOwner) {
+		return EClassRepNodeMapping::RelevantOwnerConnection;
+	}
+	if (ActorCDO->NetDormancy > DORM_Awake) {
+		return EClassRepNodeMapping::Spatialize_Dormancy;
+	}
+	return ActorCDO->IsReplicatingMovement() ? EClassRepNodeMapping::Spatialize_Dynamic : EClassRepNodeMapping::Spatialize_Static;
+}
+
+void UMultiplayerCourseReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize) const
+{
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+	if (bSpatialize) {
+		// Every actor starts with a positive engine default, only a value that differs from it was chosen for the class
+		const bool bKeepsEngineDefault = ActorCDO->NetCullDistanceSquared <= 0.f || ActorCDO->NetCullDistanceSquared == GetDefault<AActor>()->NetCullDistanceSquared;
+		const float CullDistanceSquared = bKeepsEngineDefault ? FMath::Square(DefaultCullDistance) : ActorCDO->NetCullDistanceSquared;
+		Info.SetCullDistanceSquared(CullDistanceSquared);
+	}
+	Info.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+}
+
+bool UMultiplayerCourseReplicationGraph::RouteToOwnerConnection(const FNewReplicatedActorInfo& ActorInfo)
+{
+	UNetConnection* OwnerConnection = ActorInfo.Actor ? ActorInfo.Actor->GetNetConnection() : nullptr;
+	if (!OwnerConnection) {
+		return false;
+	}
+
+	if (TObjectPtr<UReplicationGraphNode_AlwaysRelevant_ForConnection>* ConnectionNode = ConnectionNodes.Find(OwnerConnection)) {
+		(*ConnectionNode)->NotifyAddNetworkActor(ActorInfo);
+		return true;
+	}
+	return false;
+}
+
+void UMultiplayerCourseReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class)) {
+	case EClassRepNodeMapping::NotRouted:
+		break;
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::RelevantOwnerConnection:
+		if (!RouteToOwnerConnection(ActorInfo)) {
+			PendingOwnerActors.AddUnique(ActorInfo.Actor);
+		}
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	}
+}
+
+void UMultiplayerCourseReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class)) {
+	case EClassRepNodeMapping::NotRouted:
+		break;
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::RelevantOwnerConnection:
+		// The owner may have changed or gone since the actor was routed, so check every connection node
+		if (PendingOwnerActors.Remove(ActorInfo.Actor) == 0) {
+			for (const TPair<TObjectPtr<UNetConnection>, TObjectPtr<UReplicationGraphNode_AlwaysRelevant_ForConnection>>& ConnectionNode : ConnectionNodes) {
+				if (ConnectionNode.Value->NotifyRemoveNetworkActor(ActorInfo, false)) {
+					break;
+				}
+			}
+		}
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	}
+}
+
+int32 UMultiplayerCourseReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	// Owners are usually assigned right after spawn, so these rarely wait more than a frame
+	for (int32 Index = PendingOwnerActors.Num() - 1; Index >= 0; --Index) {
+		AActor* Actor = PendingOwnerActors[Index];
+		if (!IsValid(Actor) || RouteToOwnerConnection(FNewReplicatedActorInfo(Actor))) {
+			PendingOwnerActors.RemoveAtSwap(Index);
+		}
+	}
+
+	return Super::ServerReplicateActors(DeltaSeconds);
+}
+
+void UMultiplayerCourseReplicationGraph::SetActorNetUpdateFrequency(AActor* Actor, float Frequency)
+{
+	if (!Actor) {
+		return;
+	}
+	Actor->NetUpdateFrequency = Frequency;
+
+	// The graph keeps its own replication period per actor and connection, the actor's frequency is only read when it is added
+	UNetDriver* NetDriver = Actor->GetNetDriver();
+	if (UMultiplayerCourseReplicationGraph* ReplicationGraph = NetDriver ? Cast<UMultiplayerCourseReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr) {
+		ReplicationGraph->ApplyActorNetUpdateFrequency(Actor, Frequency);
+	}
+}
+
+void UMultiplayerCourseReplicationGraph::ApplyActorNetUpdateFrequency(AActor* Actor, float Frequency)
+{
+	FGlobalActorReplicationInfo* GlobalInfo = GlobalActorReplicationInfoMap.Find(Actor);
+	if (!GlobalInfo) {
+		return;
+	}
+
+	const float ClampedFrequency = FMath::Max(Frequency, 1.f);
+	GlobalInfo->Settings.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ClampedFrequency);
+
+	for (UNetReplicationGraphConnection* ConnectionManager : Connections) {
+		if (FConnectionReplicationActorInfo* ConnectionInfo = ConnectionManager->ActorInfoMap.Find(Actor)) {
+			const float ViewerFrequency = FMath::Max(ClampedFrequency * GetViewerFrequencyScale(ConnectionManager, Actor), 1.f);
+			ConnectionInfo->ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ViewerFrequency);
+		}
+	}
+}
+
+float UMultiplayerCourseReplicationGraph::GetViewerFrequencyScale(const UNetReplicationGraphConnection* ConnectionManager, const AActor* Actor) const
+{
+	const UNetConnection* NetConnection = ConnectionManager->NetConnection;
+	const APlayerController* PlayerController = NetConnection ? NetConnection->PlayerController.Get() : nullptr;
+	if (!PlayerController || Actor->GetNetConnection() == NetConnection) {
+		return 1.f;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	const FVector ToActor = Actor->GetActorLocation() - ViewLocation;
+	const float Distance = ToActor.Size();
+	float Scale = FMath::GetMappedRangeValueClamped(FVector2D(NearViewerDistance, FarViewerDistance), FVector2D(1.f, FarViewerFrequencyScale), Distance);
+	if (Distance > NearViewerDistance && FVector::DotProduct(ViewRotation.Vector(), ToActor) < 0.f) {
+		Scale *= BehindViewerFrequencyScale;
+	}
+	return Scale;
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "MultiplayerCourseReplicationGraph.generated.h"
+
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_AlwaysRelevant_ForConnection;
+
+// How actors of a class are routed to graph nodes when they start replicating
+enum class EClassRepNodeMapping : uint8
+{
+	NotRouted,					// Not added to any node, e.g. player controllers which the connection node already gathers
+	RelevantAllConnections,		// Game state, player states and other always relevant actors
+	RelevantOwnerConnection,	// bOnlyRelevantToOwner actors, only replicated to the owning connection
+
+	// Everything below here is spatialized into the grid
+	Spatialize_Static,			// Actors that don't move, only put into the grid once
+	Spatialize_Dynamic,			// Characters and anything else that moves, re-celled every frame
+	Spatialize_Dormancy,		// Moved to the static cells while dormant, dynamic while awake
+};
+
+/**
+ * Replication graph for large sessions. Pawns are culled through a 2D spatial grid, game and player state
+ * are relevant to everyone and owner-only actors only ever reach their own connection, so the server no
+ * longer does a relevancy check for every actor on every connection each net tick
+ */
+UCLASS(Transient, Config = Engine)
+class MULTIPLAYERCOURSE_API UMultiplayerCourseReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RemoveClientConnection(UNetConnection* NetConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	// Sets the actor's NetUpdateFrequency. When the actor's net driver runs this graph the rate is also applied
+	// per connection, scaled down for viewers that are far away or looking the other way
+	static void SetActorNetUpdateFrequency(AActor* Actor, float Frequency);
+
+private:
+
+	EClassRepNodeMapping GetMappingPolicy(UClass* Class);
+	static EClassRepNodeMapping GetDefaultMappingPolicy(const UClass* Class);
+	static bool IsSpatialized(EClassRepNodeMapping Mapping) { return Mapping >= EClassRepNodeMapping::Spatialize_Static; }
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize) const;
+
+	void ApplyActorNetUpdateFrequency(AActor* Actor, float Frequency);
+	float GetViewerFrequencyScale(const UNetReplicationGraphConnection* ConnectionManager, const AActor* Actor) const;
+
+	// Adds an owner-only actor to its connection node, false while the actor has no owning connection yet
+	bool RouteToOwnerConnection(const FNewReplicatedActorInfo& ActorInfo);
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_GridSpatialization2D> GridNode;
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_ActorList> AlwaysRelevantNode;
+
+	UPROPERTY()
+	TMap<TObjectPtr<UNetConnection>, TObjectPtr<UReplicationGraphNode_AlwaysRelevant_ForConnection>> ConnectionNodes;
+
+	// Owner-only actors spawned before they were given an owner, routed once the owner shows up
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> PendingOwnerActors;
+
+	TClassMap<EClassRepNodeMapping> ClassRepNodePolicies;
+
+	// Size of a grid cell in cm. Smaller cells cull more precisely but cost more to maintain
+	UPROPERTY(Config)
+	float GridCellSize{ 10000.f };
+
+	// Lowest world X/Y the grid covers, actors past it are clamped into the edge cells
+	UPROPERTY(Config)
+	FVector2D GridSpatialBias{ -150000.f, -200000.f };
+
+	// Cull distance used for spatialized classes that keep AActor's NetCullDistanceSquared, classes that set their own keep it
+	UPROPERTY(Config)
+	float DefaultCullDistance{ 15000.f };
+
+	// Viewers closer than this get the full update frequency
+	UPROPERTY(Config)
+	float NearViewerDistance{ 2000.f };
+
+	// Frequency scale reached at FarViewerDistance, interpolated from NearViewerDistance
+	UPROPERTY(Config)
+	float FarViewerDistance{ 10000.f };
+
+	UPROPERTY(Config)
+	float FarViewerFrequencyScale{ 0.25f };
+
+	// Extra scale for actors behind the viewer's camera
+	UPROPERTY(Config)
+	float BehindViewerFrequencyScale{ 0.5f };
+};
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterNetUpdateComponent.h"
+#include "LobbyGameMode.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Checks which dormancy delay a character gets depending on the map the server runs. The game mode comes from
+ * the map name the same way a real travel picks it
+ */
+BEGIN_DEFINE_SPEC(FCharacterNetUpdateComponentSpec, "MultiplayerCourse.CharacterNetUpdateComponent", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	UGameInstance* GameInstance{ nullptr };
+	UCharacterNetUpdateComponent* NetUpdateComponent{ nullptr };
+
+	void SetUpWorld(const TCHAR* MapName);
+	void TearDownWorld();
+
+END_DEFINE_SPEC(FCharacterNetUpdateComponentSpec)
+
+void FCharacterNetUpdateComponentSpec::SetUpWorld(const TCHAR* MapName)
+{
+	GameInstance = NewObject<UGameInstance>(GetTransientPackage());
+	GameInstance->AddToRoot();
+	GameInstance->InitializeStandalone();
+
+	UWorld* World = GameInstance->GetWorld();
+	World->SetGameMode(FURL(MapName));
+
+	AActor* Owner = World->SpawnActor<AActor>();
+	NetUpdateComponent = NewObject<UCharacterNetUpdateComponent>(Owner);
+	NetUpdateComponent->RegisterComponent();
+}
+
+void FCharacterNetUpdateComponentSpec::TearDownWorld()
+{
+	if (GameInstance) {
+		UWorld* World = GameInstance->GetWorld();
+		GameInstance->Shutdown();
+		if (World) {
+			World->DestroyWorld(false);
+		}
+		GameInstance->RemoveFromRoot();
+	}
+
+	GameInstance = nullptr;
+	NetUpdateComponent = nullptr;
+}
+
+void FCharacterNetUpdateComponentSpec::Define()
+{
+	AfterEach([this]() {
+		TearDownWorld();
+	});
+
+	Describe("in the Lobby map", [this]() {
+		BeforeEach([this]() {
+			SetUpWorld(TEXT("/Game/Maps/Lobby"));
+		});
+
+		It("runs the lobby game mode", [this]() {
+			TestNotNull(TEXT("Lobby game mode"), GameInstance->GetWorld()->GetAuthGameMode<ALobbyGameMode>());
+		});
+
+		It("uses the lobby dormancy delay", [this]() {
+			TestTrue(TEXT("In lobby"), NetUpdateComponent->IsInLobby());
+			TestEqual(TEXT("Dormancy delay"), NetUpdateComponent->GetDormancyDelay(), NetUpdateComponent->LobbyDormancyDelay);
+		});
+	});
+
+	Describe("in the match map", [this]() {
+		BeforeEach([this]() {
+			SetUpWorld(TEXT("/Game/Maps/BasicLevel"));
+		});
+
+		It("uses the idle dormancy delay", [this]() {
+			TestFalse(TEXT("In lobby"), NetUpdateComponent->IsInLobby());
+			TestEqual(TEXT("Dormancy delay"), NetUpdateComponent->GetDormancyDelay(), NetUpdateComponent->IdleDormancyDelay);
+		});
+	});
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
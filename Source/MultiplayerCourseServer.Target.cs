@@ -0,0 +1,21 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class MultiplayerCourseServerTarget : TargetRules
+{
+	public MultiplayerCourseServerTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		DefaultBuildSettings = BuildSettingsVersion.V5;
+		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_4;
+		ExtraModuleNames.Add("MultiplayerCourse");
+
+		// Compiles Iris in next to the legacy replication path, which one runs is picked by net.Iris.UseIrisReplication
+		bUseIris = true;
+
+		// Lets replicated properties be marked dirty on write instead of compared every net update
+		bWithPushModel = true;
+	}
+}